@@ -0,0 +1,49 @@
+/**
+ * @file bench_parse.h
+ * @brief Parsing helper for benchmarks that need a real AST
+ */
+#ifndef BENCH_PARSE_H
+#define BENCH_PARSE_H
+
+#include "ast.h"
+#include "parser.h"
+#include "Compiler.h"
+#include "CompilationContext.h"
+#include "NameResolver.h"
+#include "SourceBuffer.h"
+#include <string>
+
+extern int yylex_init_extra(CompilationContext *, yyscan_t *);
+extern int yylex_destroy(yyscan_t);
+
+/**
+ * @brief Parses, resolves and type-checks a source file into a context
+ *
+ * The caller should hold an ArenaScope on ctx->arena so the tree is built
+ * in the context's arena, as the driver does.
+ * @param ctx Context that receives the AST and the symbol table
+ * @param path Source file
+ * @return true if the program parsed and checked without errors
+ */
+inline bool benchParse(CompilationContext *ctx, const std::string &path)
+{
+    SourceBuffer src;
+    if (!src.Open(path))
+        return false;
+    yyscan_t scanner;
+    yylex_init_extra(ctx, &scanner);
+    scanSourceBuffer(&src, scanner);
+    initializeBuiltInFunctions(ctx->symbolTable);
+    yyparse(ctx, scanner);
+    yylex_destroy(scanner);
+    if (!ctx->root)
+        return false;
+    ctx->annotations.Number(ctx->root);
+    NameResolver resolver(ctx);
+    resolver.Dispatch(ctx->root);
+    TypeVisitor typeVisitor(ctx);
+    ctx->root->accept(&typeVisitor);
+    return ctx->errors->errorStack.empty();
+}
+
+#endif
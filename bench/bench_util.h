@@ -0,0 +1,125 @@
+/**
+ * @file bench_util.h
+ * @brief Shared helpers for the compiler benchmarks
+ *
+ * Small timing utilities and a generator for large synthetic MiniPascal
+ * programs, so every benchmark can run without external inputs, plus
+ * helpers to read generated VM code back and run it in a VM.
+ */
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include "InstructionBuffer.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+/**
+ * @brief Returns a monotonic timestamp in seconds
+ */
+inline double benchNow()
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Generates a synthetic MiniPascal program
+ *
+ * The program has one global array and `numSubs` procedures named like
+ * generated code (`tmp_000123`), each with a few locals and a loop body.
+ * @param numSubs Number of procedures to generate
+ * @return The program source
+ */
+inline std::string benchGenerateProgram(int numSubs)
+{
+    std::string src = "program Generated;\nvar g_total : integer;\nvar g_data : array[0..99] of integer;\n";
+    char name[32];
+    for (int i = 0; i < numSubs; i++)
+    {
+        snprintf(name, sizeof(name), "tmp_%06d", i);
+        src += "procedure ";
+        src += name;
+        src += "(n : integer);\nvar i, acc : integer;\nvar ratio : real;\nbegin\n"
+               "    { generated body }\n"
+               "    i := 0;\n    acc := 0;\n    ratio := 0.5;\n"
+               "    while i < n do\n    begin\n"
+               "        acc := acc + g_data[i] * 2 - 1; // accumulate\n"
+               "        if acc > 1000 then acc := acc div 2;\n"
+               "        i := i + 1\n    end;\n"
+               "    g_total := g_total + acc\nend;\n";
+    }
+    src += "begin\n    g_total := 0";
+    for (int i = 0; i < numSubs && i < 100; i++)
+    {
+        snprintf(name, sizeof(name), "tmp_%06d", i);
+        src += ";\n    ";
+        src += name;
+        src += "(10)";
+    }
+    src += ";\n    write(g_total)\nend\n";
+    return src;
+}
+
+/**
+ * @brief Writes a string to a file
+ * @return true on success
+ */
+inline bool benchWriteFile(const std::string &path, const std::string &contents)
+{
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f)
+        return false;
+    fwrite(contents.data(), 1, contents.size(), f);
+    fclose(f);
+    return true;
+}
+
+/**
+ * @brief Parses a VM program written by the compiler back into lines
+ * @param path The .vm file
+ */
+inline InstructionBuffer benchReadProgram(const std::string &path)
+{
+    InstructionBuffer program;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos)
+            continue;
+        line = line.substr(start);
+        if (line.back() == ':')
+            program.EmitLabel(line.substr(0, line.size() - 1));
+        else
+            program.Emit(line);
+    }
+    return program;
+}
+
+/**
+ * @brief Runs a VM program with the VM's `count` option
+ * @param vm The command that starts the VM, e.g. "wine vm.exe"
+ * @param path The .vm file
+ * @return The last line the VM printed, which holds the executed instruction count
+ */
+inline std::string benchExecutedCount(const std::string &vm, const std::string &path)
+{
+    std::string command = vm + " count " + path + " 2>&1";
+    FILE *out = popen(command.c_str(), "r");
+    if (!out)
+        return "(could not run the VM)";
+    char line[4096];
+    std::string last;
+    while (fgets(line, sizeof(line), out))
+        if (line[0] != '\n')
+            last = line;
+    pclose(out);
+    while (!last.empty() && (last.back() == '\n' || last.back() == '\r'))
+        last.pop_back();
+    return last;
+}
+
+#endif
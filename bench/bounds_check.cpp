@@ -0,0 +1,149 @@
+// Array bounds checks: one CHECK instruction versus the old compare-and-jump
+// sequence (DUP, PUSHI, INF, JZ, ERR, STOP and the same for the upper bound).
+//
+// An array-heavy program is compiled, and a second copy of its code is made
+// with every CHECK expanded into the old sequence. Both are compared by the
+// number of instructions they contain and, when a VM is given, by the
+// number the VM executes (its `count` option). A third copy is compiled with
+// -O, whose range analysis leaves out the checks it proves redundant.
+//
+// Usage: bench_bounds_check [vm-command] [source-file]
+// e.g.   bench_bounds_check "wine vm.exe"
+// Without a source file a program of array loops is generated.
+
+#include "Compiler.h"
+#include "InstructionBuffer.h"
+#include "bench_util.h"
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+// Loops filling, scanning and copying arrays, plus a bubble sort
+static string arrayProgram()
+{
+    return "program Arrays;\n"
+           "var a, b : array[1..200] of integer;\n"
+           "var i, j, t, sum : integer;\n"
+           "begin\n"
+           "    i := 1;\n"
+           "    while i <= 200 do\n"
+           "    begin\n"
+           "        a[i] := i * 37 - (i * 37) div 200 * 200;\n"
+           "        i := i + 1\n"
+           "    end;\n"
+           "    i := 1;\n"
+           "    while i <= 200 do\n"
+           "    begin\n"
+           "        j := 1;\n"
+           "        while j <= 200 - i do\n"
+           "        begin\n"
+           "            if a[j] > a[j + 1] then\n"
+           "            begin\n"
+           "                t := a[j];\n"
+           "                a[j] := a[j + 1];\n"
+           "                a[j + 1] := t\n"
+           "            end;\n"
+           "            j := j + 1\n"
+           "        end;\n"
+           "        i := i + 1\n"
+           "    end;\n"
+           "    sum := 0;\n"
+           "    i := 1;\n"
+           "    while i <= 200 do\n"
+           "    begin\n"
+           "        b[i] := a[i];\n"
+           "        sum := sum + b[i];\n"
+           "        i := i + 1\n"
+           "    end;\n"
+           "    write(sum)\n"
+           "end\n";
+}
+
+// Replaces every CHECK with the sequence the compiler emitted before it used CHECK
+static InstructionBuffer expandChecks(const InstructionBuffer &program, long &checks)
+{
+    InstructionBuffer expanded;
+    checks = 0;
+    for (const VMInstr &instr : program.code)
+    {
+        if (instr.kind != VMInstr::OP || instr.op != "CHECK")
+        {
+            expanded.code.push_back(instr);
+            continue;
+        }
+        istringstream bounds(instr.operand);
+        string begin, end;
+        bounds >> begin >> end;
+        string lowerOk = "BC" + to_string(checks) + "a", upperOk = "BC" + to_string(checks) + "b";
+        checks++;
+        expanded.Emit("DUP 1");
+        expanded.Emit("PUSHI " + begin);
+        expanded.Emit("INF");
+        expanded.Emit("JZ " + lowerOk);
+        expanded.Emit("ERR \"Runtime Error: Array index out of bounds.\"");
+        expanded.Emit("STOP");
+        expanded.EmitLabel(lowerOk);
+        expanded.Emit("DUP 1");
+        expanded.Emit("PUSHI " + end);
+        expanded.Emit("SUP");
+        expanded.Emit("JZ " + upperOk);
+        expanded.Emit("ERR \"Runtime Error: Array index out of bounds.\"");
+        expanded.Emit("STOP");
+        expanded.EmitLabel(upperOk);
+    }
+    return expanded;
+}
+
+int main(int argc, char *argv[])
+{
+    string vm = argc > 1 ? argv[1] : "";
+    string path = argc > 2 ? argv[2] : "build/bench_bounds_check_input.txt";
+    if (argc <= 2 && !benchWriteFile(path, arrayProgram()))
+    {
+        cerr << "Could not write the generated program" << endl;
+        return 1;
+    }
+    string checkPath = "build/bench_bounds_check.vm";
+    string legacyPath = "build/bench_bounds_check_legacy.vm";
+    string optimizedPath = "build/bench_bounds_check_optimized.vm";
+
+    CompileOptions options;
+    ostringstream log;
+    if (compileFile(path, checkPath, options, log) != 0)
+    {
+        cerr << log.str();
+        return 1;
+    }
+    options.optimize = true;
+    if (compileFile(path, optimizedPath, options, log) != 0)
+    {
+        cerr << log.str();
+        return 1;
+    }
+    InstructionBuffer program = benchReadProgram(checkPath);
+    InstructionBuffer optimized = benchReadProgram(optimizedPath);
+    long checks;
+    InstructionBuffer legacy = expandChecks(program, checks);
+    legacy.WriteFile(legacyPath);
+
+    long remaining;
+    expandChecks(optimized, remaining);
+
+    printf("input: %s, %ld bounds checks, %ld with -O\n", path.c_str(), checks, remaining);
+    printf("  instructions emitted : %6zu with CHECK, %6zu with compare-and-jump (%.1f%% fewer)\n",
+           program.InstructionCount(), legacy.InstructionCount(),
+           100.0 * (legacy.InstructionCount() - program.InstructionCount()) / legacy.InstructionCount());
+    printf("  instructions emitted : %6zu with CHECK and -O\n", optimized.InstructionCount());
+    if (vm.empty())
+    {
+        printf("  instructions executed: pass a VM command to count them, e.g. \"wine vm.exe\"\n");
+        return 0;
+    }
+    printf("  executed with CHECK            : %s\n", benchExecutedCount(vm, checkPath).c_str());
+    printf("  executed with compare-and-jump : %s\n", benchExecutedCount(vm, legacyPath).c_str());
+    printf("  executed with CHECK and -O     : %s\n", benchExecutedCount(vm, optimizedPath).c_str());
+    return 0;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file count_visitor.h
+ * @brief Reference whole-tree pass over the node objects, for benchmarks
+ *
+ * Counts nodes, identifier occurrences and the sum of integer literals
+ * through the classic Visitor interface (accept + Visit, two virtual calls
+ * per node).
+ */
+#ifndef COUNT_VISITOR_H
+#define COUNT_VISITOR_H
+
+#include "ast.h"
+
+struct PassResult
+{
+    long nodes;
+    long idents;
+    long intSum;
+    bool operator==(const PassResult &o) const { return nodes == o.nodes && idents == o.idents && intSum == o.intSum; }
+};
+
+// Whole-tree pass over the node objects
+class CountVisitor : public Visitor
+{
+public:
+    PassResult r = {0, 0, 0};
+
+    void Go(Node *n)
+    {
+        if (n)
+            n->accept(this);
+    }
+    template <class T>
+    void Each(NodeList<T> *l)
+    {
+        if (l)
+            for (auto *x : *l)
+                this->Go(x);
+    }
+    void Bin(BinOp *b)
+    {
+        this->r.nodes++;
+        this->Go(b->leftExp);
+        this->Go(b->rightExp);
+    }
+
+    virtual void Visit(Node *) {}
+    virtual void Visit(Stmt *) {}
+    virtual void Visit(SubHead *) {}
+    virtual void Visit(Type *) {}
+    virtual void Visit(Exp *) {}
+    virtual void Visit(BinOp *) {}
+    virtual void Visit(Prog *n) { r.nodes++; Go(n->name); Go(n->declarations); Go(n->subDeclarations); Go(n->compoundStatment); }
+    virtual void Visit(Ident *) { r.nodes++; r.idents++; }
+    virtual void Visit(Decs *n) { r.nodes++; Each(n->decs); }
+    virtual void Visit(ParDec *n) { r.nodes++; Go(n->identList); Go(n->tp); }
+    virtual void Visit(IdentList *n) { r.nodes++; Each(n->identLst); }
+    virtual void Visit(SubDecs *n) { r.nodes++; Each(n->subdecs); }
+    virtual void Visit(SubDec *n) { r.nodes++; Go(n->subHead); Go(n->localDecs); Go(n->compStmt); }
+    virtual void Visit(LocalDecs *n) { r.nodes++; Each(n->localDecs); }
+    virtual void Visit(LocalDec *n) { r.nodes++; Go(n->identlist); Go(n->tp); }
+    virtual void Visit(Func *n) { r.nodes++; Go(n->id); Go(n->args); Go(n->typ); }
+    virtual void Visit(Args *n) { r.nodes++; Go(n->parList); }
+    virtual void Visit(ParList *n) { r.nodes++; Each(n->parList); }
+    virtual void Visit(Proc *n) { r.nodes++; Go(n->id); Go(n->args); }
+    virtual void Visit(FuncCall *n) { r.nodes++; Go(n->id); Go(n->exps); }
+    virtual void Visit(CompStmt *n) { r.nodes++; Go(n->optitonalStmts); }
+    virtual void Visit(OptionalStmts *n) { r.nodes++; Go(n->stmtList); }
+    virtual void Visit(StmtList *n) { r.nodes++; Each(n->stmts); }
+    virtual void Visit(Var *n) { r.nodes++; Go(n->id); }
+    virtual void Visit(Assign *n) { r.nodes++; Go(n->var); Go(n->exp); }
+    virtual void Visit(ProcStmt *n) { r.nodes++; Go(n->id); Go(n->expls); }
+    virtual void Visit(ExpList *n) { r.nodes++; Each(n->expList); }
+    virtual void Visit(IfThen *n) { r.nodes++; Go(n->expr); Go(n->stmt); }
+    virtual void Visit(IfThenElse *n) { r.nodes++; Go(n->expr); Go(n->trueStmt); Go(n->falseStmt); }
+    virtual void Visit(While *n) { r.nodes++; Go(n->expr); Go(n->stmt); }
+    virtual void Visit(StdType *) { r.nodes++; }
+    virtual void Visit(IdExp *n) { r.nodes++; Go(n->id); }
+    virtual void Visit(ArrayExp *n) { r.nodes++; Go(n->id); Go(n->index); }
+    virtual void Visit(Integer *n) { r.nodes++; r.intSum += n->val; }
+    virtual void Visit(Real *) { r.nodes++; }
+    virtual void Visit(Bool *) { r.nodes++; }
+    virtual void Visit(Array *n) { r.nodes++; Go(n->stdType); }
+    virtual void Visit(ArrayElement *n) { r.nodes++; Go(n->id); Go(n->index); }
+    virtual void Visit(UnaryMinus *n) { r.nodes++; Go(n->exp); }
+    virtual void Visit(Not *n) { r.nodes++; Go(n->exp); }
+    virtual void Visit(Add *n) { Bin(n); }
+    virtual void Visit(Sub *n) { Bin(n); }
+    virtual void Visit(Mult *n) { Bin(n); }
+    virtual void Visit(Divide *n) { Bin(n); }
+    virtual void Visit(IntDiv *n) { Bin(n); }
+    virtual void Visit(GT *n) { Bin(n); }
+    virtual void Visit(LT *n) { Bin(n); }
+    virtual void Visit(GE *n) { Bin(n); }
+    virtual void Visit(LE *n) { Bin(n); }
+    virtual void Visit(ET *n) { Bin(n); }
+    virtual void Visit(NE *n) { Bin(n); }
+    virtual void Visit(And *n) { Bin(n); }
+    virtual void Visit(Or *n) { Bin(n); }
+};
+
+#endif
@@ -0,0 +1,118 @@
+// Code emission: the old per-line `outFile << ... << endl` emitter versus
+// the InstructionBuffer, which keeps the program in memory and writes it
+// with one large write.
+//
+// Usage: bench_emit_throughput [instruction-count]
+// Defaults to 1,000,000 emitted instructions.
+
+#include "InstructionBuffer.h"
+#include "bench_util.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+// A mix resembling generated code: loads, arithmetic, jumps and labels
+static void emitProgram(long count, void (*emit)(void *, const string &),
+                        void (*emitLabel)(void *, const string &), void *sink)
+{
+    for (long i = 0; i < count; i++)
+    {
+        switch (i % 8)
+        {
+        case 0:
+            emit(sink, "PUSHL " + to_string(i % 16));
+            break;
+        case 1:
+            emit(sink, "PUSHI " + to_string(i));
+            break;
+        case 2:
+            emit(sink, "ADD");
+            break;
+        case 3:
+            emit(sink, "STOREL " + to_string(i % 16));
+            break;
+        case 4:
+            emit(sink, "PUSHG " + to_string(i % 32));
+            break;
+        case 5:
+            emit(sink, "JZ L" + to_string(i / 8));
+            break;
+        case 6:
+            emit(sink, "WRITEI");
+            break;
+        default:
+            emit(sink, "JUMP L" + to_string(i / 8));
+            emitLabel(sink, "L" + to_string(i / 8));
+            break;
+        }
+    }
+}
+
+static void streamEmit(void *sink, const string &instr)
+{
+    *(ofstream *)sink << "    " << instr << endl;
+}
+
+static void streamLabel(void *sink, const string &label)
+{
+    *(ofstream *)sink << label << ":" << endl;
+}
+
+static void bufferEmit(void *sink, const string &instr)
+{
+    ((InstructionBuffer *)sink)->Emit(instr);
+}
+
+static void bufferLabel(void *sink, const string &label)
+{
+    ((InstructionBuffer *)sink)->EmitLabel(label);
+}
+
+int main(int argc, char *argv[])
+{
+    long count = argc > 1 ? atol(argv[1]) : 1000000;
+    string streamPath = "build/bench_emit_stream.vm";
+    string bufferPath = "build/bench_emit_buffer.vm";
+
+    double best[2] = {1e30, 1e30};
+    for (int round = 0; round < 3; round++)
+    {
+        double t0 = benchNow();
+        {
+            ofstream out(streamPath);
+            emitProgram(count, streamEmit, streamLabel, &out);
+        }
+        double t1 = benchNow();
+        {
+            InstructionBuffer code;
+            emitProgram(count, bufferEmit, bufferLabel, &code);
+            if (!code.WriteFile(bufferPath))
+            {
+                cerr << "Could not write " << bufferPath << endl;
+                return 1;
+            }
+        }
+        double t2 = benchNow();
+        best[0] = min(best[0], t1 - t0);
+        best[1] = min(best[1], t2 - t1);
+    }
+
+    // Both emitters must produce the same program text
+    ifstream a(streamPath), b(bufferPath);
+    string textA((istreambuf_iterator<char>(a)), istreambuf_iterator<char>());
+    string textB((istreambuf_iterator<char>(b)), istreambuf_iterator<char>());
+    if (textA != textB)
+    {
+        cerr << "Emitters disagree" << endl;
+        return 1;
+    }
+
+    printf("emit %ld instructions (%.1f MB of VM code), best of 3\n", count, textA.size() / (1024.0 * 1024.0));
+    printf("  ofstream + endl per line : %8.1f ms\n", best[0] * 1000);
+    printf("  InstructionBuffer        : %8.1f ms  (%.1fx)\n", best[1] * 1000, best[0] / best[1]);
+    return 0;
+}
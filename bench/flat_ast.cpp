@@ -0,0 +1,111 @@
+// Pointer-based AST (ast.h) versus the flat struct-of-arrays AST (flat_ast.h):
+// memory per node and the speed of a whole-tree pass.
+//
+// The pass counts nodes per kind, sums integer literals and counts
+// identifier occurrences. It runs as a Visitor over the node objects, as a
+// recursive walk over flat handles, and as a linear scan of the flat arrays
+// (nodes are stored in pre-order, so a whole-tree pass needs no recursion).
+//
+// Usage: bench_flat_ast [source-file]
+// Without an argument a program with 20000 procedures is generated.
+
+#include "flat_ast.h"
+#include "bench_parse.h"
+#include "bench_util.h"
+#include "count_visitor.h"
+#include <cstdio>
+#include <iostream>
+
+using namespace std;
+
+// The same pass, recursing through flat handles
+static void walkFlat(const FlatAst &ast, NodeHandle n, PassResult &r)
+{
+    r.nodes++;
+    if (ast.kind[n] == NK_IDENT)
+        r.idents++;
+    else if (ast.kind[n] == NK_INTEGER)
+        r.intSum += ast.value[n];
+    uint32_t first = ast.firstChild[n], count = ast.childCount[n];
+    for (uint32_t i = 0; i < count; i++)
+        if (ast.children[first + i] != NO_NODE)
+            walkFlat(ast, ast.children[first + i], r);
+}
+
+// The same pass as a scan of the kind and value arrays
+static PassResult scanFlat(const FlatAst &ast)
+{
+    PassResult r = {(long)ast.Size(), 0, 0};
+    const uint8_t *kind = ast.kind.data();
+    const int64_t *value = ast.value.data();
+    for (size_t n = 0; n < ast.Size(); n++)
+    {
+        r.idents += kind[n] == NK_IDENT;
+        r.intSum += kind[n] == NK_INTEGER ? value[n] : 0;
+    }
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    string path = "build/bench_flat_ast_input.txt";
+    if (argc > 1)
+        path = argv[1];
+    else if (!benchWriteFile(path, benchGenerateProgram(20000)))
+    {
+        cerr << "Could not write " << path << endl;
+        return 1;
+    }
+
+    CompilationContext ctx;
+    ArenaScope arenaScope(&ctx.arena);
+    size_t before = astNodeCount();
+    if (!benchParse(&ctx, path))
+    {
+        cerr << "Could not compile " << path << endl;
+        return 1;
+    }
+    size_t pointerNodes = astNodeCount() - before;
+    size_t pointerBytes = ctx.arena.BytesUsed();
+
+    double t0 = benchNow();
+    FlatAst flat = FlatAst::Build(ctx.root, &ctx.annotations);
+    double buildTime = benchNow() - t0;
+
+    const int rounds = 10;
+    double best[3] = {1e30, 1e30, 1e30};
+    PassResult res[3];
+    for (int round = 0; round < rounds; round++)
+    {
+        double start = benchNow();
+        CountVisitor v;
+        v.Go(ctx.root);
+        res[0] = v.r;
+        best[0] = min(best[0], benchNow() - start);
+
+        start = benchNow();
+        res[1] = {0, 0, 0};
+        walkFlat(flat, flat.root, res[1]);
+        best[1] = min(best[1], benchNow() - start);
+
+        start = benchNow();
+        res[2] = scanFlat(flat);
+        best[2] = min(best[2], benchNow() - start);
+    }
+    if (!(res[0] == res[1]) || !(res[1] == res[2]))
+    {
+        cerr << "Traversals disagree: " << res[0].nodes << " / " << res[1].nodes << " / " << res[2].nodes << " nodes" << endl;
+        return 1;
+    }
+
+    printf("input: %s, %ld nodes in the tree (%zu node objects, counting those created by type checking)\n",
+           path.c_str(), res[0].nodes, pointerNodes);
+    printf("memory per node: pointer AST %.1f bytes (arena, child vectors included), flat AST %.1f bytes\n",
+           (double)pointerBytes / pointerNodes, (double)flat.MemoryBytes() / flat.Size());
+    printf("flattening took %.1f ms\n", buildTime * 1000);
+    printf("whole-tree pass, best of %d:\n", rounds);
+    printf("  Visitor over node objects : %7.2f ms\n", best[0] * 1000);
+    printf("  recursive walk of handles : %7.2f ms  (%.1fx)\n", best[1] * 1000, best[0] / best[1]);
+    printf("  linear scan of flat arrays: %7.2f ms  (%.1fx)\n", best[2] * 1000, best[0] / best[2]);
+    return 0;
+}
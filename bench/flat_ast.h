@@ -0,0 +1,296 @@
+/**
+ * @file flat_ast.h
+ * @brief Compact, index-based representation of the AST, for benchmarks
+ *
+ * This header defines an alternative to the pointer-linked node classes of
+ * ast.h: every node lives in a struct-of-arrays pool and is addressed by a
+ * 32-bit handle, and the children of a node occupy a contiguous range of one
+ * shared child array. A pass that only needs kinds, values or source
+ * positions scans dense arrays instead of chasing pointers through
+ * individually allocated, vtable-carrying objects.
+ *
+ * The flat AST is built from a parsed (and optionally type-checked) tree, so
+ * it carries the expression types computed by TypeVisitor. No compiler pass
+ * uses it; bench/flat_ast.cpp measures it against the pointer-based tree.
+ *
+ * Key components include:
+ * - NodeHandle: 32-bit index of a node in the pool
+ * - FlatAst: The node pool and child array
+ */
+#ifndef BENCH_FLAT_AST_H
+#define BENCH_FLAT_AST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "ast.h"
+#include "Annotations.h"
+#include "StaticVisitor.h"
+
+using namespace std;
+
+/**
+ * @typedef NodeHandle
+ * @brief Index of a node in a FlatAst
+ */
+typedef uint32_t NodeHandle;
+
+/**
+ * @brief Handle of an absent child (e.g. a program without subprograms)
+ */
+const NodeHandle NO_NODE = 0xFFFFFFFFu;
+
+/**
+ * @class FlatAst
+ * @brief Struct-of-arrays node pool addressed by 32-bit handles
+ *
+ * All per-node arrays have one entry per node and are indexed by handle.
+ * Nodes are stored in pre-order, so a node's subtree occupies the handles
+ * from the node itself up to the next node that is not a descendant.
+ *
+ * Fixed-arity nodes keep their children in the order of the class fields in
+ * ast.h, with NO_NODE for a missing field (Prog: name, declarations,
+ * subprograms, body; Func: id, args, return type; IfThenElse: condition,
+ * then, else; binary operators: left, right; ...). List nodes (Decs,
+ * IdentList, SubDecs, ParList, LocalDecs, StmtList, ExpList) have one child
+ * per element.
+ *
+ * The meaning of `value` depends on the kind: the NameId for NK_IDENT, the
+ * value for NK_INTEGER and NK_BOOL, the float bits for NK_REAL, the TypeEnum
+ * for NK_STDTYPE, and the begin index (low 32 bits) and end index (high 32
+ * bits) for NK_ARRAY. It is 0 for the other kinds.
+ */
+class FlatAst
+{
+public:
+    vector<uint8_t> kind;          ///< NodeKind of each node
+    vector<uint8_t> type;          ///< TypeEnum of expressions and variables (VOID for other nodes)
+    vector<int32_t> line;          ///< Source line of each node
+    vector<int32_t> column;        ///< Source column of each node
+    vector<NodeHandle> parent;     ///< Parent of each node (NO_NODE for the root)
+    vector<uint32_t> firstChild;   ///< Start of the node's range in `children`
+    vector<uint32_t> childCount;   ///< Length of the node's range in `children`
+    vector<int64_t> value;         ///< Kind-specific payload (see class description)
+    vector<NodeHandle> children;   ///< Child handles; each node owns one contiguous range
+    NodeHandle root;               ///< Handle of the Prog node (NO_NODE if empty)
+
+    /**
+     * @brief Constructor for FlatAst, creates an empty pool
+     */
+    FlatAst();
+    /**
+     * @brief Builds the flat form of a parsed program
+     * @param prog Root of the pointer-based AST
+     * @param annotations Types recorded by TypeVisitor (NULL leaves every type VOID)
+     * @return The flat AST, with `root` set to the program node
+     */
+    static FlatAst Build(Prog *prog, const Annotations *annotations = NULL);
+
+    /**
+     * @brief Returns the number of nodes
+     */
+    size_t Size() const;
+    /**
+     * @brief Returns the i-th child of a node (may be NO_NODE)
+     * @param n The node
+     * @param i Child position
+     */
+    NodeHandle Child(NodeHandle n, uint32_t i) const;
+    /**
+     * @brief Appends a node with room for `numChildren` children, all NO_NODE
+     * @param k Kind of the node
+     * @param lin Source line
+     * @param col Source column
+     * @param numChildren Number of child slots to reserve
+     * @param val Kind-specific payload
+     * @return Handle of the new node
+     */
+    NodeHandle AddNode(NodeKind k, int lin, int col, uint32_t numChildren, int64_t val = 0);
+    /**
+     * @brief Fills a child slot reserved by AddNode and links the child's parent
+     * @param n The parent node
+     * @param i Child position
+     * @param child The child (NO_NODE leaves the slot empty)
+     */
+    void SetChild(NodeHandle n, uint32_t i, NodeHandle child);
+    /**
+     * @brief Returns the bytes held by the node and child arrays
+     */
+    size_t MemoryBytes() const;
+};
+
+inline FlatAst::FlatAst()
+{
+    this->root = NO_NODE;
+}
+
+inline size_t FlatAst::Size() const
+{
+    return this->kind.size();
+}
+
+inline NodeHandle FlatAst::Child(NodeHandle n, uint32_t i) const
+{
+    return this->children[this->firstChild[n] + i];
+}
+
+inline NodeHandle FlatAst::AddNode(NodeKind k, int lin, int col, uint32_t numChildren, int64_t val)
+{
+    NodeHandle n = this->kind.size();
+    this->kind.push_back(k);
+    this->type.push_back(VOID);
+    this->line.push_back(lin);
+    this->column.push_back(col);
+    this->parent.push_back(NO_NODE);
+    this->firstChild.push_back(this->children.size());
+    this->childCount.push_back(numChildren);
+    this->value.push_back(val);
+    this->children.resize(this->children.size() + numChildren, NO_NODE);
+    return n;
+}
+
+inline void FlatAst::SetChild(NodeHandle n, uint32_t i, NodeHandle child)
+{
+    this->children[this->firstChild[n] + i] = child;
+    if (child != NO_NODE)
+        this->parent[child] = n;
+}
+
+inline size_t FlatAst::MemoryBytes() const
+{
+    size_t perNode = sizeof(uint8_t) * 2 + sizeof(int32_t) * 2 + sizeof(NodeHandle) + sizeof(uint32_t) * 2 + sizeof(int64_t);
+    return this->Size() * perNode + this->children.size() * sizeof(NodeHandle);
+}
+
+/**
+ * Lowers the pointer-based AST into a FlatAst. Each Visit adds the node,
+ * reserving its child range first so that the range stays contiguous while
+ * the children's own subtrees are appended behind it, then builds the
+ * children into their slots. The handle of the node just built is left in
+ * `last`.
+ */
+class FlatAstBuilder : public StaticVisitor<FlatAstBuilder>
+{
+public:
+    FlatAst *ast;
+    const Annotations *annotations;
+    NodeHandle last;
+
+    FlatAstBuilder(FlatAst *a, const Annotations *annot) : ast(a), annotations(annot), last(NO_NODE) {}
+
+    NodeHandle Build(Node *n)
+    {
+        if (!n)
+            return NO_NODE;
+        this->last = NO_NODE;
+        this->Dispatch(n);
+        return this->last;
+    }
+
+    NodeHandle NewNode(NodeKind k, Node *n, uint32_t numChildren, int64_t val = 0)
+    {
+        return this->ast->AddNode(k, n->line, n->column, numChildren, val);
+    }
+
+    // Adds a node whose children are the fixed fields `kids`
+    NodeHandle Fixed(NodeKind k, Node *n, initializer_list<Node *> kids, int64_t val = 0)
+    {
+        NodeHandle h = this->NewNode(k, n, kids.size(), val);
+        uint32_t i = 0;
+        for (Node *kid : kids)
+            this->ast->SetChild(h, i++, this->Build(kid));
+        return h;
+    }
+
+    // Adds a list node with one child per element
+    template <class T>
+    NodeHandle List(NodeKind k, Node *n, NodeList<T> *elems)
+    {
+        NodeHandle h = this->NewNode(k, n, elems ? elems->size() : 0);
+        if (elems)
+            for (uint32_t i = 0; i < elems->size(); i++)
+                this->ast->SetChild(h, i, this->Build(elems->at(i)));
+        return h;
+    }
+
+    // Copies the type TypeVisitor recorded for n, if the program was checked
+    NodeHandle Typed(NodeHandle h, const Node *n)
+    {
+        if (this->annotations && n->nodeId != NO_NODE_ID)
+            this->ast->type[h] = this->annotations->TypeOf(n);
+        return h;
+    }
+
+    NodeHandle Binary(NodeKind k, BinOp *b)
+    {
+        return this->Typed(this->Fixed(k, b, {b->leftExp, b->rightExp}), b);
+    }
+
+    void Visit(Prog *n) { this->last = this->Fixed(NK_PROG, n, {n->name, n->declarations, n->subDeclarations, n->compoundStatment}); }
+    void Visit(Ident *n) { this->last = this->NewNode(NK_IDENT, n, 0, n->nameId); }
+    void Visit(Decs *n) { this->last = this->List(NK_DECS, n, n->decs); }
+    void Visit(ParDec *n) { this->last = this->Fixed(NK_PARDEC, n, {n->identList, n->tp}); }
+    void Visit(IdentList *n) { this->last = this->List(NK_IDENTLIST, n, n->identLst); }
+    void Visit(SubDecs *n) { this->last = this->List(NK_SUBDECS, n, n->subdecs); }
+    void Visit(SubDec *n) { this->last = this->Fixed(NK_SUBDEC, n, {n->subHead, n->localDecs, n->compStmt}); }
+    void Visit(LocalDecs *n) { this->last = this->List(NK_LOCALDECS, n, n->localDecs); }
+    void Visit(LocalDec *n) { this->last = this->Fixed(NK_LOCALDEC, n, {n->identlist, n->tp}); }
+    void Visit(Func *n) { this->last = this->Fixed(NK_FUNC, n, {n->id, n->args, n->typ}); }
+    void Visit(Args *n) { this->last = this->Fixed(NK_ARGS, n, {n->parList}); }
+    void Visit(ParList *n) { this->last = this->List(NK_PARLIST, n, n->parList); }
+    void Visit(Proc *n) { this->last = this->Fixed(NK_PROC, n, {n->id, n->args}); }
+    void Visit(FuncCall *n) { this->last = this->Typed(this->Fixed(NK_FUNCCALL, n, {n->id, n->exps}), n); }
+    void Visit(CompStmt *n) { this->last = this->Fixed(NK_COMPSTMT, n, {n->optitonalStmts}); }
+    void Visit(OptionalStmts *n) { this->last = this->Fixed(NK_OPTIONALSTMTS, n, {n->stmtList}); }
+    void Visit(StmtList *n) { this->last = this->List(NK_STMTLIST, n, n->stmts); }
+    void Visit(Var *n) { this->last = this->Typed(this->Fixed(NK_VAR, n, {n->id}), n); }
+    void Visit(Assign *n) { this->last = this->Fixed(NK_ASSIGN, n, {n->var, n->exp}); }
+    void Visit(ProcStmt *n) { this->last = this->Fixed(NK_PROCSTMT, n, {n->id, n->expls}); }
+    void Visit(ExpList *n) { this->last = this->List(NK_EXPLIST, n, n->expList); }
+    void Visit(IfThen *n) { this->last = this->Fixed(NK_IFTHEN, n, {n->expr, n->stmt}); }
+    void Visit(IfThenElse *n) { this->last = this->Fixed(NK_IFTHENELSE, n, {n->expr, n->trueStmt, n->falseStmt}); }
+    void Visit(While *n) { this->last = this->Fixed(NK_WHILE, n, {n->expr, n->stmt}); }
+    void Visit(StdType *n) { this->last = this->NewNode(NK_STDTYPE, n, 0, n->type); }
+    void Visit(IdExp *n) { this->last = this->Typed(this->Fixed(NK_IDEXP, n, {n->id}), n); }
+    void Visit(ArrayExp *n) { this->last = this->Typed(this->Fixed(NK_ARRAYEXP, n, {n->id, n->index}), n); }
+    void Visit(Integer *n) { this->last = this->Typed(this->NewNode(NK_INTEGER, n, 0, n->val), n); }
+    void Visit(Real *n)
+    {
+        int32_t bits;
+        memcpy(&bits, &n->val, sizeof(bits));
+        this->last = this->Typed(this->NewNode(NK_REAL, n, 0, bits), n);
+    }
+    void Visit(Bool *n) { this->last = this->Typed(this->NewNode(NK_BOOL, n, 0, n->val), n); }
+    void Visit(Array *n)
+    {
+        int64_t bounds = (uint32_t)n->beginIndex | ((int64_t)n->endIndex << 32);
+        this->last = this->Fixed(NK_ARRAY, n, {n->stdType}, bounds);
+    }
+    void Visit(ArrayElement *n) { this->last = this->Typed(this->Fixed(NK_ARRAYELEMENT, n, {n->id, n->index}), n); }
+    void Visit(UnaryMinus *n) { this->last = this->Typed(this->Fixed(NK_UNARYMINUS, n, {n->exp}), n); }
+    void Visit(Not *n) { this->last = this->Typed(this->Fixed(NK_NOT, n, {n->exp}), n); }
+    void Visit(Add *n) { this->last = this->Binary(NK_ADD, n); }
+    void Visit(Sub *n) { this->last = this->Binary(NK_SUB, n); }
+    void Visit(Mult *n) { this->last = this->Binary(NK_MULT, n); }
+    void Visit(Divide *n) { this->last = this->Binary(NK_DIVIDE, n); }
+    void Visit(IntDiv *n) { this->last = this->Binary(NK_INTDIV, n); }
+    void Visit(GT *n) { this->last = this->Binary(NK_GT, n); }
+    void Visit(LT *n) { this->last = this->Binary(NK_LT, n); }
+    void Visit(GE *n) { this->last = this->Binary(NK_GE, n); }
+    void Visit(LE *n) { this->last = this->Binary(NK_LE, n); }
+    void Visit(ET *n) { this->last = this->Binary(NK_ET, n); }
+    void Visit(NE *n) { this->last = this->Binary(NK_NE, n); }
+    void Visit(And *n) { this->last = this->Binary(NK_AND, n); }
+    void Visit(Or *n) { this->last = this->Binary(NK_OR, n); }
+};
+
+inline FlatAst FlatAst::Build(Prog *prog, const Annotations *annotations)
+{
+    FlatAst ast;
+    FlatAstBuilder builder(&ast, annotations);
+    ast.root = builder.Build(prog);
+    return ast;
+}
+
+#endif
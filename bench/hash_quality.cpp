@@ -0,0 +1,167 @@
+// Identifier hash quality: hash_fun1 and hash_fun2 (hash_fun.h) versus
+// FastStringHash (HashFunctions.h).
+//
+// For every corpus each hash distributes the names over a table of about
+// as many buckets as names, both indexed modulo a prime (as CHashTable did)
+// and masked to a power of two (as FlatHashMap does for avalanching
+// hashes). Reported are the longest bucket and the average number of
+// entries compared per successful lookup with chaining, next to what a
+// uniform hash would give, then the time to hash a name and the lookup
+// time in a FlatHashMap that masks every hash directly (skipped when the
+// distribution is degenerate).
+//
+// Usage: bench_hash_quality
+
+#include "FlatHashMap.h"
+#include "HashFunctions.h"
+#include "bench_util.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Treats any hash as avalanching, so FlatHashMap masks its low bits as is
+template <class H>
+struct Masked : H
+{
+    typedef void is_avalanching;
+};
+
+// Keeps the hashing loop from being optimized away
+static volatile size_t hashSink;
+
+struct Corpus
+{
+    const char *name;
+    vector<string> words;
+};
+
+static vector<Corpus> makeCorpora()
+{
+    vector<Corpus> corpora;
+    char buf[96];
+
+    Corpus generated = {"generated tmp_NNNNNN", {}};
+    for (int i = 0; i < 100000; i++)
+    {
+        snprintf(buf, sizeof(buf), "tmp_%06d", i);
+        generated.words.push_back(buf);
+    }
+    corpora.push_back(generated);
+
+    const char *stems[] = {"count", "index", "total", "value", "result", "temp", "sum", "buffer", "node", "item",
+                           "left", "right", "max", "min", "ratio", "offset", "size", "len", "key", "flag"};
+    Corpus handWritten = {"stem + stem + number", {}};
+    for (const char *a : stems)
+        for (const char *b : stems)
+            for (int i = 0; i < 250; i++)
+            {
+                snprintf(buf, sizeof(buf), "%s_%s%d", a, b, i);
+                handWritten.words.push_back(buf);
+            }
+    corpora.push_back(handWritten);
+
+    Corpus longNames = {"long, common suffix", {}};
+    for (int i = 0; i < 100000; i++)
+    {
+        snprintf(buf, sizeof(buf), "h%06d_compute_the_running_total_of_all_values", i);
+        longNames.words.push_back(buf);
+    }
+    corpora.push_back(longNames);
+    return corpora;
+}
+
+struct Distribution
+{
+    size_t buckets;
+    size_t longest;
+    double compares; // per successful lookup
+};
+
+template <class H>
+static Distribution distribute(const vector<string> &words, bool powerOfTwo)
+{
+    static const size_t primes[] = {1009, 5009, 10009, 20011, 50021, 100003, 200003, 500009};
+    size_t buckets = 2;
+    if (powerOfTwo)
+        while (buckets < words.size())
+            buckets *= 2;
+    else
+        for (size_t p : primes)
+            if ((buckets = p) >= words.size())
+                break;
+
+    vector<size_t> length(buckets, 0);
+    H hash;
+    for (const string &w : words)
+        length[powerOfTwo ? hash(w) & (buckets - 1) : hash(w) % buckets]++;
+    Distribution d = {buckets, 0, 0};
+    for (size_t len : length)
+    {
+        d.longest = max(d.longest, len);
+        d.compares += len * (len + 1) / 2.0;
+    }
+    d.compares /= words.size();
+    return d;
+}
+
+template <class H>
+static void report(const char *hashName, const vector<string> &words)
+{
+    Distribution prime = distribute<H>(words, false);
+    Distribution pow2 = distribute<H>(words, true);
+
+    H hash;
+    size_t sink = 0;
+    double start = benchNow();
+    for (int r = 0; r < 10; r++)
+        for (const string &w : words)
+            sink += hash(w);
+    double hashNs = (benchNow() - start) * 1e9 / (words.size() * 10.0);
+    hashSink = sink;
+    if (pow2.compares > 5)
+    { // chains that long become huge clusters under linear probing
+        printf("  %-15s %8zu %6.2f %10zu %6.0f %8.1f %9s\n", hashName,
+               prime.longest, prime.compares, pow2.longest, pow2.compares, hashNs, "-");
+        return;
+    }
+
+    vector<string> order = words;
+    shuffle(order.begin(), order.end(), mt19937(7));
+    FlatHashMap<string, int, Masked<H>> map;
+    for (size_t i = 0; i < words.size(); i++)
+        map.Insert(words[i], (int)i);
+    const int rounds = 5;
+    long found = 0;
+    start = benchNow();
+    for (int r = 0; r < rounds; r++)
+        for (const string &w : order)
+            found += map.Find(w) != NULL;
+    double ns = (benchNow() - start) * 1e9 / ((double)order.size() * rounds);
+
+    printf("  %-15s %8zu %6.2f %10zu %6.2f %8.1f %9.1f%s\n", hashName,
+           prime.longest, prime.compares, pow2.longest, pow2.compares, hashNs, ns,
+           found == (long)order.size() * rounds ? "" : "  (lookups failed!)");
+}
+
+int main()
+{
+    for (const Corpus &c : makeCorpora())
+    {
+        size_t n = c.words.size();
+        printf("%s: %zu names\n", c.name, n);
+        printf("  %-15s %8s %6s %10s %6s %8s %9s\n", "hash", "mod-p max", "cmp", "mask-2^k max", "cmp", "hash ns", "lookup ns");
+        report<HashFun1>("hash_fun1", c.words);
+        report<HashFun2>("hash_fun2", c.words);
+        report<FastStringHash>("FastStringHash", c.words);
+        // chaining with a uniform hash compares 1 + (n - 1) / (2 buckets) entries per hit
+        double primeBuckets = distribute<FastStringHash>(c.words, false).buckets;
+        double pow2Buckets = distribute<FastStringHash>(c.words, true).buckets;
+        printf("  %-15s %8s %6.2f %10s %6.2f\n\n", "(uniform)", "",
+               1 + (n - 1) / (2 * primeBuckets), "", 1 + (n - 1) / (2 * pow2Buckets));
+    }
+    return 0;
+}
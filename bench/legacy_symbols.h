@@ -0,0 +1,104 @@
+/**
+ * @file legacy_symbols.h
+ * @brief The string-keyed scope lookup the symbol table used before SymbolKey, for benchmarks
+ *
+ * Keys were a namespace tag ('r' parameter, 'g' global, 'l' local,
+ * 'f' function, 'p' procedure) followed by the raw bytes of the interned
+ * name and, for overloads, one character per parameter type. A variable
+ * reference probed 'l' and 'r' in every enclosing scope, then 'g' in the
+ * root scope.
+ */
+#ifndef LEGACY_SYMBOLS_H
+#define LEGACY_SYMBOLS_H
+
+#include "SymbolTable.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Builds a legacy key
+ */
+inline std::string legacySymbolKey(char tag, NameId id, const std::string &paramTypes = std::string())
+{
+    std::string key(1, tag);
+    key.append((const char *)&id, sizeof(id));
+    key += paramTypes;
+    return key;
+}
+
+/**
+ * @brief The legacy key of a symbol
+ */
+inline std::string legacySymbolKey(const Symbol *sym)
+{
+    static const char tags[] = {0, 'r', 'g', 'l', 'f', 'p'};
+    std::string paramTypes;
+    if (sym->funcSig)
+        for (TypeEnum t : sym->funcSig->paramTypeEnums)
+            paramTypes += (char)('0' + t);
+    return legacySymbolKey(tags[sym->Kind], Interner::Global().Intern(sym->Name), paramTypes);
+}
+
+typedef FlatHashMap<std::string, Symbol *> LegacyScopeTable;
+
+/**
+ * @class LegacySymbolTable
+ * @brief String-keyed copies of every scope of a symbol table
+ *
+ * The overloads of functions and procedures go to the root scope's table,
+ * where the legacy table kept them.
+ */
+class LegacySymbolTable
+{
+public:
+    std::vector<LegacyScopeTable *> tables; ///< One table per scope, in SymbolTable::Scopes order
+    std::vector<int> parent;                ///< Index of the parent scope, -1 for the root
+    long probeCount;                        ///< Probes made by LookUp
+
+    explicit LegacySymbolTable(SymbolTable *st)
+    {
+        this->probeCount = 0;
+        std::vector<Scope *> &scopes = *st->Scopes;
+        std::unordered_map<Scope *, int> index;
+        for (size_t i = 0; i < scopes.size(); i++)
+        {
+            LegacyScopeTable *t = new LegacyScopeTable();
+            scopes[i]->hashTab->ForEach([t](const SymbolKey &, Symbol *sym)
+                                        { t->Insert(legacySymbolKey(sym), sym); });
+            this->tables.push_back(t);
+            index[scopes[i]] = (int)i;
+            this->parent.push_back(scopes[i]->Parent ? index[scopes[i]->Parent] : -1);
+        }
+        st->overloads.ForEach([this](const SymbolKey &, OverloadSet *set)
+                              {
+                                  for (auto &member : set->members)
+                                      this->tables[0]->Insert(legacySymbolKey(member.second), member.second); });
+    }
+
+    ~LegacySymbolTable()
+    {
+        for (auto *t : this->tables)
+            delete t;
+    }
+
+    /**
+     * @brief Resolves a variable reference made in scope `scope` the legacy way
+     */
+    Symbol *LookUp(int scope, NameId id)
+    {
+        for (int s = scope; s >= 0; s = this->parent[s])
+        {
+            this->probeCount++;
+            if (Symbol *sym = this->tables[s]->Get(legacySymbolKey('l', id)))
+                return sym;
+            this->probeCount++;
+            if (Symbol *sym = this->tables[s]->Get(legacySymbolKey('r', id)))
+                return sym;
+        }
+        this->probeCount++;
+        return this->tables[0]->Get(legacySymbolKey('g', id));
+    }
+};
+
+#endif
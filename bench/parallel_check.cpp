@@ -0,0 +1,77 @@
+// Semantic analysis of subprogram bodies: serial versus parallel.
+//
+// The program is parsed and resolved once, then TypeVisitor checks it with
+// 1, 2, 4, ... threads (up to the hardware threads, at least 4). Every run
+// must report the same diagnostics as the serial one.
+//
+// Usage: bench_parallel_check [source-file]
+// Without an argument a program with 20000 procedures is generated.
+
+#include "ThreadPool.h"
+#include "bench_parse.h"
+#include "bench_util.h"
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+// Checks the tree with `jobs` threads, returning the best time and the diagnostics it printed
+static double check(CompilationContext *ctx, unsigned jobs, int rounds, string &diagnostics)
+{
+    double best = 1e30;
+    for (int round = 0; round < rounds; round++)
+    {
+        Errors errors;
+        ostringstream log;
+        TypeVisitor checker(ctx);
+        checker.errorStack = &errors;
+        checker.log = &log;
+        checker.jobs = jobs;
+
+        double start = benchNow();
+        ctx->root->accept(&checker);
+        best = min(best, benchNow() - start);
+
+        errors.PrintWarnings(log);
+        errors.PrintErrors(log);
+        diagnostics = log.str();
+    }
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    string path = argc > 1 ? argv[1] : "build/bench_parallel_check_input.txt";
+    if (argc <= 1 && !benchWriteFile(path, benchGenerateProgram(20000)))
+    {
+        cerr << "Could not write the generated program" << endl;
+        return 1;
+    }
+
+    CompilationContext ctx;
+    ArenaScope arenaScope(&ctx.arena);
+    benchParse(&ctx, path);
+    if (!ctx.root)
+    {
+        cerr << "Could not parse " << path << endl;
+        return 1;
+    }
+
+    const int rounds = 5;
+    string serialDiagnostics, diagnostics;
+    double serial = check(&ctx, 1, rounds, serialDiagnostics);
+    printf("input: %s, %zu subprograms, best of %d\n", path.c_str(),
+           ctx.root->subDeclarations ? ctx.root->subDeclarations->subdecs->size() : (size_t)0, rounds);
+    printf("  1 thread  : %8.3f ms\n", serial * 1000);
+
+    unsigned maxJobs = max(4u, thread::hardware_concurrency());
+    for (unsigned jobs = 2; jobs <= maxJobs; jobs *= 2)
+    {
+        double t = check(&ctx, jobs, rounds, diagnostics);
+        printf("  %u threads : %8.3f ms  (%.1fx)%s\n", jobs, t * 1000, serial / t,
+               diagnostics == serialDiagnostics ? "" : "  (diagnostics differ!)");
+    }
+    return 0;
+}
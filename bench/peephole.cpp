@@ -0,0 +1,81 @@
+// Peephole optimizer: VM code as generated versus after PeepholeOptimizer.
+//
+// Each program is compiled without -O, and the optimizer is run on a copy of
+// its code, so only the peephole rewrites are measured. Both are compared by
+// the number of instructions they contain and, when a VM is given, by the
+// number the VM executes (its `count` option).
+//
+// Usage: bench_peephole [vm-command] [source-file...]
+// e.g.   bench_peephole "wine vm.exe"
+// Without source files the programs in tests/ and a generated one are used.
+
+#include "Compiler.h"
+#include "PeepholeOptimizer.h"
+#include "bench_util.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    string vm = argc > 1 ? argv[1] : "";
+    vector<string> inputs(argv + min(argc, 2), argv + argc);
+    if (inputs.empty())
+    {
+        for (auto &entry : filesystem::directory_iterator("tests"))
+            if (entry.path().extension() == ".txt")
+                inputs.push_back(entry.path().string());
+        sort(inputs.begin(), inputs.end());
+        string generated = "build/bench_peephole_input.txt";
+        if (benchWriteFile(generated, benchGenerateProgram(20)))
+            inputs.push_back(generated);
+    }
+
+    vector<size_t> totals(PeepholeOptimizer::RuleCount(), 0);
+    size_t before = 0, after = 0;
+    for (const string &path : inputs)
+    {
+        string plainPath = "build/bench_peephole.vm", optimizedPath = "build/bench_peephole_optimized.vm";
+        CompileOptions options;
+        ostringstream log;
+        if (compileFile(path, plainPath, options, log) != 0)
+        {
+            printf("%s: does not compile, skipped\n", path.c_str());
+            continue;
+        }
+        InstructionBuffer program = benchReadProgram(plainPath);
+        size_t instructions = program.InstructionCount();
+        PeepholeOptimizer peephole;
+        double start = benchNow();
+        size_t rewrites = peephole.Run(program);
+        double seconds = benchNow() - start;
+        program.WriteFile(optimizedPath);
+
+        printf("%s: %zu -> %zu instructions, %zu rewrites in %zu passes, %.3f ms\n", path.c_str(), instructions,
+               program.InstructionCount(), rewrites, peephole.passes, seconds * 1000);
+        before += instructions;
+        after += program.InstructionCount();
+        for (size_t rule = 0; rule < totals.size(); rule++)
+            totals[rule] += peephole.applied[rule];
+        if (!vm.empty())
+        {
+            printf("  executed as generated  : %s\n", benchExecutedCount(vm, plainPath).c_str());
+            printf("  executed after peephole: %s\n", benchExecutedCount(vm, optimizedPath).c_str());
+        }
+    }
+
+    printf("total: %zu -> %zu instructions (%.1f%% fewer)\n", before, after,
+           before ? 100.0 * (before - after) / before : 0.0);
+    for (size_t rule = 0; rule < totals.size(); rule++)
+        if (totals[rule])
+            printf("  %-20s %6zu\n", PeepholeOptimizer::RuleName(rule), totals[rule]);
+    if (vm.empty())
+        printf("instructions executed: pass a VM command to count them, e.g. \"wine vm.exe\"\n");
+    return 0;
+}
@@ -0,0 +1,96 @@
+// Scanner throughput: buffered FILE* input (YY_INPUT/fread) versus a
+// memory-mapped source scanned in place with yy_scan_buffer.
+//
+// Usage: bench_scan_throughput [source-file]
+// Without an argument a ~30 MB synthetic program is generated.
+
+#include "ast.h"
+#include "parser.h"
+#include "CompilationContext.h"
+#include "SourceBuffer.h"
+#include "bench_util.h"
+#include <cstdio>
+#include <iostream>
+
+using namespace std;
+
+typedef struct yy_buffer_state *YY_BUFFER_STATE;
+extern int yylex(YYSTYPE *, yyscan_t);
+extern int yylex_init_extra(CompilationContext *, yyscan_t *);
+extern int yylex_destroy(yyscan_t);
+extern YY_BUFFER_STATE yy_create_buffer(FILE *, int, yyscan_t);
+extern YY_BUFFER_STATE yy_scan_buffer(char *, size_t, yyscan_t);
+extern void yy_switch_to_buffer(YY_BUFFER_STATE, yyscan_t);
+extern void yy_delete_buffer(YY_BUFFER_STATE, yyscan_t);
+
+static long scanAll(CompilationContext *ctx, yyscan_t scanner)
+{
+    YYSTYPE value;
+    long tokens = 0;
+    ctx->lin = 0;
+    ctx->col = 0;
+    while (yylex(&value, scanner) != 0)
+        tokens++;
+    return tokens;
+}
+
+int main(int argc, char *argv[])
+{
+    string path;
+    if (argc > 1)
+    {
+        path = argv[1];
+    }
+    else
+    {
+        path = "build/bench_scan_input.txt";
+        if (!benchWriteFile(path, benchGenerateProgram(60000)))
+        {
+            cerr << "Could not write " << path << endl;
+            return 1;
+        }
+    }
+
+    SourceBuffer probe;
+    if (!probe.Open(path))
+    {
+        cerr << "Could not map " << path << endl;
+        return 1;
+    }
+    double mb = probe.size / (1024.0 * 1024.0);
+    probe.Close();
+
+    CompilationContext ctx;
+    yyscan_t scanner;
+    yylex_init_extra(&ctx, &scanner);
+
+    const int rounds = 5;
+    double bestStdio = 1e30, bestMmap = 1e30;
+    long tokens = 0;
+    for (int r = 0; r < rounds; r++)
+    {
+        double start = benchNow();
+        FILE *f = fopen(path.c_str(), "r");
+        YY_BUFFER_STATE buf = yy_create_buffer(f, 16384, scanner);
+        yy_switch_to_buffer(buf, scanner);
+        tokens = scanAll(&ctx, scanner);
+        yy_delete_buffer(buf, scanner);
+        fclose(f);
+        bestStdio = min(bestStdio, benchNow() - start);
+
+        start = benchNow();
+        SourceBuffer src;
+        src.Open(path);
+        buf = yy_scan_buffer(src.data, src.size + 2, scanner);
+        scanAll(&ctx, scanner);
+        yy_delete_buffer(buf, scanner);
+        bestMmap = min(bestMmap, benchNow() - start);
+    }
+
+    yylex_destroy(scanner);
+
+    cout << "input: " << path << " (" << mb << " MB, " << tokens << " tokens)" << endl;
+    cout << "stdio  : " << mb / bestStdio << " MB/s" << endl;
+    cout << "mmap   : " << mb / bestMmap << " MB/s" << endl;
+    return 0;
+}
@@ -0,0 +1,147 @@
+// Compile latency: a fresh compiler process per file versus a compile server.
+//
+// The same small program is compiled again and again
+//   - by running build/compiler (skipped if it has not been built),
+//   - by a compile server running in this process, through its socket,
+//   - by compileFile in this process (no process and no socket: the floor).
+// Every way must produce the same VM code.
+//
+// Usage: bench_server_latency [source-file] [rounds]
+// Without a source file a program with 20 procedures is generated.
+
+#include "CompileServer.h"
+#include "bench_util.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+using namespace std;
+
+static string readAll(const string &path)
+{
+    ifstream in(path, ios::binary);
+    return string((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+}
+
+// Prints the median, 99th percentile and mean of a set of latencies
+static void report(const char *name, vector<double> &seconds, double baseline)
+{
+    sort(seconds.begin(), seconds.end());
+    double mean = 0;
+    for (double s : seconds)
+        mean += s;
+    mean /= seconds.size();
+    double median = seconds[seconds.size() / 2];
+    printf("  %-16s median %8.3f ms  p99 %8.3f ms  mean %8.3f ms", name, median * 1000,
+           seconds[seconds.size() * 99 / 100] * 1000, mean * 1000);
+    if (baseline > 0)
+        printf("  (%.1fx faster)", baseline / median);
+    printf("\n");
+}
+
+#ifndef _WIN32
+// Runs build/compiler on the file with its output discarded; false if it could not be started
+static bool runProcess(const string &compiler, const string &input, const string &output)
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+    vector<string> args = {compiler, input, "-o", output};
+    vector<char *> argv;
+    for (string &a : args)
+        argv.push_back(&a[0]);
+    argv.push_back(NULL);
+    pid_t pid;
+    int status = 0;
+    bool ok = posix_spawn(&pid, compiler.c_str(), &actions, NULL, argv.data(), environ) == 0 &&
+              waitpid(pid, &status, 0) == pid && WIFEXITED(status);
+    posix_spawn_file_actions_destroy(&actions);
+    return ok;
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+#ifdef _WIN32
+    cerr << "The compile server needs Unix domain sockets" << endl;
+    return 0;
+#else
+    string path = argc > 1 ? argv[1] : "build/bench_server_latency_input.txt";
+    int rounds = argc > 2 ? atoi(argv[2]) : 200;
+    if (argc <= 1 && !benchWriteFile(path, benchGenerateProgram(20)))
+    {
+        cerr << "Could not write the generated program" << endl;
+        return 1;
+    }
+    const string compiler = "build/compiler";
+    const string socketPath = "build/bench_server_latency.sock";
+    const string processOutput = "build/bench_server_latency_process.vm";
+    const string serverOutput = "build/bench_server_latency_server.vm";
+    const string localOutput = "build/bench_server_latency_local.vm";
+
+    CompileOptions options;
+    options.checkJobs = 1;
+    CompileServer server(socketPath, options);
+    // this process compiles too, possibly while the server finishes a request
+    server.retainedNames = SIZE_MAX;
+    if (!server.Listen(cerr))
+        return 1;
+    thread serving([&server]() { server.Serve(); });
+
+    printf("input: %s, %d rounds\n", path.c_str(), rounds);
+    vector<double> process, remote, local;
+    for (int round = 0; round < rounds; round++)
+    {
+        ostringstream log;
+        double start = benchNow();
+        if (compileRemote(socketPath, path, NULL, serverOutput, options, log) < 0)
+        {
+            cerr << log.str();
+            break;
+        }
+        remote.push_back(benchNow() - start);
+
+        log.str("");
+        start = benchNow();
+        compileFile(path, localOutput, options, log);
+        local.push_back(benchNow() - start);
+
+        start = benchNow();
+        if (access(compiler.c_str(), X_OK) == 0 && runProcess(compiler, path, processOutput))
+            process.push_back(benchNow() - start);
+    }
+    server.Stop();
+    serving.join();
+
+    double baseline = 0;
+    if (process.empty())
+        printf("  %-16s skipped (run make first)\n", "new process");
+    else
+    {
+        report("new process", process, 0);
+        baseline = process[process.size() / 2];
+    }
+    if (!remote.empty())
+        report("server", remote, baseline);
+    report("in process", local, baseline);
+
+    string expected = readAll(localOutput);
+    if (readAll(serverOutput) != expected || (!process.empty() && readAll(processOutput) != expected))
+        printf("  (VM code differs!)\n");
+    return 0;
+#endif
+}
@@ -0,0 +1,84 @@
+// Traversal cost: the classic Visitor (node->accept + visitor->Visit, two
+// virtual calls per node) versus StaticVisitor (one switch on the node kind,
+// handlers inlined).
+//
+// Both run the same pass: count nodes, identifier occurrences and the sum
+// of integer literals.
+//
+// Usage: bench_static_visitor [source-file]
+// Without an argument two programs are generated: a small one whose tree
+// stays in cache (dispatch cost dominates) and one with 20000 procedures
+// (memory latency dominates).
+
+#include "StaticVisitor.h"
+#include "bench_parse.h"
+#include "bench_util.h"
+#include "count_visitor.h"
+#include <cstdio>
+#include <iostream>
+
+using namespace std;
+
+class StaticCounter : public StaticVisitor<StaticCounter>
+{
+public:
+    using StaticVisitor<StaticCounter>::Visit;
+    PassResult r = {0, 0, 0};
+
+    void Enter(Node *) { r.nodes++; }
+    void Visit(Ident *) { r.idents++; }
+    void Visit(Integer *n) { r.intSum += n->val; }
+};
+
+static int runOne(const string &path, int rounds)
+{
+    CompilationContext ctx;
+    ArenaScope arenaScope(&ctx.arena);
+    if (!benchParse(&ctx, path))
+    {
+        cerr << "Could not compile " << path << endl;
+        return 1;
+    }
+
+    double bestVirtual = 1e30, bestStatic = 1e30;
+    PassResult virtualResult, staticResult;
+    for (int round = 0; round < rounds; round++)
+    {
+        double start = benchNow();
+        CountVisitor v;
+        v.Go(ctx.root);
+        virtualResult = v.r;
+        bestVirtual = min(bestVirtual, benchNow() - start);
+
+        start = benchNow();
+        StaticCounter s;
+        s.Dispatch(ctx.root);
+        staticResult = s.r;
+        bestStatic = min(bestStatic, benchNow() - start);
+    }
+    if (!(virtualResult == staticResult))
+    {
+        cerr << "Visitors disagree: " << virtualResult.nodes << " / " << staticResult.nodes << " nodes" << endl;
+        return 1;
+    }
+
+    printf("input: %s, %ld nodes, best of %d\n", path.c_str(), virtualResult.nodes, rounds);
+    printf("  Visitor (accept + Visit) : %8.3f ms  (%.1f ns/node)\n", bestVirtual * 1000, bestVirtual * 1e9 / virtualResult.nodes);
+    printf("  StaticVisitor (switch)   : %8.3f ms  (%.1f ns/node, %.1fx)\n", bestStatic * 1000, bestStatic * 1e9 / staticResult.nodes, bestVirtual / bestStatic);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1)
+        return runOne(argv[1], 10);
+
+    string small = "build/bench_static_visitor_small.txt";
+    string large = "build/bench_static_visitor_large.txt";
+    if (!benchWriteFile(small, benchGenerateProgram(100)) || !benchWriteFile(large, benchGenerateProgram(20000)))
+    {
+        cerr << "Could not write the generated programs" << endl;
+        return 1;
+    }
+    return runOne(small, 500) || runOne(large, 10);
+}
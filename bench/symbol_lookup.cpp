@@ -0,0 +1,120 @@
+// Variable resolution: the string-keyed lookup the symbol table used before
+// SymbolKey (up to two probes per enclosing scope plus one for the globals,
+// each building a key string) versus the structured key (one probe per
+// scope, no allocation).
+//
+// Every variable reference of the checked program (Var, IdExp, ArrayExp,
+// ArrayElement) is replayed from the scope it appears in, and the probes
+// and time per reference are reported for both lookups.
+//
+// Usage: bench_symbol_lookup [source-file]
+// Without an argument a program with 10000 procedures is generated.
+
+#include "StaticVisitor.h"
+#include "bench_parse.h"
+#include "bench_util.h"
+#include "legacy_symbols.h"
+#include <iostream>
+
+using namespace std;
+
+struct Reference
+{
+    int scope;
+    Ident *id;
+};
+
+// Collects the variable references of the tree, with the index of the
+// scope NameResolver resolved them in (scopes are created in SubDec order)
+class ReferenceCollector : public StaticVisitor<ReferenceCollector>
+{
+public:
+    using StaticVisitor<ReferenceCollector>::Visit;
+    vector<Reference> refs;
+    int scope = 0;
+    int nextScope = 1;
+    NameId function = 0;
+    bool inFunction = false;
+
+    void Enter(Node *) {}
+    void Visit(SubDec *n)
+    {
+        this->scope = this->nextScope++;
+        this->inFunction = isa<Func>(n->subHead);
+        if (this->inFunction)
+            this->function = cast<Func>(n->subHead)->id->nameId;
+        this->Dispatch(n->compStmt);
+        this->scope = 0;
+        this->inFunction = false;
+    }
+    void Visit(Var *n)
+    {
+        // assigning to the function name sets the result, it is no variable
+        if (!(this->inFunction && n->id->nameId == this->function))
+            this->Add(n->id);
+    }
+    void Visit(ArrayElement *n) { this->Add(n->id); this->Dispatch(n->index); }
+    void Visit(IdExp *n) { this->Add(n->id); }
+    void Visit(ArrayExp *n) { this->Add(n->id); this->Dispatch(n->index); }
+
+    void Add(Ident *id) { this->refs.push_back({this->scope, id}); }
+};
+
+int main(int argc, char *argv[])
+{
+    string path = "build/bench_symbol_lookup_input.txt";
+    if (argc > 1)
+        path = argv[1];
+    else if (!benchWriteFile(path, benchGenerateProgram(10000)))
+    {
+        cerr << "Could not write " << path << endl;
+        return 1;
+    }
+
+    CompilationContext ctx;
+    ArenaScope arenaScope(&ctx.arena);
+    if (!benchParse(&ctx, path))
+    {
+        cerr << "Could not parse " << path << endl;
+        return 1;
+    }
+    SymbolTable *st = ctx.symbolTable;
+    ReferenceCollector collector;
+    collector.Dispatch(ctx.root);
+    vector<Reference> &refs = collector.refs;
+    LegacySymbolTable legacy(st);
+
+    const int rounds = 20;
+    long mismatches = 0;
+    double start = benchNow();
+    for (int r = 0; r < rounds; r++)
+        for (const Reference &ref : refs)
+            mismatches += legacy.LookUp(ref.scope, ref.id->nameId) != ctx.annotations.SymbolOf(ref.id);
+    double legacySeconds = benchNow() - start;
+
+    long lookupsBefore = st->lookupCount, probesBefore = st->probeCount;
+    start = benchNow();
+    for (int r = 0; r < rounds; r++)
+        for (const Reference &ref : refs)
+        {
+            Symbol *expected = ctx.annotations.SymbolOf(ref.id);
+            st->currentScope = st->Scopes->at(ref.scope);
+            mismatches += st->LookUpSymbol(ref.id) != expected;
+        }
+    double keySeconds = benchNow() - start;
+    st->currentScope = st->rootScope;
+
+    if (mismatches)
+    {
+        cerr << mismatches << " references resolved differently" << endl;
+        return 1;
+    }
+
+    double n = (double)refs.size() * rounds;
+    printf("%s: %zu variable references, %zu scopes, %d rounds\n", path.c_str(), refs.size(), st->Scopes->size(), rounds);
+    printf("string keys    : %5.2f probes/ref  %6.1f ns/ref\n", legacy.probeCount / n, legacySeconds * 1e9 / n);
+    printf("SymbolKey      : %5.2f probes/ref  %6.1f ns/ref  (%.1fx)\n",
+           (st->probeCount - probesBefore) / n, keySeconds * 1e9 / n, legacySeconds / keySeconds);
+    printf("LookUpSymbol calls during the check: %ld\n", lookupsBefore);
+    return 0;
+}
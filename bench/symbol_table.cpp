@@ -0,0 +1,153 @@
+// Scope hash tables: the legacy fixed-size CHashTable (hash_table.h) versus
+// the growable FlatHashMap the symbol table now uses.
+//
+// The program is parsed and checked, then every scope's entries are copied
+// into a fresh table of each kind. Memory is the live heap growth while the
+// copies are built (glibc mallinfo2), lookup latency is measured over the
+// same keys in random order, once as hits and once as misses (the same name
+// in another name space). The legacy table is keyed by the strings the
+// symbol table used before SymbolKey (see legacy_symbols.h).
+//
+// Usage: bench_symbol_table [source-file]
+// Without an argument a program with 10000 procedures is generated.
+
+#include "SymbolTable.h"
+#include "bench_parse.h"
+#include "bench_util.h"
+#include "legacy_symbols.h"
+#include <algorithm>
+#include <cstring> // hash_table.h uses memset without including it
+#include "hash_table.h"
+#include <iostream>
+#include <malloc.h>
+#include <random>
+
+using namespace std;
+
+// Bytes currently allocated from the heap
+static size_t liveHeapBytes()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+struct Probe
+{
+    size_t scope;
+    SymbolKey key;
+    string legacyKey;
+};
+
+// Nanoseconds per lookup over all probes, and the number found
+template <class Lookup>
+static double timeLookups(const vector<Probe> &probes, int rounds, Lookup lookup, long &found)
+{
+    found = 0;
+    double start = benchNow();
+    for (int r = 0; r < rounds; r++)
+        for (const Probe &p : probes)
+            found += lookup(p) != NULL;
+    found /= rounds;
+    return (benchNow() - start) * 1e9 / ((double)probes.size() * rounds);
+}
+
+int main(int argc, char *argv[])
+{
+    string path = "build/bench_symbol_table_input.txt";
+    if (argc > 1)
+        path = argv[1];
+    else if (!benchWriteFile(path, benchGenerateProgram(10000)))
+    {
+        cerr << "Could not write " << path << endl;
+        return 1;
+    }
+
+    CompilationContext ctx;
+    ArenaScope arenaScope(&ctx.arena);
+    double start = benchNow();
+    if (!benchParse(&ctx, path))
+    {
+        cerr << "Could not parse " << path << endl;
+        return 1;
+    }
+    double checkSeconds = benchNow() - start;
+    vector<Scope *> &scopes = *ctx.symbolTable->Scopes;
+
+    vector<Probe> hits, misses;
+    for (size_t i = 0; i < scopes.size(); i++)
+        scopes[i]->hashTab->ForEach([&](const SymbolKey &key, Symbol *sym)
+                                    {
+                                        string legacyKey = legacySymbolKey(sym);
+                                        hits.push_back({i, key, legacyKey});
+                                        SymbolKey other(key.nameId, key.ns == NS_VAR ? NS_FUNC : NS_VAR);
+                                        legacyKey[0] = legacyKey[0] == 'l' ? 'r' : 'l';
+                                        misses.push_back({i, other, legacyKey}); });
+    mt19937 rng(42);
+    shuffle(hits.begin(), hits.end(), rng);
+    shuffle(misses.begin(), misses.end(), rng);
+
+    // Copies of every scope in the legacy table
+    size_t before = liveHeapBytes();
+    vector<CHashTable<Symbol> *> legacy;
+    for (Scope *s : scopes)
+    {
+        CHashTable<Symbol> *t = new CHashTable<Symbol>();
+        s->hashTab->ForEach([t](const SymbolKey &, Symbol *sym)
+                            { t->AddKey(legacySymbolKey(sym), sym); });
+        legacy.push_back(t);
+    }
+    size_t legacyBytes = liveHeapBytes() - before;
+
+    // ... and in the flat map
+    before = liveHeapBytes();
+    vector<HashTable *> flat;
+    size_t flatOwnBytes = 0;
+    for (Scope *s : scopes)
+    {
+        HashTable *t = new HashTable();
+        s->hashTab->ForEach([t](const SymbolKey &key, Symbol *sym)
+                            { t->Insert(key, sym); });
+        flatOwnBytes += t->MemoryBytes();
+        flat.push_back(t);
+    }
+    size_t flatBytes = liveHeapBytes() - before;
+
+    const int rounds = 20;
+    long legacyHits, legacyMisses, flatHits, flatMisses;
+    auto legacyLookup = [&](const Probe &p)
+    { return legacy[p.scope]->GetMember(p.legacyKey); };
+    auto flatLookup = [&](const Probe &p)
+    { return flat[p.scope]->Get(p.key); };
+    double legacyHitNs = timeLookups(hits, rounds, legacyLookup, legacyHits);
+    double legacyMissNs = timeLookups(misses, rounds, legacyLookup, legacyMisses);
+    double flatHitNs = timeLookups(hits, rounds, flatLookup, flatHits);
+    double flatMissNs = timeLookups(misses, rounds, flatLookup, flatMisses);
+
+    if (legacyHits != flatHits || legacyMisses != flatMisses || flatHits != (long)hits.size())
+    {
+        cerr << "Tables disagree" << endl;
+        return 1;
+    }
+
+    printf("%s: %zu scopes, %zu symbols, parse+check %.1f ms\n",
+           path.c_str(), scopes.size(), hits.size(), checkSeconds * 1e3);
+    if (legacyBytes == 0)
+        printf("heap usage not available (needs glibc 2.33+)\n");
+    else
+    {
+        printf("CHashTable    %10.1f KB total  %8.1f B/scope\n", legacyBytes / 1024.0, (double)legacyBytes / scopes.size());
+        printf("FlatHashMap   %10.1f KB total  %8.1f B/scope  (slot arrays %.1f KB)\n",
+               flatBytes / 1024.0, (double)flatBytes / scopes.size(), flatOwnBytes / 1024.0);
+    }
+    printf("lookup hit    CHashTable %6.1f ns  FlatHashMap %6.1f ns\n", legacyHitNs, flatHitNs);
+    printf("lookup miss   CHashTable %6.1f ns  FlatHashMap %6.1f ns  (%ld misses found)\n", legacyMissNs, flatMissNs, flatMisses);
+
+    for (auto *t : legacy)
+        delete t;
+    for (auto *t : flat)
+        delete t;
+    return 0;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file Annotations.h
+ * @brief Side tables holding what semantic analysis learns about each node
+ *
+ * This header defines the per-node results of name resolution and type
+ * checking: the inferred type, where integers are converted to reals, and
+ * the symbol an identifier was resolved to. They are kept out of the node
+ * classes, in struct-of-arrays tables indexed by node ID. IDs are handed
+ * out in pre-order, the order every pass walks the tree, so a later pass
+ * reads each table front to back, and the tables can be kept or written
+ * out without the AST.
+ *
+ * Key components include:
+ * - AnnotationFlag: Implicit conversions and operand kinds of a node
+ * - Annotations: The tables and the numbering of the nodes
+ */
+#ifndef ANNOTATIONS_H
+#define ANNOTATIONS_H
+
+#include "ast.h"
+#include "CommonTypes.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @enum AnnotationFlag
+ * @brief Facts about a node recorded for the later passes
+ */
+enum AnnotationFlag
+{
+    ITOF_LEFT = 1,    ///< The left operand is converted from integer to real (ITOF)
+    ITOF_RIGHT = 2,   ///< The right operand is converted from integer to real (ITOF)
+    REAL_OPERANDS = 4, ///< A comparison of reals (after conversion)
+    CACHED = 8,        ///< A subprogram whose warnings and code come from the CompileCache
+    IN_BOUNDS = 16     ///< An array access whose index is always within bounds (-O, see RangeAnalysis)
+};
+
+/**
+ * @class Annotations
+ * @brief Struct-of-arrays tables of per-node semantic information
+ *
+ * Every table has one entry per numbered node. Nodes not numbered (such
+ * as the identifiers of the built-in procedures) have no entries and must
+ * not be looked up.
+ */
+class Annotations
+{
+public:
+    vector<uint8_t> types;    ///< TypeEnum of each expression and assigned variable (VOID for other nodes)
+    vector<uint8_t> flags;    ///< AnnotationFlag bits of each node
+    vector<Symbol *> symbols; ///< Symbol each identifier denotes (NULL if unresolved or not an identifier)
+
+    /**
+     * @brief Numbers the nodes of a tree in pre-order and sizes the tables for them
+     * @param root Root of the tree
+     * @return Number of nodes
+     */
+    size_t Number(Node *root);
+    /**
+     * @brief Numbers one node created after Number, appending a row for it
+     * @return The node's ID
+     */
+    NodeId Add(Node *n);
+
+    /**
+     * @brief Returns the number of rows
+     */
+    size_t Size() const { return this->types.size(); }
+    /**
+     * @brief Returns the bytes held by the tables
+     */
+    size_t MemoryBytes() const;
+
+    /**
+     * @brief Returns the type inferred for a node
+     */
+    TypeEnum TypeOf(const Node *n) const { return (TypeEnum)this->types[n->nodeId]; }
+    /**
+     * @brief Records the type inferred for a node
+     */
+    void SetType(const Node *n, TypeEnum t) { this->types[n->nodeId] = (uint8_t)t; }
+    /**
+     * @brief Returns the AnnotationFlag bits of a node
+     */
+    unsigned FlagsOf(const Node *n) const { return this->flags[n->nodeId]; }
+    /**
+     * @brief Replaces the AnnotationFlag bits of a node
+     */
+    void SetFlags(const Node *n, unsigned f) { this->flags[n->nodeId] = (uint8_t)f; }
+    /**
+     * @brief Returns the symbol an identifier was resolved to (NULL if none)
+     */
+    Symbol *SymbolOf(const Node *n) const { return this->symbols[n->nodeId]; }
+    /**
+     * @brief Records the symbol an identifier was resolved to
+     */
+    void SetSymbol(const Node *n, Symbol *sym) { this->symbols[n->nodeId] = sym; }
+};
+
+#endif
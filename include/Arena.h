@@ -0,0 +1,139 @@
+/**
+ * @file Arena.h
+ * @brief Bump-pointer arena for the AST of one compilation
+ *
+ * This header defines the region allocator that backs every AST node and
+ * node list of a compilation. Allocation is a pointer bump inside large
+ * blocks; nothing is freed individually, and the whole region is released
+ * at once when the owning CompilationContext is destroyed.
+ *
+ * Objects placed in the arena never have their destructors run, so only
+ * types whose memory is entirely arena-owned (nodes, NodeList) live there.
+ *
+ * Key components include:
+ * - Arena: The block list and bump pointer
+ * - ArenaScope: Makes an arena the current one for node allocation on this thread
+ * - ArenaAllocator: STL allocator drawing from an arena, for node child lists
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class Arena
+ * @brief A bump-pointer region allocator released in one bulk free
+ */
+class Arena
+{
+public:
+    /**
+     * @brief Constructor for Arena
+     * @param blockSize Size of the blocks carved up by Allocate
+     */
+    Arena(size_t blockSize = 64 * 1024);
+    /**
+     * @brief Destructor, frees every block at once
+     */
+    ~Arena();
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    /**
+     * @brief Allocates memory that lives until the arena is destroyed
+     * @param size Number of bytes
+     * @param align Alignment (a power of two)
+     * @return The allocated memory (never NULL)
+     */
+    void *Allocate(size_t size, size_t align = alignof(max_align_t));
+    /**
+     * @brief Returns the number of bytes handed out so far
+     */
+    size_t BytesUsed() const;
+    /**
+     * @brief Returns the number of bytes reserved from the system
+     */
+    size_t BytesReserved() const;
+
+    /**
+     * @brief Returns the arena nodes are allocated from on this thread, or NULL
+     */
+    static Arena *Current();
+
+private:
+    friend class ArenaScope;
+
+    vector<char *> blocks; ///< Every block obtained from the system
+    char *cursor;          ///< Next free byte in the current block
+    char *limit;           ///< End of the current block
+    size_t blockSize;      ///< Size of regular blocks
+    size_t used;           ///< Bytes handed out
+    size_t reserved;       ///< Bytes obtained from the system
+};
+
+/**
+ * @class ArenaScope
+ * @brief Makes an arena current on this thread for its lifetime
+ *
+ * Node::operator new allocates from the current arena; the driver opens a
+ * scope around everything that builds nodes for a compilation.
+ */
+class ArenaScope
+{
+public:
+    /**
+     * @brief Constructor, makes `arena` current
+     * @param arena The arena to allocate nodes from
+     */
+    ArenaScope(Arena *arena);
+    /**
+     * @brief Destructor, restores the previously current arena
+     */
+    ~ArenaScope();
+
+private:
+    Arena *previous; ///< Arena that was current before this scope
+};
+
+/**
+ * @class ArenaAllocator
+ * @brief STL allocator drawing from an arena
+ *
+ * Deallocation is a no-op: the memory is reclaimed with the arena. Without
+ * an arena (NULL) it falls back to the global heap.
+ */
+template <class T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+
+    Arena *arena; ///< Where memory comes from (NULL for the heap)
+
+    ArenaAllocator(Arena *a = Arena::Current()) : arena(a) {}
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n)
+    {
+        if (this->arena)
+            return (T *)this->arena->Allocate(n * sizeof(T), alignof(T));
+        return (T *)::operator new(n * sizeof(T));
+    }
+    void deallocate(T *p, size_t)
+    {
+        if (!this->arena)
+            ::operator delete(p);
+    }
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U> &other) const { return this->arena == other.arena; }
+    template <class U>
+    bool operator!=(const ArenaAllocator<U> &other) const { return this->arena != other.arena; }
+};
+
+#endif
@@ -19,6 +19,40 @@ enum TypeEnum
 };
 
 
+/**
+ * @enum SymbolKind
+ * @brief Represents The kind of symbols (local variable, global variable, function, pocedure, parameter)
+ */
+enum SymbolKind
+{
+    PARAM_VAR = 1,  ///< parameter variable
+    GLOBAL_VAR = 2, ///< global variable
+    LOCAL_VAR = 3,  ///< local variables for functions
+    FUNC = 4,       ///< function symbol
+    PROC = 5        ///< procedure symbol
+};
+
+/**
+ * @struct VarAddress
+ * @brief Where a variable lives: its kind, the depth of its scope and its offset
+ *
+ * NameResolver stores it in every identifier naming a variable, so later
+ * passes address the variable without going back to the symbol table.
+ */
+struct VarAddress
+{
+    SymbolKind kind; ///< PARAM_VAR, GLOBAL_VAR or LOCAL_VAR (0 while unbound)
+    int depth;       ///< Nesting depth of the declaring scope, 0 for globals
+    int offset;      ///< Offset in the global area (depth 0) or from the frame pointer
+
+    VarAddress() : kind((SymbolKind)0), depth(0), offset(0) {}
+    VarAddress(SymbolKind k, int d, int o) : kind(k), depth(d), offset(o) {}
+    /**
+     * @brief Whether the address was bound to a variable
+     */
+    bool IsBound() const { return this->kind != 0; }
+};
+
 
 inline std::string TypeEnumToString(TypeEnum t){
     switch (t)
@@ -0,0 +1,55 @@
+/**
+ * @file CompilationContext.h
+ * @brief Per-compilation state shared by the scanner, parser and semantic passes
+ *
+ * This header defines the context object that owns everything a single
+ * compilation produces. The scanner and parser are reentrant and receive the
+ * context explicitly, so several compilations can run in one process (and on
+ * different threads) without sharing any state.
+ *
+ * Key components include:
+ * - CompilationContext: AST root, its arena and annotations, symbol table, error list and scanner position
+ */
+#ifndef COMPILATION_CONTEXT_H
+#define COMPILATION_CONTEXT_H
+
+#include "ast.h"
+#include "Annotations.h"
+#include "Arena.h"
+#include "Error.h"
+#include <ostream>
+
+/**
+ * @class CompilationContext
+ * @brief Owns the state of one compilation
+ *
+ * Created by the driver for every source file, passed to the scanner as its
+ * extra data and to the parser as a parse parameter, then handed to the
+ * semantic analysis and code generation passes. Nodes built while the
+ * context's arena is current (see ArenaScope) are released with the context.
+ */
+class CompilationContext
+{
+public:
+    Arena arena;              ///< Holds the AST; freed in one go with the context
+    Prog *root;               ///< Root of the AST (NULL until parsing succeeds)
+    Annotations annotations;  ///< Types and symbols inferred for the nodes of root
+    SymbolTable *symbolTable; ///< Symbol table of this compilation
+    Errors *errors;           ///< Errors and warnings reported by this compilation
+    int lin;                  ///< Current scanner line (0-based)
+    int col;                  ///< Current scanner column
+    std::ostream *log;        ///< Where diagnostics and progress messages go (stdout by default)
+
+    /**
+     * @brief Constructor for CompilationContext
+     *
+     * Creates an empty error list and a symbol table reporting into it.
+     */
+    CompilationContext();
+    /**
+     * @brief Destructor, releases the symbol table and the error list
+     */
+    ~CompilationContext();
+};
+
+#endif
@@ -0,0 +1,142 @@
+/**
+ * @file CompileCache.h
+ * @brief On-disk cache of the code generated for each subprogram
+ *
+ * This header defines the incremental compilation cache. Every subprogram
+ * gets a key hashed from its source lines, the global declarations and the
+ * signatures of the subprograms it names. A subprogram whose key is found
+ * in the cache is neither resolved, checked nor translated again: its
+ * warnings are replayed and its stored VM code is spliced into the output.
+ * The code of the others is stored once the program compiles.
+ *
+ * Key components include:
+ * - CachedSubprogram: What one subprogram contributes to the compilation
+ * - CompileCache: Computes the keys, loads, splices and stores the entries
+ */
+#ifndef COMPILE_CACHE_H
+#define COMPILE_CACHE_H
+
+#include "Error.h"
+#include "FlatHashMap.h"
+#include "InstructionBuffer.h"
+#include "ast.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+class CompilationContext;
+
+/**
+ * @struct CachedSubprogram
+ * @brief The warnings and code of one subprogram, as stored in the cache
+ *
+ * Diagnostic lines are relative to the line of the subprogram's name and
+ * generated labels ("L<n>") are numbered from 0, so an entry can be reused
+ * wherever the subprogram moves in the file.
+ */
+struct CachedSubprogram
+{
+    uint64_t key;                   ///< Hash of everything the code depends on
+    bool hit;                       ///< Found in the cache (otherwise generated by this compilation)
+    int firstLine;                  ///< Line of the subprogram's name (1-based)
+    vector<Diagnostic> warnings;    ///< Warnings added to the error list (lines relative to firstLine)
+    vector<Diagnostic> logWarnings; ///< Warnings printed inline to the log while checking (same)
+    unsigned labels;                ///< Number of generated labels the code defines
+    vector<VMInstr> code;           ///< The generated code (empty for a hit, whose code stays in the pack)
+    size_t packOffset;              ///< A hit: where its entry starts in the pack
+    size_t packLength;              ///< A hit: the size of its entry
+    size_t codeOffset;              ///< A hit: where its code starts in the pack
+    size_t codeLines;               ///< A hit: number of lines of its code
+};
+
+/**
+ * @class CompileCache
+ * @brief The cached subprograms of one source file
+ *
+ * The entries of a file are kept together in one pack file in the cache
+ * directory: an index of keys followed by the entries. A warm compilation
+ * therefore reads one file and writes at most one, however many
+ * subprograms it has. Lookup reads the index and flags the subprograms it
+ * lists CACHED in the annotations; the passes skip their bodies and ask the
+ * cache for their warnings and code, which is parsed straight from the pack
+ * into the output. The passes record the warnings and code of the other
+ * subprograms, and Store replaces the pack with the entries of this
+ * compilation, copying those it found. Store is only called for a program
+ * that compiled without errors.
+ */
+class CompileCache
+{
+public:
+    string directory;                     ///< Where the packs are kept
+    string configuration;                 ///< Mixed into every key: whatever besides the source changes the code
+    vector<CachedSubprogram> subprograms; ///< One per subprogram of the program, in order
+    size_t hits;                          ///< Subprograms found in the cache
+
+    /**
+     * @brief Constructor for CompileCache
+     * @param directory Cache directory, created when the first pack is stored
+     * @param sourceFile The source file being compiled, which names its pack
+     * @param configuration Compiler settings that affect the generated code
+     */
+    CompileCache(const string &directory, const string &sourceFile, const string &configuration = "");
+
+    /**
+     * @brief Computes the key of every subprogram and looks it up in the pack
+     * @param ctx A parsed compilation whose nodes are numbered
+     * @param source The text the program was parsed from
+     * @return Number of subprograms found in the cache
+     */
+    size_t Lookup(CompilationContext *ctx, const string &source);
+    /**
+     * @brief Returns the entry of a subprogram (NULL if Lookup did not see it)
+     */
+    CachedSubprogram *Find(const SubDec *n);
+    /**
+     * @brief Appends the cached code of a subprogram, renumbering its labels after the ones in use
+     * @param n A subprogram found in the cache
+     * @param code Buffer to append to
+     * @param labelCount Labels generated so far; advanced past the ones of the block
+     */
+    void AppendCode(const SubDec *n, InstructionBuffer &code, int &labelCount);
+    /**
+     * @brief Records the warnings reported while checking a subprogram
+     * @param n The subprogram
+     * @param warnings The error list's warnings
+     * @param first Index of the subprogram's first warning in that list
+     * @param logWarnings The warnings it printed inline to the log
+     */
+    void RecordWarnings(const SubDec *n, const vector<Diagnostic> &warnings, size_t first,
+                        const vector<Diagnostic> &logWarnings);
+    /**
+     * @brief Records the code just generated for a subprogram
+     * @param n The subprogram
+     * @param code Buffer holding the code
+     * @param first Index of the subprogram's first line in the buffer
+     * @param firstLabel Number of its first generated label
+     * @param labelCount Labels generated so far (one past its last label)
+     */
+    void RecordCode(const SubDec *n, const InstructionBuffer &code, size_t first, int firstLabel, int labelCount);
+    /**
+     * @brief Replaces the pack with the entries of this compilation, unless it holds exactly those already
+     * @return true if the pack is up to date
+     */
+    bool Store() const;
+
+private:
+    string packPath;                   ///< File holding the entries of the source file
+    string pack;                       ///< Contents of the pack as read by Lookup
+    size_t packEntries;                ///< Entries listed in its index
+    FlatHashMap<NodeId, size_t> index; ///< Position in subprograms of each SubDec, by node ID
+
+    // Reads the pack and its index; returns the offset and size of each entry by key
+    void readPack(FlatHashMap<uint64_t, pair<size_t, size_t>> &entries);
+
+    // Reads the labels and warnings of a hit; false if its entry is damaged
+    bool readEntry(CachedSubprogram &entry) const;
+};
+
+#endif
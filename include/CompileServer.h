@@ -0,0 +1,113 @@
+/**
+ * @file CompileServer.h
+ * @brief Compile server on a Unix domain socket, and its client
+ *
+ * This header defines a long-running compiler process for tools that
+ * compile many small programs (editors, test harnesses). Requests name a
+ * source file or carry the source text, plus the output file; the server
+ * compiles them with compileFile/compileSource and sends back the status
+ * and everything the compilation printed. A warm server skips the process
+ * startup, and the built-in procedures, the interned names and the heap are
+ * already set up when a request arrives. Every request releases what it
+ * allocated, and the names interned by past requests are forgotten when the
+ * server is idle and holds too many, so the process does not grow with the
+ * number of requests it has served.
+ *
+ * Key components include:
+ * - CompileServer: Listens on the socket and compiles each request on its own thread
+ * - compileRemote: Sends one request to a server and prints its reply
+ */
+#ifndef COMPILE_SERVER_H
+#define COMPILE_SERVER_H
+
+#include "Compiler.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+using namespace std;
+
+class ThreadPool;
+
+/**
+ * @class CompileServer
+ * @brief A compiler serving requests on a Unix domain socket
+ *
+ * Every connection carries one request and its reply. Connections are
+ * handled on threads of their own, so a large program does not hold up
+ * the others, up to 64 at once; a connection that sends or takes nothing
+ * for 30 seconds is dropped, so an idle client cannot keep a thread or
+ * delay Stop. The bodies of large programs are checked on a pool shared by
+ * all requests (options.checkJobs threads), as in batch mode. A request
+ * chooses its own --max-errors, --time-report, --no-mmap and --cache.
+ */
+class CompileServer
+{
+public:
+    string socketPath;      ///< Where the socket is created
+    CompileOptions options; ///< Options of every request, apart from the ones it chooses
+    atomic<size_t> served;  ///< Requests answered so far
+    size_t retainedNames;   ///< Names interned by requests kept while idle (SIZE_MAX: all, for a process
+                            ///< that also compiles outside the server while it serves)
+
+    /**
+     * @brief Constructor for CompileServer
+     * @param socketPath Path of the socket to create
+     * @param options Defaults for the requests; checkJobs sizes the shared pool
+     */
+    CompileServer(const string &socketPath, const CompileOptions &options);
+    /**
+     * @brief Destructor, closes the socket if Serve did not
+     */
+    ~CompileServer();
+
+    /**
+     * @brief Creates the socket, replacing a stale one left by a server that died
+     * @param log Receives the reason on failure
+     * @return false if the socket cannot be created or another server is using it
+     */
+    bool Listen(ostream &log);
+    /**
+     * @brief Answers requests until Stop is called, then waits for the ones in progress and removes the socket
+     */
+    void Serve();
+    /**
+     * @brief Makes Serve return; safe to call from a signal handler
+     */
+    void Stop();
+
+private:
+    int listenFd;               ///< The listening socket (-1 if none)
+    int stopPipe[2];            ///< Stop writes to [1] to wake Serve, which polls [0]
+    ThreadPool *pool;           ///< Checks the bodies of large programs for all requests
+    mutex activeLock;           ///< Guards active
+    condition_variable idle;    ///< Signalled when a request finishes
+    unsigned active;            ///< Requests being compiled
+    size_t startupNames;        ///< Names interned before the first request (the built-ins'), always kept
+
+    // Reads one request from a connection, compiles it and replies
+    void handle(int fd);
+    // Forgets the names interned by requests if there are more than retainedNames; activeLock held, none active
+    void forgetNames();
+};
+
+/**
+ * @brief Compiles a file (or source text) on a running server
+ *
+ * Paths are made absolute first, since the server has its own working directory.
+ * @param socketPath The server's socket
+ * @param inputFilename Source file, or the name of `text` (may be empty)
+ * @param text Source text to compile instead of reading the file (NULL: read the file)
+ * @param outputFilename Where the server writes the VM code
+ * @param options The request's --max-errors, --time-report, --no-mmap and --cache
+ * @param log Receives what the compilation printed
+ * @return The compilation's status (0 or 1), or -1 if the server could not be reached
+ */
+int compileRemote(const string &socketPath, const string &inputFilename, const string *text,
+                  const string &outputFilename, const CompileOptions &options, ostream &log);
+
+#endif
@@ -0,0 +1,76 @@
+/**
+ * @file Compiler.h
+ * @brief Driver entry point that compiles one source file end to end
+ *
+ * This header declares the function that runs the whole pipeline (scanning,
+ * parsing, semantic analysis and code generation) for a single source file.
+ * All state lives in a CompilationContext owned by the call, so several files
+ * can be compiled concurrently on different threads.
+ *
+ * Key components include:
+ * - CompileOptions: Switches that affect a single compilation
+ * - compileFile: Compiles one file into a VM program
+ * - compileSource: Compiles source text held in memory
+ * - initializeBuiltInFunctions: Registers the built-in procedures
+ */
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <ostream>
+#include <string>
+
+using namespace std;
+
+class SymbolTable;
+class ThreadPool;
+
+/**
+ * @struct CompileOptions
+ * @brief Switches that affect a single compilation
+ */
+struct CompileOptions
+{
+    bool useMmap;       ///< Scan source files in place from a memory mapping
+    bool timeReport;    ///< Print per-phase time and memory statistics (--time-report)
+    unsigned checkJobs; ///< Threads checking subprogram bodies when no pool is given (1: serially)
+    ThreadPool *pool;   ///< Pool shared with the caller for checking subprogram bodies, e.g. the batch pool (NULL: none)
+    size_t maxErrors;   ///< Stop analysis after this many errors (--max-errors, 0: no limit)
+    string cacheDir;    ///< Directory of the per-subprogram compilation cache (--cache, empty: no cache)
+    bool optimize;      ///< Run the optimizations (-O)
+
+    /**
+     * @brief Constructor for CompileOptions, sets the defaults
+     */
+    CompileOptions() : useMmap(true), timeReport(false), checkJobs(1), pool(NULL), maxErrors(0), optimize(false) {}
+};
+
+/**
+ * @brief Registers the built-in procedures (write) in a symbol table
+ * @param st The symbol table to fill
+ */
+void initializeBuiltInFunctions(SymbolTable *st);
+
+/**
+ * @brief Compiles one source file
+ * @param inputFilename Source file to compile (empty to read standard input)
+ * @param outputFilename Where the generated VM code is written
+ * @param options Compilation switches
+ * @param log Stream that receives the diagnostics and progress messages
+ * @return 0 on success, 1 if the file could not be read, parsed or checked
+ */
+int compileFile(const string &inputFilename, const string &outputFilename,
+                const CompileOptions &options, ostream &log);
+
+/**
+ * @brief Compiles source text held in memory, e.g. an editor buffer
+ * @param name Name of the source, used in reports and to name its cache pack (may be empty)
+ * @param text The source text
+ * @param outputFilename Where the generated VM code is written
+ * @param options Compilation switches
+ * @param log Stream that receives the diagnostics and progress messages
+ * @return 0 on success, 1 if the source could not be parsed or checked
+ */
+int compileSource(const string &name, const string &text, const string &outputFilename,
+                  const CompileOptions &options, ostream &log);
+
+#endif
@@ -0,0 +1,119 @@
+/**
+ * @file ConstantFolder.h
+ * @brief Constant folding and propagation over the checked AST
+ *
+ * This header defines the pass that runs between type checking and code
+ * generation under -O. It replaces operators whose operands are literals
+ * with the literal they evaluate to, and the uses of a local variable that
+ * is assigned a constant once, and never again, with that constant. New
+ * literals get rows in the Annotations with the type of the expression
+ * they replace, so the conversions the type checker recorded on the
+ * enclosing operators stay valid.
+ *
+ * An expression is only folded when the VM is sure to compute the same
+ * value: integer results must fit in 32 bits, divisions by zero are left
+ * to fail at run time, and real arithmetic is folded only when the
+ * operands and the result are exact in single precision and survive the
+ * text form PUSHF writes them in. `e and false` and `e or true` become a
+ * literal only when e can neither fault nor call (see mayTrap).
+ *
+ * Key components include:
+ * - ConstantFolder: The pass
+ */
+#ifndef CONSTANT_FOLDER_H
+#define CONSTANT_FOLDER_H
+
+#include "Annotations.h"
+#include "FlatHashMap.h"
+#include "StaticVisitor.h"
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * @class ConstantFolder
+ * @brief Rewrites constant expressions of a checked program into literals
+ *
+ * Statements are visited in order and their expressions are replaced in
+ * place, bottom up. Propagation is limited to the locals of a subprogram
+ * whose only assignment is a statement of the body's outermost statement
+ * list, of the variable's own type: the uses in the statements after it
+ * all see that value. Globals are never propagated, since any call may
+ * assign them.
+ */
+class ConstantFolder : public StaticVisitor<ConstantFolder>
+{
+public:
+    using StaticVisitor<ConstantFolder>::Visit;
+
+    size_t folded;     ///< Operators replaced by a literal
+    size_t propagated; ///< Uses of a constant local replaced by a literal
+
+    /**
+     * @brief Constructor for ConstantFolder
+     * @param annotations The types and symbols of a checked program, which receive rows for the new literals
+     */
+    ConstantFolder(Annotations *annotations);
+
+    /**
+     * @brief No per-node work, required by StaticVisitor
+     */
+    void Enter(Node *) {}
+    /**
+     * @brief Folds a subprogram body and propagates its constant locals (unless it comes from the cache)
+     */
+    void Visit(SubDec *n);
+    /**
+     * @brief Folds the value and, for an array element, the index
+     */
+    void Visit(Assign *n);
+    /**
+     * @brief Folds the arguments
+     */
+    void Visit(ProcStmt *n);
+    /**
+     * @brief Folds the condition
+     */
+    void Visit(IfThen *n);
+    /**
+     * @brief Folds the condition
+     */
+    void Visit(IfThenElse *n);
+    /**
+     * @brief Folds the condition
+     */
+    void Visit(While *n);
+
+private:
+    /**
+     * @struct Constant
+     * @brief The value of a literal, as the VM reads it
+     */
+    struct Constant
+    {
+        TypeEnum type; ///< INTTYPE, REALTYPE or BOOLTYPE
+        long long i;   ///< Value of an integer or boolean
+        double r;      ///< Value of a real
+    };
+
+    Annotations *annotations;               ///< Types, symbols and flags of the program
+    FlatHashMap<Symbol *, int> assignments; ///< Number of assignments to each local of the body being folded
+    FlatHashMap<Symbol *, Constant> values; ///< Locals of the body known to hold a constant from here on
+
+    // Folds an expression bottom up and returns what replaces it
+    Exp *fold(Exp *e);
+    // Folds the arguments of a call
+    void foldAll(ExpList *list);
+    // Folds an operator whose operands are folded already; NULL if it is not constant
+    Exp *foldBinary(BinOp *b);
+    // Reads a literal; false if e is not one
+    bool constantOf(Exp *e, Constant &c);
+    // Converts an integer operand to real as ITOF does; false if the VM could round it
+    bool toReal(Constant &c);
+    // Creates the literal of a value, typed and placed like the expression it replaces
+    Exp *literal(Exp *replaced, const Constant &c);
+    // Records the constant a statement of the outermost list assigns to a local, if any
+    void recordConstant(Stmt *s);
+};
+
+#endif
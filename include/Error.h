@@ -8,34 +8,31 @@
  * of errors that can be reported to the user.
  *
  * Key components include:
- * - Error: Individual error representation with message and location
+ * - Diagnostic: Individual error / warning with message and location
  * - Errors: Error collection manager for accumulating and displaying errors
  */
 #ifndef ERROR_H
 #define ERROR_H
 
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <unordered_set>
 #include <vector>
-#include "ast.h"
 using namespace std;
 
 /**
- * @class Error
- * @brief Represents a single compilation error / warning 
- * 
- * Extends the Node class to capture error information including
- * the error message and source location where the error occurred.
+ * @struct Diagnostic
+ * @brief Represents a single compilation error / warning
+ *
+ * A plain record stored by value in its collection: no AST node, no
+ * vtable and no separate allocation besides the message.
  */
-class Error : public Node
+struct Diagnostic
 {
-public:
 	string Message; ///< The error message describing what went wrong
-	/**
-	 * @brief Constructor for Error
-	 * @param message The error message describing the issue
-	 * @param lin Line number in source code where error occurred
-	 * @param col Column number in source code where error occurred
-	 */
-	Error(string message, int lin, int col);
+	int line;		///< Line number in source code where the diagnostic was reported
+	int column;		///< Column number in source code where the diagnostic was reported
 };
 
 /**
@@ -44,12 +41,17 @@ public:
  * 
  * Provides functionality to accumulate multiple errors during compilation
  * and display them all at once to provide comprehensive error reporting.
+ * A diagnostic identical to one already reported (same message and
+ * position) is dropped, and once maxErrors errors are kept further errors
+ * are dropped too and the passes stop early (see LimitReached).
  */
 class Errors
 {
 public:
-	vector<Error *> *errorStack; ///< Collection of errors encountered during compilation
-	vector<Error *> *warningsStack; ///< Collection of warnings encountered during compilation
+	vector<Diagnostic> errorStack;	  ///< Collection of errors encountered during compilation
+	vector<Diagnostic> warningsStack; ///< Collection of warnings encountered during compilation
+	size_t maxErrors;				  ///< Number of errors after which analysis stops (0: no limit)
+	size_t duplicates;				  ///< Diagnostics dropped because they repeated an earlier one
 	/**
 	 * @brief Constructor for Errors
 	 * 
@@ -70,19 +72,38 @@ public:
 	 * @param col Column number in source code where error occurred
 	 */
 	void AddWarning(string message, int lin, int col);
+	/**
+	 * @brief Moves the errors and warnings of another collection to the end of this one
+	 *
+	 * They are added one by one, so duplicates and the error limit apply.
+	 * @param other The collection to empty into this one
+	 */
+	void Append(Errors &other);
+	/**
+	 * @brief Whether maxErrors errors have been reported, so analysis should stop
+	 */
+	bool LimitReached() const { return this->maxErrors != 0 && this->errorStack.size() >= this->maxErrors; }
 	/**
 	 * @brief Prints all accumulated warnings to output
 	 * 
 	 * Displays all warnings in the collection with their associated
 	 * line and column information for debugging purposes.
+	 * @param out Stream to print to
 	 */
-	void PrintWarnings();
+	void PrintWarnings(ostream &out = cout);
 	/**
 	 * @brief Prints all accumulated errors to output
 	 * 
 	 * Displays all errors in the collection with their associated
 	 * line and column information for debugging purposes.
+	 * @param out Stream to print to
 	 */
-	void PrintErrors();
+	void PrintErrors(ostream &out = cout);
+
+private:
+	unordered_set<string> seen; ///< Position and message of every diagnostic kept, to drop repeats
+
+	// Records a diagnostic as seen, returns false if it was seen before
+	bool FirstReport(char severity, const string &message, int lin, int col);
 };
-#endif
\ No newline at end of file
+#endif
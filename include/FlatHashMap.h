@@ -0,0 +1,205 @@
+/**
+ * @file FlatHashMap.h
+ * @brief Growable open-addressing hash map used for the scopes of the symbol table
+ *
+ * This header defines a small hash map that stores its entries inline in one
+ * array and resolves collisions by linear probing. It starts with a handful
+ * of slots and doubles when it gets too full, so a scope holding three
+ * symbols costs a few hundred bytes instead of a fixed bucket array sized
+ * for thousands of entries.
+ *
+ * Key components include:
+ * - FlatHashMap: Insert-only map from keys to values with power-of-two capacity
+ * - HashIsAvalanching: Whether a hash function object may be masked directly
+ */
+#ifndef FLAT_HASH_MAP_H
+#define FLAT_HASH_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Tells whether a hash function object mixes well enough to be masked directly
+ *
+ * A hash opts in with `typedef void is_avalanching;` (see HashFunctions.h).
+ */
+template <class H, class = void>
+struct HashIsAvalanching : false_type
+{
+};
+
+template <class H>
+struct HashIsAvalanching<H, void_t<typename H::is_avalanching>> : true_type
+{
+};
+
+/**
+ * @class FlatHashMap
+ * @brief Open-addressing hash map with linear probing
+ *
+ * Entries live in a single slot array whose size is a power of two. The
+ * slot of a key is the low bits of its hash when the hash is avalanching,
+ * otherwise the high bits of the hash multiplied by 2^64/phi (Fibonacci
+ * hashing), which spreads even weak hashes such as std::hash on integers
+ * (the identity) over the table. The array doubles once it is more than
+ * 3/4 full, so probe sequences stay short. Entries cannot be removed
+ * (scopes only ever grow), which keeps lookups free of tombstone checks.
+ * @tparam K Key type
+ * @tparam V Value type
+ * @tparam Hash Hash function object for K
+ */
+template <class K, class V, class Hash = std::hash<K>>
+class FlatHashMap
+{
+public:
+    /**
+     * @brief Constructor for FlatHashMap
+     * @param initialCapacity Number of slots to start with, rounded up to a power of two
+     */
+    explicit FlatHashMap(size_t initialCapacity = 8)
+    {
+        size_t capacity = 2;
+        while (capacity < initialCapacity)
+            capacity *= 2;
+        this->count = 0;
+        this->Reset(capacity);
+    }
+
+    /**
+     * @brief Looks up a key
+     * @return Pointer to the stored value, or NULL if the key is not present
+     */
+    V *Find(const K &key)
+    {
+        for (size_t i = this->SlotOf(key);; i = (i + 1) & this->mask)
+        {
+            Slot &s = this->slots[i];
+            if (!s.used)
+                return NULL;
+            if (s.key == key)
+                return &s.value;
+        }
+    }
+
+    /**
+     * @brief Looks up a key and returns its value by copy
+     * @return The stored value, or a value-initialized V (NULL for pointers) if the key is not present
+     */
+    V Get(const K &key)
+    {
+        V *v = this->Find(key);
+        return v ? *v : V();
+    }
+
+    /**
+     * @brief Adds a key unless it is already present
+     * @return true if the entry was added, false if the key existed (the old value is kept)
+     */
+    bool Insert(const K &key, const V &value)
+    {
+        if ((this->count + 1) * 4 > this->slots.size() * 3)
+            this->Grow();
+        size_t i = this->SlotOf(key);
+        for (; this->slots[i].used; i = (i + 1) & this->mask)
+            if (this->slots[i].key == key)
+                return false;
+        this->slots[i].key = key;
+        this->slots[i].value = value;
+        this->slots[i].used = true;
+        this->count++;
+        return true;
+    }
+
+    /**
+     * @brief Calls f(key, value) for every entry, in slot order
+     */
+    template <class F>
+    void ForEach(F f)
+    {
+        for (Slot &s : this->slots)
+            if (s.used)
+                f(s.key, s.value);
+    }
+
+    /**
+     * @brief Returns the number of entries
+     */
+    size_t Size() const { return this->count; }
+
+    /**
+     * @brief Returns the number of slots
+     */
+    size_t Capacity() const { return this->slots.size(); }
+
+    /**
+     * @brief Returns the bytes held by the map itself (the slot array and the object)
+     *
+     * Heap memory owned by the keys or values (e.g. long string keys) is not counted.
+     */
+    size_t MemoryBytes() const { return sizeof(*this) + this->slots.capacity() * sizeof(Slot); }
+
+private:
+    /**
+     * @struct Slot
+     * @brief One entry of the slot array
+     */
+    struct Slot
+    {
+        K key;     ///< Key of the entry (meaningless unless used)
+        V value;   ///< Value of the entry
+        bool used; ///< Whether the slot holds an entry
+        Slot() : key(), value(), used(false) {}
+    };
+
+    vector<Slot> slots; ///< The slot array, its size is a power of two
+    size_t mask;        ///< slots.size() - 1
+    unsigned shift;     ///< 64 - log2(slots.size()), selects the high hash bits
+    size_t count;       ///< Number of used slots
+    Hash hasher;        ///< Hash function for keys
+
+    // Home slot of a key
+    size_t SlotOf(const K &key) const
+    {
+        if constexpr (HashIsAvalanching<Hash>::value)
+            return (size_t)this->hasher(key) & this->mask;
+        uint64_t h = (uint64_t)this->hasher(key) * 0x9E3779B97F4A7C15ull;
+        return (size_t)(h >> this->shift);
+    }
+
+    // Replaces the slot array with an empty one of `capacity` slots
+    void Reset(size_t capacity)
+    {
+        this->slots.assign(capacity, Slot());
+        this->mask = capacity - 1;
+        this->shift = 64;
+        for (size_t c = capacity; c > 1; c /= 2)
+            this->shift--;
+    }
+
+    // Doubles the slot array and reinserts every entry
+    void Grow()
+    {
+        vector<Slot> old;
+        old.swap(this->slots);
+        this->Reset(old.size() * 2);
+        for (Slot &s : old)
+        {
+            if (!s.used)
+                continue;
+            size_t i = this->SlotOf(s.key);
+            while (this->slots[i].used)
+                i = (i + 1) & this->mask;
+            this->slots[i].key = std::move(s.key);
+            this->slots[i].value = std::move(s.value);
+            this->slots[i].used = true;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,138 @@
+/**
+ * @file HashFunctions.h
+ * @brief Hash functions for identifier spellings and symbol keys
+ *
+ * This header defines a fast, well-mixed 64-bit hash for short strings and
+ * function objects that put it and the two legacy hashes of hash_fun.h
+ * behind one interface. The legacy hashes were designed for tables indexed
+ * modulo a prime: hash_fun1 ((h << 2) + c) shifts the first characters of
+ * long names out of the word and leaves the low bits determined by the last
+ * few characters, and hash_fun2 (613 * h + c) keeps its low bits poorly
+ * mixed, so neither suits a power-of-two table that masks the low bits.
+ * FastStringHash mixes every input bit into every output bit and may be
+ * masked directly (it is marked avalanching for FlatHashMap).
+ *
+ * The hash the interner uses for identifier spellings is chosen at build
+ * time with SYMBOL_NAME_HASH:
+ * 0 FastStringHash (default), 1 hash_fun1, 2 hash_fun2, e.g.
+ * `make SYMBOL_NAME_HASH=1`.
+ *
+ * Key components include:
+ * - mixHash: 64-bit finalizer that spreads every input bit over the result
+ * - fastHash: Word-at-a-time string hash built on mixHash
+ * - FastStringHash, HashFun1, HashFun2: String hash function objects
+ * - SymbolNameHash: The selected string hash
+ */
+#ifndef HASH_FUNCTIONS_H
+#define HASH_FUNCTIONS_H
+
+#include "hash_fun.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief Mixes a 64-bit value so that every input bit affects every output bit
+ *
+ * The finalizer of MurmurHash3: two multiply/xor-shift rounds.
+ */
+inline uint64_t mixHash(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+/**
+ * @brief Hashes a byte string, eight bytes per step
+ *
+ * The last word is read so that it ends at the last byte (overlapping the
+ * previous one), and strings shorter than eight bytes are read with at
+ * most two loads, so there is no byte loop and no variable-size copy.
+ * @param s The bytes (need not be NUL-terminated)
+ * @param n Number of bytes
+ */
+inline uint64_t fastHash(const char *s, size_t n)
+{
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ (n * 0xbf58476d1ce4e5b9ull);
+    const char *end = s + n;
+    uint64_t w;
+    if (n >= 8)
+    {
+        for (; end - s > 8; s += 8)
+        {
+            memcpy(&w, s, 8);
+            h = (h ^ w) * 0x9E3779B97F4A7C15ull;
+            h ^= h >> 29;
+        }
+        memcpy(&w, end - 8, 8);
+    }
+    else if (n >= 4)
+    {
+        uint32_t first, last;
+        memcpy(&first, s, 4);
+        memcpy(&last, end - 4, 4);
+        w = ((uint64_t)first << 32) | last;
+    }
+    else if (n > 0)
+        w = ((uint64_t)(unsigned char)s[0] << 16) | ((uint64_t)(unsigned char)s[n / 2] << 8) | (unsigned char)s[n - 1];
+    else
+        w = 0;
+    return mixHash((h ^ w) * 0x9E3779B97F4A7C15ull);
+}
+
+/**
+ * @struct FastStringHash
+ * @brief String hash function object using fastHash; safe to mask to a power of two
+ */
+struct FastStringHash
+{
+    typedef void is_avalanching;
+    size_t operator()(const string &s) const { return (size_t)fastHash(s.data(), s.size()); }
+};
+
+// The legacy hashes reduce modulo their `prime` argument; the largest
+// 31-bit prime keeps as much of the raw value as they can produce.
+const long HASH_FUN_RAW_PRIME = 2147483647;
+
+/**
+ * @struct HashFun1
+ * @brief String hash function object using hash_fun1 of hash_fun.h
+ */
+struct HashFun1
+{
+    size_t operator()(const string &s) const { return (size_t)hash_fun1(s, HASH_FUN_RAW_PRIME); }
+};
+
+/**
+ * @struct HashFun2
+ * @brief String hash function object using hash_fun2 of hash_fun.h
+ */
+struct HashFun2
+{
+    size_t operator()(const string &s) const { return (size_t)hash_fun2(s, HASH_FUN_RAW_PRIME); }
+};
+
+#ifndef SYMBOL_NAME_HASH
+#define SYMBOL_NAME_HASH 0
+#endif
+
+/**
+ * @typedef SymbolNameHash
+ * @brief The string hash selected with SYMBOL_NAME_HASH
+ */
+#if SYMBOL_NAME_HASH == 1
+typedef HashFun1 SymbolNameHash;
+#elif SYMBOL_NAME_HASH == 2
+typedef HashFun2 SymbolNameHash;
+#else
+typedef FastStringHash SymbolNameHash;
+#endif
+
+#endif
@@ -0,0 +1,93 @@
+/**
+ * @file InstructionBuffer.h
+ * @brief In-memory buffer of the generated VM program
+ *
+ * This header defines the buffer the code generator emits into. The whole
+ * program is kept in memory as a list of instructions, labels and comments,
+ * so later passes can inspect and rewrite it, and it is written to disk in
+ * one large write at the end instead of one flush per line.
+ *
+ * Key components include:
+ * - VMInstr: One line of the VM program
+ * - InstructionBuffer: The program being generated
+ */
+#ifndef INSTRUCTION_BUFFER_H
+#define INSTRUCTION_BUFFER_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @struct VMInstr
+ * @brief One line of a VM program
+ */
+struct VMInstr
+{
+    /**
+     * @enum Kind
+     * @brief What the line holds
+     */
+    enum Kind
+    {
+        OP,    ///< An instruction: opcode plus optional operand
+        LABEL, ///< A label definition, `op` holds its name
+        TEXT   ///< A comment or blank lines, `op` holds the text verbatim
+    };
+
+    Kind kind;      ///< What the line holds
+    string op;      ///< Opcode, label name or text
+    string operand; ///< Everything after the opcode (empty if none)
+};
+
+/**
+ * @class InstructionBuffer
+ * @brief The VM program being generated, kept in memory until it is written
+ */
+class InstructionBuffer
+{
+public:
+    vector<VMInstr> code; ///< The program, in order
+
+    /**
+     * @brief Appends an instruction, or a comment if the text starts with "//"
+     * @param instruction The instruction, e.g. "PUSHI 3"; it is split at the
+     *        first space into opcode and operand
+     */
+    void Emit(const string &instruction);
+    /**
+     * @brief Appends an instruction given as opcode and operand, without parsing
+     * @param op The opcode, e.g. "PUSHA"
+     * @param operand The operand (may be empty)
+     */
+    void Emit(const string &op, const string &operand);
+    /**
+     * @brief Appends a label definition
+     * @param label The label name, without the colon
+     */
+    void EmitLabel(const string &label);
+    /**
+     * @brief Returns the number of instructions (labels and comments excluded)
+     */
+    size_t InstructionCount() const;
+    /**
+     * @brief Formats the whole program as VM source text
+     */
+    string ToString() const;
+    /**
+     * @brief Writes the program to a stream in one write
+     * @param out Stream to write to
+     */
+    void Write(ostream &out) const;
+    /**
+     * @brief Writes the program to a file in one write
+     * @param path File to create or overwrite
+     * @return true if the file was written successfully
+     */
+    bool WriteFile(const string &path) const;
+};
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ * @file Interner.h
+ * @brief Global identifier interner shared by all compilations
+ *
+ * This header defines the table that stores every distinct identifier once
+ * and hands out a compact integer ID for it. The scanner interns each
+ * identifier as it is read, so later phases compare and hash IDs instead of
+ * strings. Identifiers are case-insensitive in MiniPascal; the spelling is
+ * folded to lower case when it is interned, so `Count`, `COUNT` and `count`
+ * all get the same ID.
+ *
+ * Key components include:
+ * - NameId: The interned ID of an identifier
+ * - InternedName: An ID together with its folded spelling
+ * - Interner: The process-wide table mapping spellings to IDs and back
+ */
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "HashFunctions.h"
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @typedef NameId
+ * @brief Interned ID of an identifier, dense and starting at 0
+ */
+typedef uint32_t NameId;
+
+/**
+ * @struct InternedName
+ * @brief What interning a spelling returns: its ID and the folded spelling
+ *
+ * Returned together, so that the scanner building an Ident takes the
+ * interner's lock once per identifier instead of twice.
+ */
+struct InternedName
+{
+    NameId id;              ///< The ID of the folded spelling
+    const string *spelling; ///< The folded spelling, owned by the interner
+};
+
+/**
+ * @class Interner
+ * @brief Maps case-folded identifier spellings to dense IDs and back
+ *
+ * There is one interner per process (see Global), shared by every
+ * compilation so that batch jobs can run on several threads; all methods are
+ * thread-safe. The strings returned by Name stay valid until the process
+ * ends or Truncate forgets them, so AST nodes may keep references to them.
+ */
+class Interner
+{
+public:
+    /**
+     * @brief Returns the process-wide interner
+     */
+    static Interner &Global();
+
+    /**
+     * @brief Interns an identifier, folding it to lower case
+     *
+     * Takes the lock once; a spelling seen before allocates nothing.
+     * @param text Spelling of the identifier (need not be NUL-terminated)
+     * @param len Length of the spelling
+     * @return The ID and the stored folded spelling
+     */
+    InternedName InternName(const char *text, size_t len);
+    /**
+     * @brief Interns an identifier, folding it to lower case
+     * @param text Spelling of the identifier (need not be NUL-terminated)
+     * @param len Length of the spelling
+     * @return The ID of the folded spelling
+     */
+    NameId Intern(const char *text, size_t len);
+    /**
+     * @brief Interns an identifier, folding it to lower case
+     * @param text Spelling of the identifier
+     * @return The ID of the folded spelling
+     */
+    NameId Intern(const string &text);
+    /**
+     * @brief Returns the folded spelling of an interned identifier
+     * @param id An ID returned by Intern
+     */
+    const string &Name(NameId id);
+    /**
+     * @brief Returns the number of distinct identifiers interned so far
+     */
+    size_t Size();
+    /**
+     * @brief Forgets the identifiers interned after the first `size`
+     *
+     * For a long-running process between compilations (see CompileServer):
+     * no AST, symbol or thread may still use a forgotten ID or spelling.
+     * @param size Number of identifiers kept, an earlier Size()
+     */
+    void Truncate(size_t size);
+
+private:
+    mutex lock;                                        ///< Guards ids and names
+    unordered_map<string, NameId, SymbolNameHash> ids; ///< Folded spelling -> ID (hash chosen with SYMBOL_NAME_HASH)
+    vector<const string *> names;                      ///< ID -> folded spelling (the keys of ids, which never move)
+};
+
+#endif
@@ -0,0 +1,102 @@
+/**
+ * @file NameResolver.h
+ * @brief Name resolution pass: declares every symbol and binds every variable reference once
+ *
+ * This header defines the pass that runs between parsing and type checking.
+ * It enters globals, subprograms, parameters and locals into the symbol
+ * table and binds each identifier that names a variable to its Symbol
+ * (recorded in the Annotations) and VarAddress (stored in the identifier).
+ * TypeVisitor and CodeGenVisitor then read those bindings and never search
+ * the scopes. Calls are left to
+ * TypeVisitor, since choosing an overload needs the argument types.
+ *
+ * Key components include:
+ * - NameResolver: The resolution pass
+ */
+#ifndef NAME_RESOLVER_H
+#define NAME_RESOLVER_H
+
+#include "Annotations.h"
+#include "FlatHashMap.h"
+#include "StaticVisitor.h"
+#include "SymbolTable.h"
+#include <utility>
+#include <vector>
+
+class CompilationContext;
+class Errors;
+
+/**
+ * @class NameResolver
+ * @brief Declares the symbols of a program and binds its variable references
+ *
+ * While walking the tree the pass keeps one map from each name to the
+ * variable it currently denotes. Entering a subprogram's declarations
+ * overwrites the bindings they shadow and logs the old ones; leaving the
+ * subprogram restores them from the log. A reference therefore costs one
+ * probe however deeply scopes are nested, instead of one per enclosing
+ * scope.
+ */
+class NameResolver : public StaticVisitor<NameResolver>
+{
+public:
+    using StaticVisitor<NameResolver>::Visit;
+
+    /**
+     * @brief Constructor for NameResolver
+     * @param ctx The compilation whose symbol table and error list are used
+     */
+    NameResolver(CompilationContext *ctx);
+
+    /**
+     * @brief No per-node work, required by StaticVisitor
+     */
+    void Enter(Node *) {}
+    /**
+     * @brief Declares the global variables
+     */
+    void Visit(Decs *n);
+    /**
+     * @brief Declares a subprogram, opens its scope and resolves its body
+     */
+    void Visit(SubDec *n);
+    /**
+     * @brief Resolves a statement sequence, stopping once the error limit is reached
+     */
+    void Visit(StmtList *n);
+    /**
+     * @brief Binds the target of an assignment (or the result of the current function)
+     */
+    void Visit(Var *n);
+    /**
+     * @brief Binds the array of an assigned element and resolves the index
+     */
+    void Visit(ArrayElement *n);
+    /**
+     * @brief Binds a variable read
+     */
+    void Visit(IdExp *n);
+    /**
+     * @brief Binds the array of an element read and resolves the index
+     */
+    void Visit(ArrayExp *n);
+
+private:
+    SymbolTable *symbolTable;                  ///< Symbol table of the compilation
+    Annotations *annotations;                  ///< Where the symbol of each identifier is recorded
+    Errors *errors;                            ///< Where redefinitions and undeclared names are reported
+    FlatHashMap<NameId, Symbol *> visible;     ///< The variable each name denotes at this point (NULL if none)
+    vector<pair<NameId, Symbol *>> shadowed;   ///< Bindings overwritten by declarations, restored on scope exit
+    Func *currentFunction;                     ///< Function whose body is being resolved, if any
+    int unit;                                  ///< Number of the subprogram (or main body) being resolved
+    FlatHashMap<NameId, int> undeclared;       ///< Undeclared names, with the unit they were last reported in
+
+    // Enters a variable into the current scope and makes it visible
+    void Declare(Ident *id, SymbolKind kind, Type *type);
+
+    // Binds a reference to the variable its name denotes; an undeclared
+    // name is reported once per subprogram, not at every reference
+    void Bind(Ident *id);
+};
+
+#endif
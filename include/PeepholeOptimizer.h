@@ -0,0 +1,67 @@
+/**
+ * @file PeepholeOptimizer.h
+ * @brief Table-driven peephole optimization of the generated VM program
+ *
+ * This header defines the last pass of -O, which rewrites short sequences
+ * of instructions in the InstructionBuffer before it is written: constants
+ * are combined, swaps that cancel out and jumps to the next line are
+ * dropped, and constant array indexes become LOAD/STORE offsets. Every
+ * rule is a row of a table (see PeepholeOptimizer.cpp): the opcodes it
+ * matches and a function that builds the replacement, or declines it when
+ * the operands do not allow it.
+ *
+ * Key components include:
+ * - PeepholeOptimizer: Applies the rules until none matches
+ */
+#ifndef PEEPHOLE_OPTIMIZER_H
+#define PEEPHOLE_OPTIMIZER_H
+
+#include "InstructionBuffer.h"
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class PeepholeOptimizer
+ * @brief Slides a window over the program and rewrites what the rules match
+ *
+ * A window is a run of consecutive instructions; comments inside it are
+ * kept, in front of the replacement, and a label ends it (something may
+ * jump there), unless the rule matches that label. The program is scanned
+ * again until a pass changes nothing, so rewrites can enable each other.
+ */
+class PeepholeOptimizer
+{
+public:
+    vector<size_t> applied; ///< Rewrites applied, by rule (see RuleName)
+    size_t passes;          ///< Passes made over the program, the last one changing nothing
+
+    /**
+     * @brief Constructor for PeepholeOptimizer, with all counters at zero
+     */
+    PeepholeOptimizer();
+
+    /**
+     * @brief Optimizes a program in place
+     * @param program The program, labels and comments included
+     * @return Number of rewrites applied
+     */
+    size_t Run(InstructionBuffer &program);
+
+    /**
+     * @brief Returns the number of rules in the table
+     */
+    static size_t RuleCount();
+    /**
+     * @brief Returns the name of a rule, e.g. "swap-swap"
+     * @param rule Index of the rule, below RuleCount()
+     */
+    static const char *RuleName(size_t rule);
+
+private:
+    // Applies every rule once along the program; returns the rewrites made
+    size_t pass(vector<VMInstr> &code);
+};
+
+#endif
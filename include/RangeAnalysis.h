@@ -0,0 +1,164 @@
+/**
+ * @file RangeAnalysis.h
+ * @brief Value-range analysis of integer variables, used to drop redundant array bounds checks
+ *
+ * This header defines the pass that runs between type checking and code
+ * generation under -O. It computes, at every array access, an interval
+ * containing every value the index can take, from integer constants, the
+ * assignments before the access and the conditions of the enclosing if and
+ * while statements. Accesses whose interval lies within the array's bounds
+ * are flagged IN_BOUNDS in the Annotations, and CodeGenVisitor emits no
+ * CHECK for them. Whatever the analysis cannot prove keeps its check.
+ *
+ * Key components include:
+ * - ValueRange: An interval of 32-bit integers
+ * - RangeState: The ranges of the integer variables at one program point
+ * - RangeAnalysis: The pass
+ */
+#ifndef RANGE_ANALYSIS_H
+#define RANGE_ANALYSIS_H
+
+#include "Annotations.h"
+#include "FlatHashMap.h"
+#include "StaticVisitor.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @struct ValueRange
+ * @brief The integers lo..hi; the full 32-bit range stands for "unknown"
+ *
+ * Bounds are computed in 64 bits. A result that leaves the 32-bit range
+ * may have wrapped around in the VM, so it becomes unknown.
+ */
+struct ValueRange
+{
+    int64_t lo; ///< Smallest possible value
+    int64_t hi; ///< Largest possible value
+
+    /**
+     * @brief Returns the unknown range, every 32-bit integer
+     */
+    static ValueRange All() { return ValueRange{INT32_MIN, INT32_MAX}; }
+    /**
+     * @brief Returns the range of one constant
+     */
+    static ValueRange Of(int64_t v) { return ValueRange{v, v}; }
+};
+
+/**
+ * @struct RangeState
+ * @brief The range of every tracked variable at one program point
+ */
+struct RangeState
+{
+    vector<ValueRange> ranges; ///< By variable slot (see RangeAnalysis)
+    bool reachable;            ///< false if no execution reaches the point
+};
+
+/**
+ * @class RangeAnalysis
+ * @brief Interval analysis over the integer scalars of each subprogram and of the main body
+ *
+ * The pass interprets every body once, statement by statement, with a
+ * RangeState. Branches are analyzed with the state narrowed by their
+ * condition and joined afterwards. A loop is analyzed until the state at
+ * its head stops changing, widening the bounds that keep moving to the
+ * limits of the 32-bit range after a few rounds, so a counter incremented
+ * in the body keeps the bound its guard gives it. The decision for an
+ * access is the one made in the last, converged analysis of its loop.
+ *
+ * Globals are unknown where a body starts, and after every call other than
+ * the built-in write, since the callee may assign them. For the same reason
+ * a condition narrows a global only if no call can follow the comparison
+ * within the condition. Parameters and locals can only change by the
+ * assignments of their own body.
+ */
+class RangeAnalysis : public StaticVisitor<RangeAnalysis>
+{
+public:
+    using StaticVisitor<RangeAnalysis>::Visit;
+
+    size_t accesses; ///< Array accesses analyzed
+    size_t inBounds; ///< Of those, accesses flagged IN_BOUNDS
+
+    /**
+     * @brief Constructor for RangeAnalysis
+     * @param annotations The types and symbols of a checked program, which receive the IN_BOUNDS flags
+     */
+    RangeAnalysis(Annotations *annotations);
+
+    /**
+     * @brief No per-node work, required by StaticVisitor
+     */
+    void Enter(Node *) {}
+    /**
+     * @brief Analyzes the subprograms, then the main body with the globals
+     */
+    void Visit(Prog *n);
+    /**
+     * @brief Analyzes a subprogram body (unless it comes from the cache)
+     */
+    void Visit(SubDec *n);
+    /**
+     * @brief Sets the range of an assigned integer variable, or decides the check of an assigned element
+     */
+    void Visit(Assign *n);
+    /**
+     * @brief Decides the checks of the arguments; a call forgets the globals
+     */
+    void Visit(ProcStmt *n);
+    /**
+     * @brief Analyzes the branch with the state narrowed by the condition
+     */
+    void Visit(IfThen *n);
+    /**
+     * @brief Analyzes both branches and joins their states
+     */
+    void Visit(IfThenElse *n);
+    /**
+     * @brief Analyzes a loop until the state at its head is stable
+     */
+    void Visit(While *n);
+    /**
+     * @brief Decides whether an element read needs its check
+     */
+    void Visit(ArrayExp *n);
+
+private:
+    Annotations *annotations;         ///< Types, symbols and flags of the program
+    Decs *globals;                    ///< Global declarations of the program
+    FlatHashMap<Symbol *, int> slots; ///< Slot of each tracked variable of the body being analyzed
+    int globalSlots;                  ///< Slots 0..globalSlots-1 hold the integer globals
+    RangeState state;                 ///< State at the statement being analyzed
+
+    // Gives the integer scalars of a declaration the next slots
+    void addSlots(IdentList *ids, int &next);
+    // Numbers the variables a body can use (sub is NULL for the main body) and forgets their ranges
+    void beginBody(SubDec *sub);
+    // Adds the accesses of an analyzed body to the counters
+    void endBody(Node *body);
+    // Slot of the variable an identifier denotes, -1 if it is not tracked
+    int slotOf(Ident *id);
+    // Makes the globals unknown
+    void forgetGlobals();
+    // Forgets the globals if an expression calls a function
+    void forgetGlobalsIfCalls(Exp *e);
+
+    // Range of an integer expression in a state
+    ValueRange rangeOf(const RangeState &s, Exp *e);
+    // Narrows a state to the executions where a condition is true (or false);
+    // callsAfter: a call may follow in the enclosing condition, so globals are left alone
+    void assume(RangeState &s, Exp *cond, bool truth, bool callsAfter = false);
+    // Narrows the range of a variable to the values satisfying `v op bound`
+    void narrow(RangeState &s, Exp *e, OpType op, ValueRange bound, bool keepGlobals);
+    // Joins `other` into `s`; returns true if `s` grew
+    bool join(RangeState &s, const RangeState &other);
+    // Flags an access IN_BOUNDS if its index provably lies within the array
+    void decide(Node *access, Ident *array, Exp *index);
+};
+
+#endif
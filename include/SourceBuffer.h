@@ -0,0 +1,93 @@
+/**
+ * @file SourceBuffer.h
+ * @brief Memory-mapped source input for the scanner
+ *
+ * This header defines a read-only view of a MiniPascal source file that is
+ * mapped straight into memory, so the Flex scanner can tokenize it in place
+ * with yy_scan_buffer instead of copying every byte through YY_INPUT/fread.
+ * Source text that is already in memory is scanned the same way.
+ *
+ * Key components include:
+ * - SourceBuffer: Owns the mapping of one source file, or a copy of source text
+ * - scanSourceBuffer: Points the scanner at a mapped source file
+ * - readFile: Reads a whole file into a string
+ */
+#ifndef SOURCE_BUFFER_H
+#define SOURCE_BUFFER_H
+
+#include <cstddef>
+#include <string>
+
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+
+/**
+ * @class SourceBuffer
+ * @brief A source file mapped into memory with the padding Flex expects
+ *
+ * yy_scan_buffer requires the text to be followed by two end-of-buffer (NUL)
+ * characters. The mapping always reserves those two bytes after the file
+ * contents, so the buffer can be handed to the scanner without copying.
+ * The pages are mapped private and writable because Flex temporarily writes
+ * into the buffer while scanning; the file on disk is never modified.
+ */
+class SourceBuffer
+{
+public:
+    char *data;        ///< Start of the file contents (NULL if nothing is mapped)
+    size_t size;       ///< Size of the file contents in bytes
+    size_t mappedSize; ///< Size of the whole mapping, padding included (0 for loaded text)
+
+    /**
+     * @brief Constructor for SourceBuffer
+     *
+     * Initializes an empty buffer with nothing mapped.
+     */
+    SourceBuffer();
+    /**
+     * @brief Destructor, unmaps the file if it is mapped
+     */
+    ~SourceBuffer();
+    /**
+     * @brief Maps a source file into memory
+     * @param path Path of the file to map
+     * @return true if the file was mapped, false if it cannot be mapped
+     *         (e.g. it is empty, not a regular file, or mmap is unsupported),
+     *         in which case the caller should fall back to stdio input
+     */
+    bool Open(const std::string &path);
+    /**
+     * @brief Copies source text that is already in memory, adding the padding
+     * @param text The source text
+     */
+    void Load(const std::string &text);
+    /**
+     * @brief Unmaps the file (or frees the loaded text)
+     */
+    void Close();
+
+private:
+    std::string loaded; ///< The loaded text and its two NULs (empty if a file is mapped)
+};
+
+/**
+ * @brief Makes a scanner read from a mapped source file (or loaded text), in place
+ *
+ * Defined in scanner.lex since it needs the scanner's buffer functions.
+ * @param src The mapped source file or loaded text
+ * @param scanner The scanner that should read it
+ * @return true if the scanner accepted the buffer
+ */
+bool scanSourceBuffer(SourceBuffer *src, yyscan_t scanner);
+
+/**
+ * @brief Reads a whole file into a string, with one read of its known size
+ * @param path File to read
+ * @param contents Receives the bytes of the file
+ * @return true if the file was read completely
+ */
+bool readFile(const std::string &path, std::string &contents);
+
+#endif
@@ -13,28 +13,42 @@
  * - Scope: Single scope container with hash table for efficient symbol lookup
  * - SymbolTable: Main symbol table manager handling scope hierarchy
  * - FunctionSignature: Function signature representation for overload resolution
+ * - PackedSignature: Parameter types of an overload packed into one integer
+ * - OverloadSet: The functions or procedures sharing a name
+ * - SymbolKey: Structured (name, namespace) key of a symbol within a scope
  */
 #ifndef SYMBOLTABLE
 #define SYMBOLTABLE
 
 #include "CommonTypes.h"
 #include "ast.h"
-#include "hash_fun.h"
-#include "hash_table.h"
+#include "FlatHashMap.h"
+#include "HashFunctions.h"
+#include <cstdint>
+#include <string>
 
 using namespace std;
+
+class Errors;
+
 /**
- * @enum SymbolKind
- * @brief Represents The kind of symbols (local variable, global variable, function, pocedure, parameter)
+ * @typedef PackedSignature
+ * @brief The parameter types of an overload packed into one integer
+ *
+ * Three bits per type behind a leading 1 bit, so lists of different lengths
+ * never collide. Lists longer than MAX_PACKED_PARAMS keep only their first
+ * types and set the top bit (PACKED_SIGNATURE_TRUNCATED); such signatures
+ * must be confirmed by comparing the full type lists.
  */
-enum SymbolKind
-{
-    PARAM_VAR = 1,  ///< parameter variable
-    GLOBAL_VAR = 2, ///< global variable
-    LOCAL_VAR = 3,  ///< local variables for functions
-    FUNC = 4,       ///< function symbol
-    PROC = 5        ///< procedure symbol
-};
+typedef uint64_t PackedSignature;
+
+const int MAX_PACKED_PARAMS = 20;
+const PackedSignature PACKED_SIGNATURE_TRUNCATED = 1ull << 63;
+
+/**
+ * @brief Packs a list of parameter (or argument) types
+ */
+PackedSignature packSignature(const vector<TypeEnum> &types);
 
 /**
  * @class FunctionSignature
@@ -47,20 +61,34 @@ enum SymbolKind
 class FunctionSignature
 {
 public:
-    string name;                ///< Function or procedure name
-    vector<Type *> *paramTypes; ///< List of parameter types in order
-    TypeEnum returnType;        ///< Return type (VOID for procedures)
+    string name;                     ///< Function or procedure name
+    NameId nameId;                   ///< Interned ID of the name
+    vector<Type *> *paramTypes;      ///< List of parameter types in order
+    TypeEnum returnType;             ///< Return type (VOID for procedures)
+    vector<TypeEnum> paramTypeEnums; ///< Parameter types as call sites see them, computed once
+    PackedSignature packed;          ///< paramTypeEnums packed, the overload's index in its OverloadSet
+    string label;                    ///< Mangled code label ('f' or 'p' + getSignatureString()), computed once
+    bool builtIn;                    ///< Set for the built-in procedures, which have no code of their own
 
     /**
      * @brief Constructor for FunctionSignature
+     *
+     * Also computes the parameter type list, its packed form and the code
+     * label, so resolving and calling the overload never builds strings.
      * @param n Function or procedure name
      * @param params List of parameter types
      * @param ret Return type (defaults to VOID for procedures)
      */
     FunctionSignature(string n, vector<Type *> *params, TypeEnum ret = VOID);
+    /**
+     * @brief Destructor, releases the parameter list (the types are AST nodes)
+     */
+    ~FunctionSignature();
+    FunctionSignature(const FunctionSignature &) = delete;
+    FunctionSignature &operator=(const FunctionSignature &) = delete;
     /**
      * @brief Generates a string representation of the function signature
-     * @return String containing the complete signature for the key in the symbol table
+     * @return String containing the complete signature, the code label without its 'f'/'p' prefix
      */
     string getSignatureString();
 };
@@ -83,6 +111,7 @@ public:
     int beginIndex;             ///< Begining index (for Arrays Only)
     int endIndex;             ///< end index (for Arrays Only)
     int Offset;                 ///< Memory offset for code generation
+    int Depth;                  ///< Nesting depth of the declaring scope (0 for globals and subprograms)
     FunctionSignature *funcSig; ///< Function signature (for functions/procedures only)
     /**
      * @brief Constructor for variable symbols
@@ -99,16 +128,97 @@ public:
      * @param sig Function signature containing parameter and return types
      */
     Symbol(string name, SymbolKind kind, FunctionSignature *sig);
+
+    /**
+     * @brief Returns the address of a variable symbol
+     */
+    VarAddress Address() const { return VarAddress(this->Kind, this->Depth, this->Offset); }
+};
+
+/**
+ * @enum SymbolNamespace
+ * @brief The name spaces a scope keeps apart
+ *
+ * Parameters, locals and globals share NS_VAR: a scope holds at most one
+ * variable per name, so resolving a variable takes one probe per scope.
+ * Functions and procedures are kept in overload sets, one per name and
+ * name space.
+ */
+enum SymbolNamespace : uint8_t
+{
+    NS_VAR = 0,  ///< variables and parameters
+    NS_FUNC = 1, ///< function overloads
+    NS_PROC = 2  ///< procedure overloads
+};
+
+/**
+ * @struct SymbolKey
+ * @brief Key of a symbol in a scope's hash table, or of an overload set
+ *
+ * Built from the interned ID of the name, never from its spelling, so
+ * looking a symbol up allocates nothing.
+ */
+struct SymbolKey
+{
+    NameId nameId;      ///< Interned name
+    SymbolNamespace ns; ///< Name space of the symbol
+
+    SymbolKey() : nameId(0), ns(NS_VAR) {}
+    SymbolKey(NameId id, SymbolNamespace n) : nameId(id), ns(n) {}
+
+    bool operator==(const SymbolKey &o) const { return this->nameId == o.nameId && this->ns == o.ns; }
+};
+
+/**
+ * @struct SymbolKeyHash
+ * @brief Hash function object for SymbolKey, mixes name and name space with mixHash
+ */
+struct SymbolKeyHash
+{
+    typedef void is_avalanching;
+    size_t operator()(const SymbolKey &k) const
+    {
+        return (size_t)mixHash(((uint64_t)k.nameId << 2) | k.ns);
+    }
+};
+
+/**
+ * @class OverloadSet
+ * @brief The functions or the procedures sharing one name
+ *
+ * Members are indexed by their packed signature. A name rarely has more
+ * than a few overloads, so the index is a short array scanned by integer
+ * comparison rather than a hash table.
+ */
+class OverloadSet
+{
+public:
+    vector<pair<PackedSignature, Symbol *>> members; ///< Packed signature and symbol of every overload
+
+    /**
+     * @brief Finds the overload taking exactly the given parameter types
+     * @param packed packSignature(types)
+     * @param types The parameter types, compared in full only for truncated signatures
+     * @return The overload, or NULL if there is none
+     */
+    Symbol *Find(PackedSignature packed, const vector<TypeEnum> &types);
+    /**
+     * @brief Adds an overload unless one with the same parameter types exists
+     * @param sym Function or procedure symbol, with its funcSig set
+     * @return true if it was added
+     */
+    bool Add(Symbol *sym);
 };
 
 /**
  * @typedef HashTable
  * @brief Type alias for the hash table used in each scope
  *
- * Uses the CHashTable template class to store Symbol objects,
- * providing efficient symbol lookup within a scope.
+ * Uses the FlatHashMap template class to store Symbol objects,
+ * providing efficient symbol lookup within a scope. The map starts small and
+ * grows with the scope, so the many tiny scopes of subprograms stay cheap.
  */
-typedef CHashTable<Symbol> HashTable;
+typedef FlatHashMap<SymbolKey, Symbol *, SymbolKeyHash> HashTable;
 
 /**
  * @class Scope
@@ -116,6 +226,7 @@ typedef CHashTable<Symbol> HashTable;
  *
  * Contains a hash table of symbols defined in this scope and maintains
  * relationships with parent and child scopes for proper scope hierarchy.
+ * The symbols and the child scopes belong to the SymbolTable.
  */
 class Scope
 {
@@ -125,12 +236,19 @@ public:
     vector<Scope *> *Children; ///< List of child scopes
     int local_offset;          ///< Current offset for local variables in this scope
     int param_offset;          ///< Current offset for parameters in this scope
+    int depth;                 ///< Nesting depth, 0 for the global scope
     /**
      * @brief Constructor for Scope
      *
      * Initializes an empty scope with hash table and child list.
      */
     Scope();
+    /**
+     * @brief Destructor, releases the hash table and the child list
+     */
+    ~Scope();
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
     /**
      * @brief Adds a child scope to this scope
      * @param s The child scope to add
@@ -151,6 +269,12 @@ public:
  *
  * This class is crucial for semantic analysis and ensuring proper
  * variable scoping rules are followed.
+ *
+ * The table owns its scopes, its symbols, its overload sets and the
+ * signatures of the subprograms declared in it, and releases them all with
+ * itself, so a long-running process (the compile server) does not keep
+ * anything of a finished compilation. The built-ins' signatures are shared
+ * by every table and never released.
  */
 class SymbolTable
 {
@@ -158,31 +282,46 @@ public:
     Scope *rootScope;        ///< root program scope
     Scope *currentScope;     ///< current scope
     vector<Scope *> *Scopes; ///< List of inner scopes
+    int symbolCount;         ///< Number of symbols added successfully
+    long lookupCount;        ///< Number of symbol lookups (variable references and calls)
+    long probeCount;         ///< Number of scope hash table probes made by the lookups
+    Errors *errors;          ///< Where redefinitions and undeclared symbols are reported
+    FlatHashMap<SymbolKey, OverloadSet *, SymbolKeyHash> overloads; ///< Functions and procedures, one set per name and name space
+    vector<Symbol *> symbols;               ///< Every symbol created, shadowed ones included
+    vector<FunctionSignature *> signatures; ///< Signatures given to AddSymbol, except the built-ins'
 
     /**
      * @brief Constructor for SymbolTable
      *
      * Initializes the symbol table with a global scope.
+     * @param errs Error list of the compilation owning this table
+     */
+    SymbolTable(Errors *errs);
+    /**
+     * @brief Destructor, releases the scopes, symbols, overload sets and signatures
      */
-    SymbolTable();
+    ~SymbolTable();
+    SymbolTable(const SymbolTable &) = delete;
+    SymbolTable &operator=(const SymbolTable &) = delete;
 
     /**
      * @brief Adds a variable symbol to the current scope
      * @param ident Identifier node containing name and location info
      * @param kind Symbol kind (variable type)
      * @param type Type information for the symbol
-     * @return true if symbol was added successfully, false if already exists
+     * @return The new symbol, or null if the name was already declared (the error is reported)
      */
-    bool AddSymbol(Ident *ident, SymbolKind kind, Type *type);
+    Symbol *AddSymbol(Ident *ident, SymbolKind kind, Type *type);
 
     /**
      * @brief Adds a function/procedure symbol to the current scope
      * @param ident Identifier node containing name and location info
      * @param kind Symbol kind (FUNC or PROC)
-     * @param sig Function signature containing parameter and return types
-     * @return true if symbol was added successfully, false if already exists
+     * @param sig Function signature containing parameter and return types; the table owns it
+     *            from now on, even if the symbol is not added (unless it is a built-in's)
+     * @return The new symbol, or null if the name was already declared (the error is reported)
      */
-    bool AddSymbol(Ident *ident, SymbolKind kind, FunctionSignature *sig);
+    Symbol *AddSymbol(Ident *ident, SymbolKind kind, FunctionSignature *sig);
 
     /**
      * @brief Looks up a symbol by name across scope hierarchy
@@ -192,13 +331,16 @@ public:
     Symbol *LookUpSymbol(Ident *ident);
 
     /**
-     * @brief Looks up a function/procedure symbol with specific signature
-     * @param ident Identifier to search for
-     * @param kind Symbol kind to match
-     * @param paramTypes Parameter types for signature matching
-     * @return Pointer to symbol if found with matching signature, null otherwise
+     * @brief Finds the function/procedure overload taking exactly the given argument types
+     *
+     * Makes one probe and changes nothing (not even the counters), so
+     * several threads may call it at once once all subprograms are declared.
+     * @param nameId Interned name of the subprogram
+     * @param kind FUNC or PROC
+     * @param argTypes Types of the arguments of the call
+     * @return The matching overload, null if there is none
      */
-    Symbol *LookUpSymbol(Ident *ident, SymbolKind kind, vector<TypeEnum> *paramTypes);
+    Symbol *FindOverload(NameId nameId, SymbolKind kind, const vector<TypeEnum> &argTypes);
 
     /**
      * @brief Creates a new nested scope
@@ -0,0 +1,83 @@
+/**
+ * @file ThreadPool.h
+ * @brief Work-stealing thread pool used to run compilation jobs in parallel
+ *
+ * This header defines a fixed-size pool of worker threads. Every worker owns
+ * a task queue; it takes work from the back of its own queue and, when that
+ * runs dry, steals from the front of the other workers' queues, so uneven
+ * jobs (one huge source file among many small ones) keep all threads busy.
+ *
+ * Key components include:
+ * - ThreadPool: The workers, their queues and batch execution
+ */
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class ThreadPool
+ * @brief A fixed set of worker threads with per-worker, stealable queues
+ *
+ * Work is handed to the pool as a batch with Run, which returns once every
+ * task of the batch has finished. Run may be called from inside a task
+ * (nested parallelism); the calling worker then executes queued tasks while
+ * it waits instead of blocking.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @brief Constructor for ThreadPool
+     * @param numThreads Number of worker threads (at least one is started)
+     */
+    ThreadPool(unsigned numThreads);
+    /**
+     * @brief Destructor, lets the workers finish and joins them
+     */
+    ~ThreadPool();
+    /**
+     * @brief Runs a batch of tasks and waits until all of them are done
+     * @param tasks The tasks to run, in any order and on any worker
+     */
+    void Run(vector<function<void()>> &tasks);
+    /**
+     * @brief Returns the number of worker threads
+     */
+    unsigned Size() const;
+
+private:
+    /**
+     * @struct WorkQueue
+     * @brief The task queue owned by one worker
+     */
+    struct WorkQueue
+    {
+        mutex lock;                    ///< Guards tasks
+        deque<function<void()>> tasks; ///< Owner pops at the back, thieves at the front
+    };
+
+    vector<thread> workers;        ///< The worker threads
+    vector<WorkQueue *> queues;    ///< One queue per worker
+    mutex stateLock;               ///< Guards queued, stopping and the condition variables
+    condition_variable wake;       ///< Signalled when tasks are queued or the pool stops
+    condition_variable finished;   ///< Signalled whenever a task completes
+    unsigned queued;               ///< Tasks sitting in the queues
+    unsigned nextQueue;            ///< Round-robin queue for tasks submitted from outside
+    bool stopping;                 ///< Set when the pool is being destroyed
+
+    // Takes a task, preferring the back of queue `self` and then stealing from the others
+    bool TryPop(unsigned self, function<void()> &task);
+
+    // Main loop of worker `self`
+    void WorkerLoop(unsigned self);
+};
+
+#endif
@@ -0,0 +1,105 @@
+/**
+ * @file TimeReport.h
+ * @brief Per-phase timing and memory statistics for --time-report
+ *
+ * This header defines the collector behind the --time-report option. The
+ * driver brackets every compilation phase with Begin/End; each phase records
+ * its wall time, the number of heap allocations made by the compiling thread
+ * and the peak resident set size of the process when it ended. Allocations
+ * are counted by the global operator new of AllocationCounter.cpp, which
+ * only the compiler executable links, and only once countAllocations is set. Size counters
+ * (AST nodes, symbols, scopes, lookups, VM instructions) are filled in by the driver.
+ *
+ * Key components include:
+ * - PhaseStats: The measurements of one phase
+ * - TimeReport: The phases of one compilation and its size counters
+ */
+#ifndef TIME_REPORT_H
+#define TIME_REPORT_H
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @struct PhaseStats
+ * @brief The measurements of one compilation phase
+ */
+struct PhaseStats
+{
+    string name;        ///< Phase name as printed in the report
+    double seconds;     ///< Wall time of the phase
+    size_t allocations; ///< Heap allocations made by the compiling thread during the phase
+    long peakRssKb;     ///< Peak resident set size of the process at the end of the phase, in KiB
+};
+
+/**
+ * @class TimeReport
+ * @brief Collects the phase measurements and size counters of one compilation
+ */
+class TimeReport
+{
+public:
+    vector<PhaseStats> phases; ///< Finished phases, in order
+    size_t astNodes;           ///< AST nodes created by the parser
+    size_t symbols;            ///< Symbols entered in the symbol table
+    size_t scopes;             ///< Scopes created, the global scope included
+    size_t lookups;            ///< Symbol table lookups made by semantic analysis
+    size_t probes;             ///< Scope hash table probes made by those lookups
+    size_t instructions;       ///< VM instructions emitted (labels and comments excluded)
+    size_t arenaBytes;         ///< Memory reserved by the AST arena
+    size_t subprograms;        ///< Subprograms looked up in the compilation cache (0: no cache)
+    size_t cachedSubprograms;  ///< Of those, subprograms whose code was reused
+    size_t constantsFolded;    ///< Operators replaced by their value (-O)
+    size_t constantUses;       ///< Uses of constant locals replaced by their value (-O)
+    size_t arrayAccesses;      ///< Array accesses seen by the range analysis (0: not run)
+    size_t checksRemoved;      ///< Of those, accesses emitted without a bounds check
+    size_t unoptimizedInstructions;        ///< VM instructions before the peephole optimizer (0: not run)
+    vector<pair<string, size_t>> rewrites; ///< Peephole rewrites applied, by rule
+
+    static thread_local size_t threadAllocations; ///< Heap allocations counted on the calling thread
+    static bool countAllocations; ///< Set by the driver before any compilation to count allocations
+
+    /**
+     * @brief Constructor for TimeReport, starts with no phases and zero counters
+     */
+    TimeReport();
+    /**
+     * @brief Starts measuring a phase
+     * @param phase Name of the phase
+     */
+    void Begin(const string &phase);
+    /**
+     * @brief Stops measuring the phase started last and records it
+     */
+    void End();
+    /**
+     * @brief Prints the phase table and the size counters
+     * @param out Stream to print to
+     * @param title Heading of the report (usually the source file name)
+     */
+    void Print(ostream &out, const string &title) const;
+
+    /**
+     * @brief Returns the number of heap allocations made so far by the calling thread
+     *
+     * 0 unless the program links AllocationCounter.cpp and countAllocations is set.
+     */
+    static size_t AllocationCount();
+    /**
+     * @brief Returns the peak resident set size of the process in KiB (0 if unknown)
+     */
+    static long PeakRssKb();
+
+private:
+    string current;                        ///< Name of the running phase
+    chrono::steady_clock::time_point start; ///< When the running phase began
+    size_t startAllocations;                ///< AllocationCount() when the running phase began
+};
+
+#endif
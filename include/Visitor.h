@@ -17,6 +17,9 @@
 #define VISITOR_H
 
 #include <fstream>
+#include "InstructionBuffer.h"
+#include "Error.h"
+#include "CommonTypes.h"
 using namespace std;
 
 // Forward declarations for all AST nodes
@@ -75,6 +78,12 @@ class Or;
 class Not;
 class UnaryMinus;
 class Symbol;
+class SymbolTable;
+class Errors;
+class CompilationContext;
+class ThreadPool;
+class Annotations;
+class CompileCache;
 
 /**
  * @class Visitor
@@ -443,16 +452,67 @@ private:
      * @return True if the statement guarantees a return on all paths, false otherwise.
      */
     bool checkReturn(Stmt *statement);
+
+    /**
+     * @brief Finds the overload a call refers to, reporting an error if there is none
+     * @param ident Name of the called subprogram (bound to the overload when found)
+     * @param kind FUNC or PROC
+     * @param argTypes Types of the call's arguments
+     * @return The overload, null if none takes these argument types
+     */
+    Symbol *lookUpCall(Ident *ident, SymbolKind kind, const vector<TypeEnum> &argTypes);
+
+    /**
+     * @brief Checks the bodies of the subprograms on the thread pool
+     *
+     * Uses `pool`, or a pool of `jobs` threads started for the call.
+     * The subprograms are split into chunks checked by copies of this
+     * visitor, each with its own error list and log, which are appended to
+     * this visitor's in source order afterwards, so the diagnostics are the
+     * same as when checking serially.
+     * @param n The subprograms, all declared already
+     */
+    void checkInParallel(SubDecs *n);
+
+    vector<Diagnostic> logWarnings; ///< Inline warnings of the subprogram being checked, for the cache
+
+    // Helper to print a warning inline to the log, remembering it for the cache
+    void logWarning(const string &message, int line, int column);
+
+    // Helpers to read / record the type of a node in the annotations
+    TypeEnum typeOf(const Node *n) const;
+    void setType(const Node *n, TypeEnum t);
+
+    /**
+     * @brief Records where an arithmetic operator converts an integer operand to real
+     * @param b The operator, already typed
+     */
+    void markConversions(BinOp *b);
+
+    /**
+     * @brief Records where a comparison converts an integer operand to real, and whether it compares reals
+     * @param b The comparison, already typed
+     */
+    void markComparison(BinOp *b);
 public:
     Func *currentFunction;         ///< To keep track of the current function context for return type checking
     bool currentFunctionHasReturn; ///< Flag to check if current function has a return statemen
+    SymbolTable *symbolTable;      ///< Symbol table of the compilation being checked
+    Annotations *annotations;      ///< Where the types, conversions and call targets of the nodes are recorded
+    Errors *errorStack;            ///< Error list of the compilation being checked
+    ostream *log;                  ///< Where inline warnings are printed
+    ThreadPool *pool;              ///< Workers for checking subprogram bodies in parallel (NULL: see jobs)
+    unsigned jobs;                 ///< Threads of the pool started for the bodies when none is given (1: check serially)
+    long callLookups;              ///< Overload lookups made, added to the symbol table's counters at the end
+    CompileCache *cache;           ///< Holds the subprograms flagged CACHED, records the warnings of the others (NULL: none)
     /**
      * @brief Constructor for TypeVisitor
      *
      *
      * Initializes the type visitor for semantic analysis.
+     * @param ctx The compilation whose symbol table and error list are used
      */
-    TypeVisitor();
+    TypeVisitor(CompilationContext *ctx);
 
     /**
      * @brief Visit method for base Node objects
@@ -731,9 +791,10 @@ public:
 class CodeGenVisitor : public Visitor
 {
 private:
-    ofstream outFile;             ///< the file to write the code tp
+    string outputFilename;        ///< the file to write the code to
     int labelCount;               ///<  count of labels to faciltate naming the labels
     Func *currentFunctionContext; ///< To access function properties
+    const Annotations *annotations; ///< What semantic analysis recorded about each node
 
     // Helper to generate unique labels for jumps
     string newLabel();
@@ -741,19 +802,59 @@ private:
     // Helper to emit an instruction to the output file
     void emit(const string &instruction);
 
+    // Helper to emit an instruction whose opcode and operand are already separate
+    void emit(const string &op, const string &operand);
+
     // Helper to emit a label
     void emitLabel(const string &label);
 
+    // Helpers to push / pop a variable at the address NameResolver bound to it
+    void emitLoad(const VarAddress &address);
+    void emitStore(const VarAddress &address);
+
     /**
-     * @brief Emits assembly instructions to perform an array bounds check.
-     * Assumes the index to be checked is on top of the stack.
-     * If the check fails, it terminates the program with an error.
+     * @brief Emits the array bounds check, a single CHECK instruction.
+     * Assumes the index to be checked is on top of the stack, and leaves it there.
+     * If the check fails, the VM stops with an error.
      * @param arraySymbol The symbol representing the array, which contains the bounds.
      */
     void emitBoundsCheck(Symbol *arraySymbol);
 
+    /**
+     * @brief Emits a condition as jumps, without materializing its boolean value.
+     * Comparisons branch on their result, `and` and `or` skip their right operand
+     * once the left one decides, and `not` swaps the targets.
+     * @param exp The boolean expression
+     * @param trueLabel Where to go if it is true ("": fall through)
+     * @param falseLabel Where to go if it is false ("": fall through); at most one label is empty
+     */
+    void genCond(Exp *exp, const string &trueLabel, const string &falseLabel);
+
+    // Helper to push both operands of a comparison, converting one to real if the checker said so
+    void emitComparisonOperands(BinOp *b);
+
+    // Helper to emit a comparison, or its negation, leaving 1 or 0 on the stack
+    void emitComparison(BinOp *b, bool negate);
+
+    // Helper to push the 0/1 value of a condition, e.g. an and/or assigned to a variable
+    void emitCondValue(Exp *exp);
+
 public:
-    CodeGenVisitor(const string &filename);
+    InstructionBuffer code; ///< The generated program, kept in memory until Flush
+    CompileCache *cache;    ///< Supplies the code of the subprograms flagged CACHED, records the others (NULL: none)
+
+    /**
+     * @brief Constructor for CodeGenVisitor
+     * @param filename The file to write the code to
+     * @param annotations Types, conversions and symbols recorded by semantic analysis
+     */
+    CodeGenVisitor(const string &filename, const Annotations *annotations);
+
+    /**
+     * @brief Writes the generated program to the output file in one write
+     * @return true if all the code was written successfully
+     */
+    bool Flush();
 
     /**
      * @brief Visit method for base Node objects
@@ -18,7 +18,10 @@
 #ifndef AST_H
 #define AST_H
 
+#include <cstdint>
 #include <vector>
+#include "Arena.h"
+#include "Interner.h"
 
 using namespace std;
 
@@ -94,6 +97,36 @@ enum OpType {
     OP_AND, OP_OR ///< Logical operators
 };
 
+/**
+ * @typedef NodeId
+ * @brief Pre-order number of a node in its tree, indexes the Annotations tables
+ */
+typedef uint32_t NodeId;
+
+/**
+ * @brief ID of a node that has not been numbered
+ */
+const NodeId NO_NODE_ID = 0xFFFFFFFFu;
+
+/**
+ * @enum NodeKind
+ * @brief Identifies the concrete class of an AST node
+ *
+ * One value per concrete (instantiable) node class, stored in Node::kind
+ * and used as the node tag of the flat AST in bench/flat_ast.h. The kinds
+ * of each abstract base (Type, SubHead, Stmt, Var, Exp, BinOp) are
+ * contiguous, so isa<> on a base class is a range check (see KindRange).
+ */
+enum NodeKind {
+    NK_PROG, NK_IDENT, NK_DECS, NK_PARDEC, NK_IDENTLIST, NK_STDTYPE, NK_ARRAY, //< Program and declarations
+    NK_SUBDECS, NK_SUBDEC, NK_FUNC, NK_PROC, NK_ARGS, NK_PARLIST, NK_LOCALDECS, NK_LOCALDEC, //< Subprograms
+    NK_OPTIONALSTMTS, NK_STMTLIST, NK_COMPSTMT, NK_ASSIGN, NK_PROCSTMT, NK_IFTHEN, NK_IFTHENELSE, NK_WHILE, //< Statements
+    NK_VAR, NK_ARRAYELEMENT, NK_EXPLIST, NK_IDEXP, NK_ARRAYEXP, NK_INTEGER, NK_REAL, NK_BOOL, //< Variables and operands
+    NK_UNARYMINUS, NK_NOT, NK_FUNCCALL, //< Unary expressions and calls
+    NK_ADD, NK_SUB, NK_MULT, NK_DIVIDE, NK_INTDIV, NK_GT, NK_LT, NK_GE, NK_LE, NK_ET, NK_NE, NK_AND, NK_OR, //< Binary operators
+    NK_COUNT ///< Number of node kinds (also the kind of a node not yet tagged)
+};
+
 /**
  * @brief Converts a TypeEnum value to its string representation
  * @param type The TypeEnum to convert
@@ -101,6 +134,12 @@ enum OpType {
  */
 string TypeEnumToString(TypeEnum );
 
+/**
+ * @brief List of child nodes, stored in the compilation's arena
+ */
+template <class T>
+using NodeList = vector<T, ArenaAllocator<T>>;
+
 /**
  * @class Node
  * @brief Base class for all AST nodes
@@ -111,6 +150,8 @@ string TypeEnumToString(TypeEnum );
 class Node 
 {
 public:
+    NodeKind kind; ///< Concrete class of the node, set by its constructor
+    NodeId nodeId; ///< Row of the node in the Annotations tables (NO_NODE_ID until numbered)
     int line; ///< Source line number for error 
     int column; ///< Source column number for error 
     Node *father; ///< Parent node in the AST
@@ -120,6 +161,18 @@ public:
      * @param col Column number in source code
      */
     Node(int lin, int col);
+    /**
+     * @brief Allocates nodes from the current arena (see ArenaScope)
+     *
+     * Outside an arena scope nodes come from the heap and are never freed.
+     * Arena nodes are never destroyed, so a node class that owns heap memory
+     * must define its own operator new and operator delete on the heap.
+     */
+    static void *operator new(size_t size);
+    /**
+     * @brief Nodes are released with their arena, never one by one
+     */
+    static void operator delete(void *) {}
     /**
      * @brief Virtual accept method for the Visitor pattern
      * @param v The visitor object
@@ -131,6 +184,14 @@ public:
     virtual void accept(Visitor* ); 
 };
 
+/**
+ * @brief Returns the number of AST nodes created so far by the calling thread
+ *
+ * A compilation runs on a single thread, so the difference of two calls
+ * around the parser is the size of the tree it built.
+ */
+size_t astNodeCount();
+
 /**
  * @class Prog
  * @brief Represents the entire program
@@ -169,8 +230,22 @@ public:
 class Ident : public Node
 {
 public:
-    string name; ///< The identifier name
-    Symbol* symbol; ///< Corresponding symbol in symbol table
+    NameId nameId; ///< Interned ID of the identifier
+    const string &name; ///< The identifier name, lower-cased (owned by the interner)
+    VarAddress address; ///< Where the variable lives, bound by NameResolver (variables only)
+    /**
+     * @brief Constructor for Ident from an already interned name
+     * @param name ID and spelling returned by Interner::InternName
+     * @param lin Line number in source code
+     * @param col Column number in source code
+     */
+    Ident(const InternedName &, int, int);
+    /**
+     * @brief Constructor for Ident, interns the given spelling
+     * @param n Spelling of the identifier
+     * @param lin Line number in source code
+     * @param col Column number in source code
+     */
     Ident(string, int, int);
     /**
      * @brief Virtual accept method for the Visitor pattern
@@ -189,7 +264,7 @@ public:
 class Decs : public Node 
 {
 public:
-    vector<ParDec *> * decs; ///< List of parameter declarations
+    NodeList<ParDec *> *decs; ///< List of parameter declarations
     /**
      * @brief Constructor for Decs
      * @param lin Line number in source code
@@ -246,7 +321,7 @@ public:
 class IdentList : public Node
 {
 public:
-    vector<Ident *> *identLst; ///< List of identifiers
+    NodeList<Ident *> *identLst; ///< List of identifiers
     /**
      * @brief Constructor for IdentList
      * @param id Initial identifier in the list
@@ -352,7 +427,7 @@ public:
 class SubDecs : public Node 
 {
 public:
-    vector<SubDec*>* subdecs; ///< List of subprogram declarations
+    NodeList<SubDec *> *subdecs; ///< List of subprogram declarations
     /**
      * @brief Constructor for SubDecs
      * @param lin Line number in source code
@@ -510,7 +585,7 @@ public:
 class ParList : public Node
 {
 public:
-    vector<ParDec*> * parList; ///< List of parameter declarations
+    NodeList<ParDec *> *parList; ///< List of parameter declarations
     /**
      * @brief Constructor for ParList
      * @param prDec Initial parameter declaration
@@ -540,7 +615,7 @@ public:
 class LocalDecs: public Node
 {
 public: 
-    vector<LocalDec*>* localDecs;  ///< collection of local declarations
+    NodeList<LocalDec *> *localDecs;  ///< collection of local declarations
     /**
      * @brief Constructor for LocalDecs
      * @param lin Line number in source code
@@ -619,7 +694,7 @@ class OptionalStmts : public Node
 class StmtList : public Node 
 {
     public:
-    vector<Stmt*> * stmts; ///< List of statements
+    NodeList<Stmt *> *stmts; ///< List of statements
     /**
      * @brief Constructor for StmtList
      * @param st Initial statement in the list
@@ -745,7 +820,7 @@ public:
 class ExpList : public Node
 {
 public:
-    vector<Exp*> * expList; ///< List of expressions
+    NodeList<Exp *> *expList; ///< List of expressions
     /**
      * @brief Constructor for ExpList
      * @param ex Initial expression in the list
@@ -773,7 +848,6 @@ public:
 class Exp : public Node
 {
 public:
-    TypeEnum type; ///< The datatype of the value of the expression
     /**
      * @brief Constructor for Exp
      * @param lin Line number in source code
@@ -1420,7 +1494,6 @@ class Var : public Node
 {
 public:
     Ident* id; ///< the identifies of the variable
-    TypeEnum type; ///< the type of the variable
     Var(Ident*, int, int);
     /** 
      * @brief Virtual accept method for the Visitor pattern
@@ -1455,4 +1528,128 @@ public:
     virtual void accept(Visitor* ); 
 };
 
+/**
+ * @struct KindRange
+ * @brief The node kinds belonging to a node class (its own kind, or the
+ *        contiguous kinds of its subclasses for an abstract base)
+ */
+template <class T>
+struct KindRange;
+
+#define NODE_KIND_RANGE(T, FIRST, LAST)          \
+    template <>                                  \
+    struct KindRange<T>                          \
+    {                                            \
+        static const NodeKind first = FIRST;     \
+        static const NodeKind last = LAST;       \
+    };
+#define NODE_KIND(T, KIND) NODE_KIND_RANGE(T, KIND, KIND)
+
+NODE_KIND_RANGE(Node, NK_PROG, NK_OR)
+NODE_KIND(Prog, NK_PROG)
+NODE_KIND(Ident, NK_IDENT)
+NODE_KIND(Decs, NK_DECS)
+NODE_KIND(ParDec, NK_PARDEC)
+NODE_KIND(IdentList, NK_IDENTLIST)
+NODE_KIND_RANGE(Type, NK_STDTYPE, NK_ARRAY)
+NODE_KIND(StdType, NK_STDTYPE)
+NODE_KIND(Array, NK_ARRAY)
+NODE_KIND(SubDecs, NK_SUBDECS)
+NODE_KIND(SubDec, NK_SUBDEC)
+NODE_KIND_RANGE(SubHead, NK_FUNC, NK_PROC)
+NODE_KIND(Func, NK_FUNC)
+NODE_KIND(Proc, NK_PROC)
+NODE_KIND(Args, NK_ARGS)
+NODE_KIND(ParList, NK_PARLIST)
+NODE_KIND(LocalDecs, NK_LOCALDECS)
+NODE_KIND(LocalDec, NK_LOCALDEC)
+NODE_KIND(OptionalStmts, NK_OPTIONALSTMTS)
+NODE_KIND(StmtList, NK_STMTLIST)
+NODE_KIND_RANGE(Stmt, NK_COMPSTMT, NK_WHILE)
+NODE_KIND(CompStmt, NK_COMPSTMT)
+NODE_KIND(Assign, NK_ASSIGN)
+NODE_KIND(ProcStmt, NK_PROCSTMT)
+NODE_KIND(IfThen, NK_IFTHEN)
+NODE_KIND(IfThenElse, NK_IFTHENELSE)
+NODE_KIND(While, NK_WHILE)
+NODE_KIND_RANGE(Var, NK_VAR, NK_ARRAYELEMENT)
+NODE_KIND(ArrayElement, NK_ARRAYELEMENT)
+NODE_KIND(ExpList, NK_EXPLIST)
+NODE_KIND_RANGE(Exp, NK_IDEXP, NK_OR)
+NODE_KIND(IdExp, NK_IDEXP)
+NODE_KIND(ArrayExp, NK_ARRAYEXP)
+NODE_KIND(Integer, NK_INTEGER)
+NODE_KIND(Real, NK_REAL)
+NODE_KIND(Bool, NK_BOOL)
+NODE_KIND(UnaryMinus, NK_UNARYMINUS)
+NODE_KIND(Not, NK_NOT)
+NODE_KIND(FuncCall, NK_FUNCCALL)
+NODE_KIND_RANGE(BinOp, NK_ADD, NK_OR)
+NODE_KIND(Add, NK_ADD)
+NODE_KIND(Sub, NK_SUB)
+NODE_KIND(Mult, NK_MULT)
+NODE_KIND(Divide, NK_DIVIDE)
+NODE_KIND(IntDiv, NK_INTDIV)
+NODE_KIND(GT, NK_GT)
+NODE_KIND(LT, NK_LT)
+NODE_KIND(GE, NK_GE)
+NODE_KIND(LE, NK_LE)
+NODE_KIND(ET, NK_ET)
+NODE_KIND(NE, NK_NE)
+NODE_KIND(And, NK_AND)
+NODE_KIND(Or, NK_OR)
+
+#undef NODE_KIND
+#undef NODE_KIND_RANGE
+
+/**
+ * @brief Checks whether a node is a T (or a subclass of T) using its kind tag
+ * @param n The node (may be NULL)
+ * @return true if n is not NULL and is a T
+ */
+template <class T>
+inline bool isa(const Node *n)
+{
+    return n && n->kind >= KindRange<T>::first && n->kind <= KindRange<T>::last;
+}
+
+/**
+ * @brief Converts a node known to be a T, without a runtime type lookup
+ * @param n The node, which must satisfy isa<T>
+ */
+template <class T>
+inline T *cast(Node *n)
+{
+    return static_cast<T *>(n);
+}
+
+/**
+ * @brief Converts a node to T if it is one, the tag-based dynamic_cast
+ * @param n The node (may be NULL)
+ * @return n as a T, or NULL if it is not a T
+ */
+template <class T>
+inline T *dyn_cast(Node *n)
+{
+    return isa<T>(n) ? static_cast<T *>(n) : NULL;
+}
+
+/**
+ * @brief Tells whether evaluating an expression calls a function
+ *
+ * A call may assign globals, so passes that track values or drop an
+ * evaluation must look for one.
+ * @param e The expression
+ */
+bool callsFunction(Exp *e);
+
+/**
+ * @brief Tells whether evaluating an expression may stop the VM or have an effect
+ *
+ * True for calls, array accesses (bounds CHECK) and divisions, so an
+ * evaluation is only dropped when it cannot fault at run time.
+ * @param e The expression
+ */
+bool mayTrap(Exp *e);
+
 #endif
\ No newline at end of file
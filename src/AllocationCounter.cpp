@@ -0,0 +1,33 @@
+#include "TimeReport.h"
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+// Replaces the global operator new and operator delete of the program that
+// links this file, to count allocations for --time-report. Only the compiler
+// executable does (see LIB_OBJS in the Makefile): the benchmarks and other
+// programs built on the compiler's objects keep the standard allocator. The
+// flag is read once per allocation and set before any compilation starts.
+
+void *operator new(size_t size)
+{
+    if (TimeReport::countAllocations)
+        TimeReport::threadAllocations++;
+    if (size == 0)
+        size = 1;
+    void *p = malloc(size);
+    if (!p)
+        throw bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
@@ -0,0 +1,39 @@
+#include "Annotations.h"
+#include "StaticVisitor.h"
+
+using namespace std;
+
+// Gives every node of a tree the next ID, parents before their children
+class NodeNumberer : public StaticVisitor<NodeNumberer>
+{
+public:
+    using StaticVisitor<NodeNumberer>::Visit;
+    NodeId next = 0;
+
+    void Enter(Node *n) { n->nodeId = this->next++; }
+};
+
+size_t Annotations::Number(Node *root)
+{
+    NodeNumberer numberer;
+    numberer.Dispatch(root);
+    this->types.assign(numberer.next, VOID);
+    this->flags.assign(numberer.next, 0);
+    this->symbols.assign(numberer.next, NULL);
+    return numberer.next;
+}
+
+NodeId Annotations::Add(Node *n)
+{
+    n->nodeId = this->types.size();
+    this->types.push_back(VOID);
+    this->flags.push_back(0);
+    this->symbols.push_back(NULL);
+    return n->nodeId;
+}
+
+size_t Annotations::MemoryBytes() const
+{
+    return this->types.capacity() * sizeof(uint8_t) + this->flags.capacity() * sizeof(uint8_t) +
+           this->symbols.capacity() * sizeof(Symbol *);
+}
@@ -0,0 +1,70 @@
+#include "Arena.h"
+#include <cstdlib>
+#include <cstdint>
+
+using namespace std;
+
+// The arena Node::operator new draws from on this thread
+static thread_local Arena *currentArena = NULL;
+
+Arena::Arena(size_t blockSize)
+{
+    this->cursor = NULL;
+    this->limit = NULL;
+    this->blockSize = blockSize;
+    this->used = 0;
+    this->reserved = 0;
+}
+
+Arena::~Arena()
+{
+    for (char *block : this->blocks)
+        free(block);
+}
+
+void *Arena::Allocate(size_t size, size_t align)
+{
+    uintptr_t p = ((uintptr_t)this->cursor + align - 1) & ~(uintptr_t)(align - 1);
+    if (!this->cursor || p + size > (uintptr_t)this->limit)
+    {
+        // Oversized requests get a block of their own
+        size_t n = size + align > this->blockSize ? size + align : this->blockSize;
+        char *block = (char *)malloc(n);
+        if (!block)
+            throw bad_alloc();
+        this->blocks.push_back(block);
+        this->reserved += n;
+        this->cursor = block;
+        this->limit = block + n;
+        p = ((uintptr_t)block + align - 1) & ~(uintptr_t)(align - 1);
+    }
+    this->cursor = (char *)(p + size);
+    this->used += size;
+    return (void *)p;
+}
+
+size_t Arena::BytesUsed() const
+{
+    return this->used;
+}
+
+size_t Arena::BytesReserved() const
+{
+    return this->reserved;
+}
+
+Arena *Arena::Current()
+{
+    return currentArena;
+}
+
+ArenaScope::ArenaScope(Arena *arena)
+{
+    this->previous = currentArena;
+    currentArena = arena;
+}
+
+ArenaScope::~ArenaScope()
+{
+    currentArena = this->previous;
+}
@@ -1,19 +1,19 @@
 #include "Visitor.h"
 #include "ast.h"
 #include "CommonTypes.h"
+#include "Annotations.h"
+#include "CompileCache.h"
 #include <iostream>
 
 using namespace std;
 
-CodeGenVisitor::CodeGenVisitor(const string &filename)
+CodeGenVisitor::CodeGenVisitor(const string &filename, const Annotations *annotations)
 {
+    this->annotations = annotations;
     labelCount = 0;
     currentFunctionContext = nullptr;
-    outFile.open(filename);
-    if (!outFile.is_open())
-    {
-        cerr << "Error: Could not open output file " << filename << endl;
-    }
+    outputFilename = filename;
+    cache = NULL;
 }
 
 string CodeGenVisitor::newLabel()
@@ -21,48 +21,40 @@ string CodeGenVisitor::newLabel()
     return "L" + to_string(labelCount++);
 }
 
-void CodeGenVisitor::emit(const string &instruction)
+bool CodeGenVisitor::Flush()
 {
-    if (outFile.is_open())
-    {
-        outFile << "    " << instruction << endl;
-    }
+    return code.WriteFile(outputFilename);
 }
 
-void CodeGenVisitor::emitLabel(const string &label)
+void CodeGenVisitor::emit(const string &instruction)
 {
-    if (outFile.is_open())
-    {
-        outFile << label << ":" << endl;
-    }
+    code.Emit(instruction);
 }
 
-void CodeGenVisitor::emitBoundsCheck(Symbol* arraySymbol) {
-    string lowerOkLabel = newLabel();
-    string upperOkLabel = newLabel();
-
-    // Lower bound check: index < beginIndex?
-    emit("// --- Array Bounds Check ---\n");
-    emit("DUP 1");
-    emit("PUSHI " + to_string(arraySymbol->beginIndex));
-    emit("INF"); 
+void CodeGenVisitor::emit(const string &op, const string &operand)
+{
+    code.Emit(op, operand);
+}
 
-    emit("JZ " + lowerOkLabel);
-    emit("ERR \"Runtime Error: Array index out of bounds.\"");
-    emit("STOP");
-    emitLabel(lowerOkLabel);
+void CodeGenVisitor::emitLabel(const string &label)
+{
+    code.EmitLabel(label);
+}
 
-    // Upper bound check:  index > endIndex?
-    emit("DUP 1");
-    emit("PUSHI " + to_string(arraySymbol->endIndex));
-    emit("SUP");
+void CodeGenVisitor::emitLoad(const VarAddress &address)
+{
+    // globals live at depth 0, locals and parameters in a subprogram frame
+    emit(address.depth == 0 ? "PUSHG" : "PUSHL", to_string(address.offset));
+}
 
-    emit("JZ " + upperOkLabel);
-    emit("ERR \"Runtime Error: Array index out of bounds.\"");
-    emit("STOP");
-    emitLabel(upperOkLabel);
-    emit("// --- End Bounds Check ---\n");
+void CodeGenVisitor::emitStore(const VarAddress &address)
+{
+    emit(address.depth == 0 ? "STOREG" : "STOREL", to_string(address.offset));
+}
 
+void CodeGenVisitor::emitBoundsCheck(Symbol* arraySymbol) {
+    // CHECK leaves the index on the stack and stops the VM if it is out of range
+    emit("CHECK", to_string(arraySymbol->beginIndex) + " " + to_string(arraySymbol->endIndex));
 }
 // Visit Methods Implementation
 void CodeGenVisitor::Visit(Node *n)
@@ -115,14 +107,14 @@ void CodeGenVisitor::Visit(Prog *n)
 
         for (auto *dec : *n->declarations->decs)
         {
-            if (Array *arr = dynamic_cast<Array *>(dec->tp))
+            if (Array *arr = dyn_cast<Array>(dec->tp))
             {
                 int size = arr->endIndex - arr->beginIndex + 1;
                 for (auto *id : *dec->identList->identLst)
                 {
                     emit("PUSHI " + to_string(size));
                     emit("ALLOCN");                                  // Allocates block, pushes base address
-                    emit("STOREG " + to_string(id->symbol->Offset)); // Store base address in global var slot
+                    emitStore(id->address);                          // Store base address in global var slot
                 }
             }
         }
@@ -136,13 +128,6 @@ void CodeGenVisitor::Visit(Prog *n)
     emit("STOP");
     if (n->subDeclarations)
         n->subDeclarations->accept(this);
-        
-
-
-    if (outFile.is_open())
-    {
-        outFile.close();
-    }
 }
 
 void CodeGenVisitor::Visit(SubDecs *n)
@@ -155,13 +140,20 @@ void CodeGenVisitor::Visit(SubDecs *n)
 
 void CodeGenVisitor::Visit(SubDec *n)
 {
+    if (annotations->FlagsOf(n) & CACHED)
+    {
+        cache->AppendCode(n, code, labelCount);
+        return;
+    }
+    size_t first = code.code.size();
+    int firstLabel = labelCount;
+
     emit("// --- Sub Declaration Definition ---\n");
-    Func *func = dynamic_cast<Func *>(n->subHead);
-    Proc *proc = dynamic_cast<Proc *>(n->subHead);
-    FunctionSignature *name = func ? func->id->symbol->funcSig : proc->id->symbol->funcSig;
-    string label = func ? 'f' + name->getSignatureString() : 'p' + name->getSignatureString();
+    Func *func = dyn_cast<Func>(n->subHead);
+    Proc *proc = dyn_cast<Proc>(n->subHead);
+    FunctionSignature *name = annotations->SymbolOf(func ? func->id : proc->id)->funcSig;
 
-    emitLabel(label);
+    emitLabel(name->label);
     if (func)
     {
         currentFunctionContext = func;
@@ -182,14 +174,14 @@ void CodeGenVisitor::Visit(SubDec *n)
 
         for (auto *l_dec : *n->localDecs->localDecs)
         {
-            if (Array *arr = dynamic_cast<Array *>(l_dec->tp))
+            if (Array *arr = dyn_cast<Array>(l_dec->tp))
             {
                 int size = arr->endIndex - arr->beginIndex + 1;
                 for (auto *id : *l_dec->identlist->identLst)
                 {
                     emit("PUSHI " + to_string(size));
                     emit("ALLOCN");
-                    emit("STOREL " + to_string(id->symbol->Offset));
+                    emitStore(id->address);
                 }
             }
         }
@@ -200,6 +192,8 @@ void CodeGenVisitor::Visit(SubDec *n)
     emit("RETURN");
 
     currentFunctionContext = nullptr;
+    if (cache)
+        cache->RecordCode(n, code, first, firstLabel, labelCount);
 }
 
 void CodeGenVisitor::Visit(Func *n) { /* Handled in SubDec */ }
@@ -227,38 +221,24 @@ void CodeGenVisitor::Visit(StmtList *n)
 void CodeGenVisitor::Visit(IdExp *e)
 {
 
-    Symbol *sym = e->id->symbol;
-    if (!sym)
+    if (!e->id->address.IsBound())
         return;
 
-    if (sym->Kind == GLOBAL_VAR)
-    {
-        emit("PUSHG " + to_string(sym->Offset));
-    }
-    else
-    { // LOCAL_VAR or PARAM_VAR
-        emit("PUSHL " + to_string(sym->Offset));
-    }
+    emitLoad(e->id->address);
 }
 void CodeGenVisitor::Visit(ArrayExp *a)
 {
 
-    Symbol *sym = a->id->symbol;
+    Symbol *sym = annotations->SymbolOf(a->id);
     if (!sym)
         return;
 
-    if (sym->Kind == GLOBAL_VAR)
-    {
-        emit("PUSHG " + to_string(sym->Offset));
-    }
-    else
-    {
-        emit("PUSHL " + to_string(sym->Offset));
-    }
+    emitLoad(a->id->address);
     // stack: [xxxx, base_address]
 
     a->index->accept(this); // push index
-     emitBoundsCheck(sym); // * check the index to be in range;
+    if (!(annotations->FlagsOf(a) & IN_BOUNDS))
+        emitBoundsCheck(sym); // * check the index to be in range;
     emit("PUSHI " + to_string(sym->beginIndex));
     emit("SUB"); // reall index (k) = index - begIndex
     // Stack: [xxxx, base_address, k]
@@ -271,7 +251,7 @@ void CodeGenVisitor::Visit(Assign *n)
     n->exp->accept(this);
 
     // Check if this is a function return assignment
-    if (currentFunctionContext && n->var->id->name == currentFunctionContext->id->name)
+    if (currentFunctionContext && n->var->id->nameId == currentFunctionContext->id->nameId)
     {
         int num_params = 0;
         if (currentFunctionContext->args && currentFunctionContext->args->parList)
@@ -284,20 +264,12 @@ void CodeGenVisitor::Visit(Assign *n)
         // return value at fp[-(1 + num_params)]
         emit("STOREL " + to_string(-(1 + num_params)));
     }
-    else if (n->var->id->symbol)
+    else if (Symbol *sym = annotations->SymbolOf(n->var->id))
     {
-        Symbol *sym = n->var->id->symbol;
-        if (ArrayElement *a = dynamic_cast<ArrayElement *>(n->var))
+        if (ArrayElement *a = dyn_cast<ArrayElement>(n->var))
         {
             //? Stack [xxx, val]
-            if (sym->Kind == GLOBAL_VAR)
-            {
-                emit("PUSHG " + to_string(sym->Offset));
-            }
-            else
-            {
-                emit("PUSHL " + to_string(sym->Offset));
-            }
+            emitLoad(n->var->id->address);
 
             //? Stack [xxx, val, ArrayAddress]
             emit("SWAP");
@@ -307,7 +279,8 @@ void CodeGenVisitor::Visit(Assign *n)
             a->index->accept(this);
             //? Stack [xxx, ArrayAddress,val, indexAccess]
 
-            emitBoundsCheck(sym); // * check the index to be in range;
+            if (!(annotations->FlagsOf(a) & IN_BOUNDS))
+                emitBoundsCheck(sym); // * check the index to be in range;
 
 
             emit("PUSHI " + to_string(sym->beginIndex));
@@ -322,13 +295,9 @@ void CodeGenVisitor::Visit(Assign *n)
 
             emit("STOREN");
         }
-        else if (sym->Kind == GLOBAL_VAR)
-        {
-            emit("STOREG " + to_string(sym->Offset));
-        }
         else
-        { // LOCAL_VAR or PARAM_VAR
-            emit("STOREL " + to_string(sym->Offset));
+        {
+            emitStore(n->var->id->address);
         }
     }
 }
@@ -337,8 +306,7 @@ void CodeGenVisitor::Visit(IfThen *n)
 {
     emit("// --- If Then Statement ---\n");
     string endLabel = newLabel();
-    n->expr->accept(this);
-    emit("JZ " + endLabel);
+    genCond(n->expr, "", endLabel);
     n->stmt->accept(this);
     emitLabel(endLabel);
 }
@@ -348,8 +316,7 @@ void CodeGenVisitor::Visit(IfThenElse *n)
     emit("// --- If Then Else Statement ---\n");
     string elseLabel = newLabel();
     string endLabel = newLabel();
-    n->expr->accept(this);
-    emit("JZ " + elseLabel);
+    genCond(n->expr, "", elseLabel);
     n->trueStmt->accept(this);
     emit("JUMP " + endLabel);
     emitLabel(elseLabel);
@@ -360,14 +327,14 @@ void CodeGenVisitor::Visit(IfThenElse *n)
 void CodeGenVisitor::Visit(While *n)
 {
     emit("// --- While Statement ---\n");
-    string startLabel = newLabel();
-    string endLabel = newLabel();
-    emitLabel(startLabel);
-    n->expr->accept(this);
-    emit("JZ " + endLabel);
+    string bodyLabel = newLabel();
+    string condLabel = newLabel();
+    // the condition is placed after the body, so an iteration takes one jump, not two
+    emit("JUMP " + condLabel);
+    emitLabel(bodyLabel);
     n->stmt->accept(this);
-    emit("JUMP " + startLabel);
-    emitLabel(endLabel);
+    emitLabel(condLabel);
+    genCond(n->expr, bodyLabel, "");
 }
 
 void CodeGenVisitor::Visit(FuncCall *n)
@@ -384,13 +351,14 @@ void CodeGenVisitor::Visit(FuncCall *n)
             n->exps->expList->at(i)->accept(this);
         }
     }
-    emit("PUSHA f" + n->id->symbol->funcSig->getSignatureString());
+    Symbol *sym = annotations->SymbolOf(n->id);
+    emit("PUSHA", sym->funcSig->label);
     emit("CALL");
 
     int num_params = 0;
-    if (n->id->symbol && n->id->symbol->funcSig && n->id->symbol->funcSig->paramTypes)
+    if (sym->funcSig && sym->funcSig->paramTypes)
     {
-        num_params = n->id->symbol->funcSig->paramTypes->size();
+        num_params = sym->funcSig->paramTypes->size();
     }
     if (num_params > 0)
     {
@@ -410,14 +378,15 @@ void CodeGenVisitor::Visit(ProcStmt *n)
             n->expls->expList->at(i)->accept(this);
         }
     }
-    //? Built in write method
-    if (n->id->name == "write")
+    //? Built in write method (a user procedure may be named write too)
+    Symbol *sym = annotations->SymbolOf(n->id);
+    if (sym->funcSig->builtIn)
     {
         if (n->expls && !n->expls->expList->empty())
         {
             Exp *argExp = n->expls->expList->at(0);
 
-            switch (argExp->type)
+            switch (annotations->TypeOf(argExp))
             {
             case INTTYPE:
             case BOOLTYPE:
@@ -434,13 +403,13 @@ void CodeGenVisitor::Visit(ProcStmt *n)
     }
     else
     {
-        emit("PUSHA p" + n->id->symbol->funcSig->getSignatureString());
+        emit("PUSHA", sym->funcSig->label);
         emit("CALL");
 
         int num_params = 0;
-        if (n->id->symbol && n->id->symbol->funcSig && n->id->symbol->funcSig->paramTypes)
+        if (sym->funcSig && sym->funcSig->paramTypes)
         {
-            num_params = n->id->symbol->funcSig->paramTypes->size();
+            num_params = sym->funcSig->paramTypes->size();
         }
         if (num_params > 0)
         {
@@ -458,15 +427,15 @@ void CodeGenVisitor::Visit(Add *b)
     emit("// --- Addition Op ---\n");
 
     b->leftExp->accept(this);
-    if (b->type == REALTYPE && b->leftExp->type == INTTYPE) {
+    if (annotations->FlagsOf(b) & ITOF_LEFT) {
         emit("ITOF");
     }
     b->rightExp->accept(this);
-    if (b->type == REALTYPE && b->rightExp->type == INTTYPE) {
+    if (annotations->FlagsOf(b) & ITOF_RIGHT) {
         emit("ITOF");
     }
 
-    emit(b->type == REALTYPE ? "FADD" : "ADD");
+    emit(annotations->TypeOf(b) == REALTYPE ? "FADD" : "ADD");
 }
 
 void CodeGenVisitor::Visit(Sub *b)
@@ -474,15 +443,15 @@ void CodeGenVisitor::Visit(Sub *b)
     emit("// --- Subtraction Op ---\n");
 
     b->leftExp->accept(this);
-    if (b->type == REALTYPE && b->leftExp->type == INTTYPE) {
+    if (annotations->FlagsOf(b) & ITOF_LEFT) {
         emit("ITOF");
     }
     b->rightExp->accept(this);
-    if (b->type == REALTYPE && b->rightExp->type == INTTYPE) {
+    if (annotations->FlagsOf(b) & ITOF_RIGHT) {
         emit("ITOF");
     }
 
-    emit(b->type == REALTYPE ? "FSUB" : "SUB");
+    emit(annotations->TypeOf(b) == REALTYPE ? "FSUB" : "SUB");
 }
 
 void CodeGenVisitor::Visit(Mult *b)
@@ -490,15 +459,15 @@ void CodeGenVisitor::Visit(Mult *b)
     emit("// --- Multiplication Op ---\n");
     
     b->leftExp->accept(this);
-    if (b->type == REALTYPE && b->leftExp->type == INTTYPE) {
+    if (annotations->FlagsOf(b) & ITOF_LEFT) {
         emit("ITOF");
     }
     b->rightExp->accept(this);
-    if (b->type == REALTYPE && b->rightExp->type == INTTYPE) {
+    if (annotations->FlagsOf(b) & ITOF_RIGHT) {
         emit("ITOF");
     }
 
-    emit(b->type == REALTYPE ? "FMUL" : "MUL");
+    emit(annotations->TypeOf(b) == REALTYPE ? "FMUL" : "MUL");
 }
 
 void CodeGenVisitor::Visit(Divide *b)
@@ -508,11 +477,11 @@ void CodeGenVisitor::Visit(Divide *b)
     string ProbLabel = newLabel();
     
     b->leftExp->accept(this);
-    if (b->type == REALTYPE && b->leftExp->type == INTTYPE) {
+    if (annotations->FlagsOf(b) & ITOF_LEFT) {
         emit("ITOF");
     }
     b->rightExp->accept(this);
-    if (b->type == REALTYPE && b->rightExp->type == INTTYPE) {
+    if (annotations->FlagsOf(b) & ITOF_RIGHT) {
         emit("ITOF");
     }
     
@@ -560,147 +529,159 @@ void CodeGenVisitor::Visit(IntDiv *b)
 void CodeGenVisitor::Visit(GT *b)
 {
     emit("// --- Greater Than Op ---\n");
-    
-    b->leftExp->accept(this);
-    b->rightExp->accept(this);
-    if (b->rightExp->type == INTTYPE && b->leftExp->type == REALTYPE) {
-        emit("ITOF");
-    }
-    else if(b->rightExp->type == REALTYPE && b->leftExp->type == INTTYPE){
-        emit("SWAP");
-        emit("ITOF");
-        emit("SWAP");
-    }
-
-    emit(b->leftExp->type == REALTYPE || b->rightExp->type == REALTYPE ? "FSUP" : "SUP");
+    emitComparison(b, false);
 }
 
 void CodeGenVisitor::Visit(LT *b)
 {
     emit("// --- Less Than Op ---\n");
-    
-   b->leftExp->accept(this);
-    b->rightExp->accept(this);
-    if (b->rightExp->type == INTTYPE && b->leftExp->type == REALTYPE) {
-        emit("ITOF");
-    }
-    else if(b->rightExp->type == REALTYPE && b->leftExp->type == INTTYPE){
-        emit("SWAP");
-        emit("ITOF");
-        emit("SWAP");
-    }
-
-    emit(b->leftExp->type == REALTYPE || b->rightExp->type == REALTYPE ? "FINF" : "INF");
+    emitComparison(b, false);
 }
 
 void CodeGenVisitor::Visit(GE *b)
 {
     emit("// --- Greater Than or Equal Op ---\n");
-    
-   b->leftExp->accept(this);
-    b->rightExp->accept(this);
-    if (b->rightExp->type == INTTYPE && b->leftExp->type == REALTYPE) {
-        emit("ITOF");
-    }
-    else if(b->rightExp->type == REALTYPE && b->leftExp->type == INTTYPE){
-        emit("SWAP");
-        emit("ITOF");
-        emit("SWAP");
-    }
-
-    emit(b->leftExp->type == REALTYPE || b->rightExp->type == REALTYPE ? "FSUPEQ" : "SUPEQ");
+    emitComparison(b, false);
 }
 
 void CodeGenVisitor::Visit(LE *b)
 {
     emit("// --- Less Than or Equal Op ---\n");
-    
-    b->leftExp->accept(this);
-    b->rightExp->accept(this);
-    if (b->rightExp->type == INTTYPE && b->leftExp->type == REALTYPE) {
-        emit("ITOF");
-    }
-    else if(b->rightExp->type == REALTYPE && b->leftExp->type == INTTYPE){
-        emit("SWAP");
-        emit("ITOF");
-        emit("SWAP");
-    }
-
-    emit(b->leftExp->type == REALTYPE || b->rightExp->type == REALTYPE ? "FINFEQ" : "INFEQ");
+    emitComparison(b, false);
 }
 
 void CodeGenVisitor::Visit(ET *b)
+{
+    emitComparison(b, false);
+}
+
+void CodeGenVisitor::Visit(NE *b)
+{
+    emit("// --- Not Equal Op ---\n");
+    emitComparison(b, false);
+}
+
+void CodeGenVisitor::emitComparisonOperands(BinOp *b)
 {
     b->leftExp->accept(this);
     b->rightExp->accept(this);
-    if (b->rightExp->type == INTTYPE && b->leftExp->type == REALTYPE) {
+    if (annotations->FlagsOf(b) & ITOF_RIGHT) {
         emit("ITOF");
     }
-    else if(b->rightExp->type == REALTYPE && b->leftExp->type == INTTYPE){
+    else if (annotations->FlagsOf(b) & ITOF_LEFT) {
         emit("SWAP");
         emit("ITOF");
         emit("SWAP");
     }
+}
 
-    emit("EQUAL");
+void CodeGenVisitor::emitComparison(BinOp *b, bool negate)
+{
+    emitComparisonOperands(b);
+    bool real = annotations->FlagsOf(b) & REAL_OPERANDS;
+    NodeKind kind = b->kind;
+    // integer orderings have an exact complement; real ones are negated after the test
+    if (negate && (!real || kind == NK_ET || kind == NK_NE))
+    {
+        switch (kind)
+        {
+        case NK_GT: kind = NK_LE; break;
+        case NK_LT: kind = NK_GE; break;
+        case NK_GE: kind = NK_LT; break;
+        case NK_LE: kind = NK_GT; break;
+        case NK_ET: kind = NK_NE; break;
+        default: kind = NK_ET; break;
+        }
+        negate = false;
+    }
+    switch (kind)
+    {
+    case NK_GT: emit(real ? "FSUP" : "SUP"); break;
+    case NK_LT: emit(real ? "FINF" : "INF"); break;
+    case NK_GE: emit(real ? "FSUPEQ" : "SUPEQ"); break;
+    case NK_LE: emit(real ? "FINFEQ" : "INFEQ"); break;
+    case NK_ET: emit("EQUAL"); break;
+    default:
+        emit("EQUAL");
+        emit("NOT");
+        break;
+    }
+    if (negate)
+        emit("NOT");
 }
 
-void CodeGenVisitor::Visit(NE *b)
+void CodeGenVisitor::genCond(Exp *exp, const string &trueLabel, const string &falseLabel)
 {
-    emit("// --- Not Equal Op ---\n");
-    
-    b->leftExp->accept(this);
-    b->rightExp->accept(this);
-    if (b->rightExp->type == INTTYPE && b->leftExp->type == REALTYPE) {
-        emit("ITOF");
+    if (Not *n = dyn_cast<Not>(exp))
+    {
+        genCond(n->exp, falseLabel, trueLabel);
+        return;
     }
-    else if(b->rightExp->type == REALTYPE && b->leftExp->type == INTTYPE){
-        emit("SWAP");
-        emit("ITOF");
-        emit("SWAP");
+    if (And *b = dyn_cast<And>(exp))
+    {
+        // a false left operand decides: the right one is skipped
+        string leftFalse = falseLabel.empty() ? newLabel() : falseLabel;
+        genCond(b->leftExp, "", leftFalse);
+        genCond(b->rightExp, trueLabel, falseLabel);
+        if (falseLabel.empty())
+            emitLabel(leftFalse);
+        return;
+    }
+    if (Or *b = dyn_cast<Or>(exp))
+    {
+        // a true left operand decides: the right one is skipped
+        string leftTrue = trueLabel.empty() ? newLabel() : trueLabel;
+        genCond(b->leftExp, leftTrue, "");
+        genCond(b->rightExp, trueLabel, falseLabel);
+        if (trueLabel.empty())
+            emitLabel(leftTrue);
+        return;
+    }
+    if (Bool *bl = dyn_cast<Bool>(exp))
+    {
+        const string &target = bl->val ? trueLabel : falseLabel;
+        if (!target.empty())
+            emit("JUMP " + target);
+        return;
     }
 
-    emit("EQUAL");
-    emit("NOT");
+    // JZ is the only conditional jump: to reach the true label, test the negation
+    bool negate = falseLabel.empty();
+    if (exp->kind >= NK_GT && exp->kind <= NK_NE)
+        emitComparison(cast<BinOp>(exp), negate);
+    else
+    {
+        exp->accept(this);
+        if (negate)
+            emit("NOT");
+    }
+    emit("JZ " + (negate ? trueLabel : falseLabel));
+    if (!negate && !trueLabel.empty())
+        emit("JUMP " + trueLabel);
 }
 
-void CodeGenVisitor::Visit(And *b)
+void CodeGenVisitor::emitCondValue(Exp *exp)
 {
-    emit("// --- And Op ---\n");
     string falseLabel = newLabel();
     string endLabel = newLabel();
-
-    // b->leftExp->accept(this);
-    // b->rightExp->accept(this);
-    // emit("ADD"); 
-    // emit("PUSHI 2");
-    // emit("EQUAL");
-
-    // Short Cirtuting the And operation
-    b->leftExp->accept(this);
-    emit("JZ " + falseLabel);
-
-    b->rightExp->accept(this); 
-    emit("JZ " + falseLabel);
-
-    emit("PUSHI 1");           
+    genCond(exp, "", falseLabel);
+    emit("PUSHI 1");
     emit("JUMP " + endLabel);
-
     emitLabel(falseLabel);
-    emit("PUSHI 0");        
-
+    emit("PUSHI 0");
     emitLabel(endLabel);
+}
 
+void CodeGenVisitor::Visit(And *b)
+{
+    emit("// --- And Op ---\n");
+    emitCondValue(b);
 }
 
 void CodeGenVisitor::Visit(Or *b)
 {
     emit("// --- Or Op ---\n");
-    b->leftExp->accept(this);
-    b->rightExp->accept(this);
-    emit("ADD");
-    emit("PUSHI 0");
-    emit("SUP");
+    emitCondValue(b);
 }
 
 void CodeGenVisitor::Visit(Not *n)
@@ -714,7 +695,7 @@ void CodeGenVisitor::Visit(UnaryMinus *n)
 {
     emit("// --- Negation Op ---\n");
     n->exp->accept(this);
-    if (n->type == REALTYPE)
+    if (annotations->TypeOf(n) == REALTYPE)
     {
         emit("PUSHF -1.0");
         emit("FMUL");
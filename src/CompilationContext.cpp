@@ -0,0 +1,18 @@
+#include "CompilationContext.h"
+#include <iostream>
+
+CompilationContext::CompilationContext()
+{
+    this->root = NULL;
+    this->errors = new Errors();
+    this->symbolTable = new SymbolTable(this->errors);
+    this->lin = 0;
+    this->col = 0;
+    this->log = &std::cout;
+}
+
+CompilationContext::~CompilationContext()
+{
+    delete this->symbolTable;
+    delete this->errors;
+}
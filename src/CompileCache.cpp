@@ -0,0 +1,445 @@
+#include "CompileCache.h"
+#include "Annotations.h"
+#include "CompilationContext.h"
+#include "HashFunctions.h"
+#include "SourceBuffer.h"
+#include "StaticVisitor.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+using namespace std;
+
+// Written at the top of every pack; change it whenever the code generator
+// or the pack layout changes, so entries of older compilers are not reused
+static const char CACHE_FORMAT[] = "MPVMCACHE 4";
+
+// Mixes a value into a running hash (order-sensitive)
+static uint64_t combine(uint64_t h, uint64_t v)
+{
+    return mixHash(h ^ (v + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2)));
+}
+
+static uint64_t hashString(const string &s)
+{
+    return fastHash(s.data(), s.size());
+}
+
+// Hashes a declared type: its standard type, and the bounds of an array
+static uint64_t hashType(Type *t)
+{
+    if (StdType *st = dyn_cast<StdType>(t))
+        return combine(1, st->type);
+    Array *arr = cast<Array>(t);
+    return combine(combine(combine(2, arr->stdType->type), (uint64_t)(int64_t)arr->beginIndex),
+                   (uint64_t)(int64_t)arr->endIndex);
+}
+
+// Hashes the signature of a subprogram: kind, name, parameter types and result type
+static uint64_t hashSignature(SubDec *sd)
+{
+    Func *func = dyn_cast<Func>(sd->subHead);
+    Proc *proc = dyn_cast<Proc>(sd->subHead);
+    Args *args = func ? func->args : proc->args;
+    uint64_t h = combine(func ? 'f' : 'p', hashString(func ? func->id->name : proc->id->name));
+    if (func)
+        h = combine(h, func->typ->type);
+    if (args && args->parList)
+        for (ParDec *pd : *(args->parList->parList))
+            for (size_t i = 0; i < pd->identList->identLst->size(); i++)
+                h = combine(h, hashType(pd->tp));
+    return h;
+}
+
+// Collects the names used anywhere in a subtree
+class NameCollector : public StaticVisitor<NameCollector>
+{
+public:
+    using StaticVisitor<NameCollector>::Visit;
+    vector<NameId> names;
+
+    void Enter(Node *n)
+    {
+        if (Ident *id = dyn_cast<Ident>(n))
+            this->names.push_back(id->nameId);
+    }
+};
+
+// Tells whether s is a label made by CodeGenVisitor::newLabel ("L<n>"), and its number
+static bool generatedLabel(const string &s, long &number)
+{
+    if (s.size() < 2 || s[0] != 'L')
+        return false;
+    number = 0;
+    for (size_t i = 1; i < s.size(); i++)
+    {
+        if (s[i] < '0' || s[i] > '9')
+            return false;
+        number = number * 10 + (s[i] - '0');
+    }
+    return true;
+}
+
+// Shifts the generated labels defined or used by an instruction by `offset`
+static void renumberLabels(VMInstr &instr, long offset)
+{
+    long number;
+    if (instr.kind == VMInstr::LABEL && generatedLabel(instr.op, number))
+        instr.op = "L" + to_string(number + offset);
+    else if (instr.kind == VMInstr::OP && generatedLabel(instr.operand, number))
+        instr.operand = "L" + to_string(number + offset);
+}
+
+// A pack is the format line, the number of entries, an index line per
+// entry ("key offset length", offsets counted from the end of the index),
+// then the entries. An entry is a line "labels warnings logWarnings code",
+// every diagnostic as "line column length" plus the message, and every
+// line of code as "kind length length" plus opcode and operand. Strings are
+// length-prefixed because comments in the code contain newlines.
+class PackReader
+{
+public:
+    bool ok; ///< false once a field was missing or out of range
+
+    PackReader(const string &text, size_t offset, size_t length)
+        : ok(true), p(text.data() + offset), end(text.data() + offset + length)
+    {
+    }
+
+    size_t Offset(const string &text) const { return this->p - text.data(); }
+
+    // A number, after the blanks before it
+    long long Number()
+    {
+        while (this->p < this->end && (*this->p == ' ' || *this->p == '\n'))
+            this->p++;
+        bool negative = this->p < this->end && *this->p == '-';
+        if (negative)
+            this->p++;
+        const char *digits = this->p;
+        long long value = 0;
+        while (this->p < this->end && *this->p >= '0' && *this->p <= '9')
+            value = value * 10 + (*this->p++ - '0');
+        this->ok &= this->p != digits;
+        return negative ? -value : value;
+    }
+
+    uint64_t Hex()
+    {
+        while (this->p < this->end && (*this->p == ' ' || *this->p == '\n'))
+            this->p++;
+        const char *digits = this->p;
+        uint64_t value = 0;
+        for (; this->p < this->end && isxdigit((unsigned char)*this->p); this->p++)
+            value = value * 16 + (*this->p <= '9' ? *this->p - '0' : (*this->p | 0x20) - 'a' + 10);
+        this->ok &= this->p != digits;
+        return value;
+    }
+
+    // A count or length, which cannot exceed what is left of the text
+    size_t Count()
+    {
+        long long value = this->Number();
+        this->ok &= value >= 0 && value <= this->end - this->p;
+        return this->ok ? (size_t)value : 0;
+    }
+
+    // The n bytes of a string, after the newline that ends its header
+    const char *Bytes(size_t n)
+    {
+        this->ok &= this->p < this->end && *this->p == '\n' && n < (size_t)(this->end - this->p);
+        if (!this->ok)
+            return this->end;
+        const char *bytes = this->p + 1;
+        this->p += n + 1;
+        return bytes;
+    }
+
+    bool AtEnd() const { return this->p == this->end; }
+
+private:
+    const char *p;   ///< Next unread byte
+    const char *end; ///< End of the part being read
+};
+
+static void readDiagnostics(PackReader &reader, vector<Diagnostic> &diagnostics, size_t count)
+{
+    diagnostics.resize(count);
+    for (Diagnostic &d : diagnostics)
+    {
+        d.line = reader.Number();
+        d.column = reader.Number();
+        size_t length = reader.Count();
+        d.Message.assign(reader.Bytes(length), reader.ok ? length : 0);
+    }
+}
+
+static void writeDiagnostics(string &text, const vector<Diagnostic> &diagnostics)
+{
+    for (const Diagnostic &d : diagnostics)
+    {
+        text += to_string(d.line) + ' ' + to_string(d.column) + ' ' + to_string(d.Message.size()) + '\n';
+        text += d.Message;
+    }
+}
+
+CompileCache::CompileCache(const string &directory, const string &sourceFile, const string &configuration)
+{
+    this->directory = directory;
+    this->configuration = configuration;
+    this->hits = 0;
+    this->packEntries = 0;
+
+    // one pack per source file, named after it (the hash tells apart files with the same name)
+    error_code ec;
+    string absolute = filesystem::absolute(sourceFile, ec).lexically_normal().string();
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "-%016llx.vmc", (unsigned long long)hashString(absolute));
+    this->packPath = directory + "/" + filesystem::path(sourceFile).filename().string() + suffix;
+}
+
+size_t CompileCache::Lookup(CompilationContext *ctx, const string &source)
+{
+    this->subprograms.clear();
+    this->hits = 0;
+    Prog *prog = ctx->root;
+    if (!prog->subDeclarations)
+        return 0;
+    NodeList<SubDec *> &subdecs = *prog->subDeclarations->subdecs;
+
+    FlatHashMap<uint64_t, pair<size_t, size_t>> packed;
+    this->readPack(packed);
+
+    vector<size_t> lineStarts(1, 0);
+    for (size_t i = 0; i < source.size(); i++)
+        if (source[i] == '\n')
+            lineStarts.push_back(i + 1);
+
+    // every subprogram depends on the addresses and types of the globals
+    uint64_t base = combine(hashString(CACHE_FORMAT), hashString(this->configuration));
+    if (prog->declarations)
+        for (ParDec *pd : *(prog->declarations->decs))
+        {
+            base = combine(base, hashType(pd->tp));
+            for (Ident *id : *(pd->identList->identLst))
+                base = combine(base, hashString(id->name));
+        }
+
+    // and on the signatures of the subprograms it names (all overloads of the name)
+    FlatHashMap<NameId, uint64_t> signatures;
+    for (SubDec *sd : subdecs)
+    {
+        Func *func = dyn_cast<Func>(sd->subHead);
+        NameId name = func ? func->id->nameId : cast<Proc>(sd->subHead)->id->nameId;
+        uint64_t *h = signatures.Find(name);
+        if (h)
+            *h = combine(*h, hashSignature(sd));
+        else
+            signatures.Insert(name, hashSignature(sd));
+    }
+
+    this->subprograms.resize(subdecs.size());
+    for (size_t i = 0; i < subdecs.size(); i++)
+    {
+        SubDec *sd = subdecs[i];
+        Func *func = dyn_cast<Func>(sd->subHead);
+        Ident *id = func ? func->id : cast<Proc>(sd->subHead)->id;
+        CachedSubprogram &entry = this->subprograms[i];
+        entry.firstLine = id->line + 1;
+
+        // the source lines from the subprogram's name to the end of its body
+        size_t first = min((size_t)id->line, lineStarts.size() - 1);
+        size_t last = max(first, min((size_t)sd->compStmt->line, lineStarts.size() - 1));
+        size_t begin = lineStarts[first];
+        size_t end = last + 1 < lineStarts.size() ? lineStarts[last + 1] : source.size();
+        uint64_t key = combine(base, fastHash(source.data() + begin, end - begin));
+        key = combine(key, hashSignature(sd));
+
+        NameCollector collector;
+        collector.Dispatch(sd);
+        sort(collector.names.begin(), collector.names.end());
+        collector.names.erase(unique(collector.names.begin(), collector.names.end()), collector.names.end());
+        for (NameId name : collector.names)
+            if (uint64_t *h = signatures.Find(name))
+                key = combine(combine(key, hashString(Interner::Global().Name(name))), *h);
+
+        entry.key = key;
+        entry.hit = false;
+        entry.labels = 0;
+        if (pair<size_t, size_t> *location = packed.Find(key))
+        {
+            entry.packOffset = location->first;
+            entry.packLength = location->second;
+            entry.hit = this->readEntry(entry);
+        }
+        if (entry.hit)
+        {
+            ctx->annotations.SetFlags(sd, CACHED);
+            this->hits++;
+        }
+        this->index.Insert(sd->nodeId, i);
+    }
+    return this->hits;
+}
+
+CachedSubprogram *CompileCache::Find(const SubDec *n)
+{
+    size_t *i = this->index.Find(n->nodeId);
+    return i ? &this->subprograms[*i] : NULL;
+}
+
+void CompileCache::AppendCode(const SubDec *n, InstructionBuffer &code, int &labelCount)
+{
+    CachedSubprogram *entry = this->Find(n);
+    // readEntry checked the code, so it is read without checks
+    PackReader reader(this->pack, entry->codeOffset, entry->packOffset + entry->packLength - entry->codeOffset);
+    for (size_t i = 0; i < entry->codeLines; i++)
+    {
+        VMInstr instr;
+        instr.kind = (VMInstr::Kind)reader.Number();
+        size_t opLength = reader.Count();
+        size_t operandLength = reader.Count();
+        const char *bytes = reader.Bytes(opLength + operandLength);
+        instr.op.assign(bytes, opLength);
+        instr.operand.assign(bytes + opLength, operandLength);
+        renumberLabels(instr, labelCount);
+        code.code.push_back(move(instr));
+    }
+    labelCount += entry->labels;
+}
+
+void CompileCache::RecordWarnings(const SubDec *n, const vector<Diagnostic> &warnings, size_t first,
+                                  const vector<Diagnostic> &logWarnings)
+{
+    CachedSubprogram *entry = this->Find(n);
+    entry->warnings.assign(warnings.begin() + first, warnings.end());
+    entry->logWarnings = logWarnings;
+    for (Diagnostic &d : entry->warnings)
+        d.line -= entry->firstLine;
+    for (Diagnostic &d : entry->logWarnings)
+        d.line -= entry->firstLine;
+}
+
+void CompileCache::RecordCode(const SubDec *n, const InstructionBuffer &code, size_t first, int firstLabel, int labelCount)
+{
+    CachedSubprogram *entry = this->Find(n);
+    entry->code.assign(code.code.begin() + first, code.code.end());
+    for (VMInstr &instr : entry->code)
+        renumberLabels(instr, -firstLabel);
+    entry->labels = labelCount - firstLabel;
+}
+
+bool CompileCache::Store() const
+{
+    // nothing to write if every subprogram was found and nothing else is in the pack
+    if (this->hits == this->subprograms.size() && this->packEntries == this->hits)
+        return true;
+
+    string entries, index;
+    for (const CachedSubprogram &entry : this->subprograms)
+    {
+        size_t offset = entries.size();
+        if (entry.hit)
+            entries.append(this->pack, entry.packOffset, entry.packLength);
+        else
+        {
+            entries += to_string(entry.labels) + ' ' + to_string(entry.warnings.size()) + ' ' +
+                       to_string(entry.logWarnings.size()) + ' ' + to_string(entry.code.size()) + '\n';
+            writeDiagnostics(entries, entry.warnings);
+            writeDiagnostics(entries, entry.logWarnings);
+            for (const VMInstr &instr : entry.code)
+            {
+                entries += to_string((int)instr.kind) + ' ' + to_string(instr.op.size()) + ' ' +
+                           to_string(instr.operand.size()) + '\n';
+                entries += instr.op;
+                entries += instr.operand;
+            }
+        }
+        char line[64];
+        snprintf(line, sizeof(line), "%016llx %zu %zu\n", (unsigned long long)entry.key, offset,
+                 entries.size() - offset);
+        index += line;
+    }
+
+    error_code ec;
+    filesystem::create_directories(this->directory, ec);
+    // unique per writer, so concurrent compilations of the file never share a temporary
+    uint64_t nonce = mixHash(chrono::steady_clock::now().time_since_epoch().count() ^
+                             hash<thread::id>()(this_thread::get_id()));
+    string temporary = this->packPath + "." + to_string(nonce) + ".tmp";
+    {
+        ofstream out(temporary, ios::binary);
+        out << CACHE_FORMAT << '\n' << this->subprograms.size() << '\n' << index << entries;
+        if (!out)
+        {
+            out.close();
+            remove(temporary.c_str());
+            return false;
+        }
+    }
+    // readers see the old pack or the new one, never half of it
+    filesystem::rename(temporary, this->packPath, ec);
+    if (ec)
+    {
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+void CompileCache::readPack(FlatHashMap<uint64_t, pair<size_t, size_t>> &entries)
+{
+    this->packEntries = 0;
+    string format = string(CACHE_FORMAT) + '\n';
+    if (!readFile(this->packPath, this->pack) || this->pack.compare(0, format.size(), format) != 0)
+        return;
+
+    PackReader reader(this->pack, format.size(), this->pack.size() - format.size());
+    size_t count = reader.Count();
+    vector<pair<uint64_t, pair<size_t, size_t>>> listed(count);
+    for (auto &e : listed)
+    {
+        e.first = reader.Hex();
+        e.second.first = reader.Count();
+        e.second.second = reader.Count();
+    }
+    if (!reader.ok)
+        return;
+    // the entries follow the newline that ends the index
+    size_t start = reader.Offset(this->pack) + 1;
+    for (auto &e : listed)
+    {
+        if (start + e.second.first + e.second.second > this->pack.size())
+            return;
+        if (!entries.Find(e.first))
+            entries.Insert(e.first, make_pair(start + e.second.first, e.second.second));
+    }
+    this->packEntries = count;
+}
+
+bool CompileCache::readEntry(CachedSubprogram &entry) const
+{
+    PackReader reader(this->pack, entry.packOffset, entry.packLength);
+    entry.labels = reader.Count();
+    size_t numWarnings = reader.Count();
+    size_t numLogWarnings = reader.Count();
+    entry.codeLines = reader.Count();
+    readDiagnostics(reader, entry.warnings, numWarnings);
+    readDiagnostics(reader, entry.logWarnings, numLogWarnings);
+    entry.codeOffset = reader.Offset(this->pack);
+
+    // check that the code fills the rest of the entry, so AppendCode cannot fail
+    for (size_t i = 0; i < entry.codeLines && reader.ok; i++)
+    {
+        reader.Number();
+        size_t opLength = reader.Count();
+        size_t operandLength = reader.Count();
+        reader.Bytes(opLength + operandLength);
+    }
+    return reader.ok && reader.AtEnd();
+}
@@ -0,0 +1,367 @@
+#include "CompileServer.h"
+#include "Error.h"
+#include "Interner.h"
+#include "SymbolTable.h"
+#include "ThreadPool.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Both directions start with one header line of numbers, followed by the
+// strings it gives the lengths of:
+//   request: "MPC2 hasText maxErrors timeReport useMmap optimize" and the lengths of
+//            the input name, output file, cache directory and source text
+//   reply:   "status" and the length of the log
+static const char PROTOCOL[] = "MPC2";
+
+// Largest string either side accepts, so a bad header cannot exhaust memory
+static const size_t MAX_FIELD = 1u << 30;
+
+// Names interned by past requests kept by default; a new request mostly reuses them
+static const size_t RETAINED_NAMES = 1u << 16;
+
+// Seconds a connection may go without sending or taking data before it is dropped
+static const int IO_TIMEOUT = 30;
+
+// Requests handled at once; further connections wait in the listen backlog
+static const unsigned MAX_ACTIVE = 64;
+
+#ifndef _WIN32
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// Sends all of `data`; a client that went away fails the call instead of raising SIGPIPE
+static bool sendAll(int fd, const string &data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        sent += n;
+    }
+    return true;
+}
+
+/**
+ * @brief Reads the header line and the strings of a message from a socket
+ */
+class MessageReader
+{
+public:
+    MessageReader(int fd) : fd(fd), used(0) {}
+
+    // Reads up to the end of the header line; returns the line without its newline
+    bool Header(string &line)
+    {
+        size_t end;
+        while ((end = this->buffer.find('\n')) == string::npos)
+            if (this->buffer.size() > 256 || !this->fill())
+                return false;
+        line = this->buffer.substr(0, end);
+        this->used = end + 1;
+        return true;
+    }
+
+    // Reads the next `length` bytes
+    bool Field(size_t length, string &field)
+    {
+        if (length > MAX_FIELD)
+            return false;
+        while (this->buffer.size() - this->used < length)
+            if (!this->fill())
+                return false;
+        field.assign(this->buffer, this->used, length);
+        this->used += length;
+        return true;
+    }
+
+private:
+    int fd;        ///< The socket
+    string buffer; ///< Bytes received so far
+    size_t used;   ///< Bytes of buffer already returned
+
+    bool fill()
+    {
+        char chunk[65536];
+        ssize_t n;
+        do
+            n = recv(this->fd, chunk, sizeof(chunk), 0);
+        while (n < 0 && errno == EINTR);
+        if (n <= 0)
+            return false;
+        this->buffer.append(chunk, n);
+        return true;
+    }
+};
+
+// Fills in the address of a socket path; false if the path is too long for it
+static bool socketAddress(const string &path, sockaddr_un &address)
+{
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        return false;
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+CompileServer::CompileServer(const string &socketPath, const CompileOptions &options)
+{
+    this->socketPath = socketPath;
+    this->options = options;
+    this->served = 0;
+    this->retainedNames = RETAINED_NAMES;
+    this->listenFd = -1;
+    this->stopPipe[0] = this->stopPipe[1] = -1;
+    this->active = 0;
+    this->pool = new ThreadPool(options.checkJobs);
+    this->options.pool = this->pool;
+    // the built-ins' names are interned once, with them, and must outlive every request
+    Errors errors;
+    SymbolTable builtIns(&errors);
+    initializeBuiltInFunctions(&builtIns);
+    this->startupNames = Interner::Global().Size();
+}
+
+CompileServer::~CompileServer()
+{
+    if (this->listenFd >= 0)
+    {
+        close(this->listenFd);
+        unlink(this->socketPath.c_str());
+    }
+    if (this->stopPipe[0] >= 0)
+    {
+        close(this->stopPipe[0]);
+        close(this->stopPipe[1]);
+    }
+    delete this->pool;
+}
+
+bool CompileServer::Listen(ostream &log)
+{
+    sockaddr_un address;
+    if (!socketAddress(this->socketPath, address))
+    {
+        log << "Socket path too long: " << this->socketPath << endl;
+        return false;
+    }
+
+    // A socket nobody accepts on was left by a server that died; replace it
+    struct stat st;
+    if (stat(this->socketPath.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+    {
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        bool inUse = probe >= 0 && connect(probe, (sockaddr *)&address, sizeof(address)) == 0;
+        if (probe >= 0)
+            close(probe);
+        if (inUse)
+        {
+            log << "A compile server is already listening on " << this->socketPath << endl;
+            return false;
+        }
+        unlink(this->socketPath.c_str());
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (sockaddr *)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0 ||
+        pipe(this->stopPipe) != 0)
+    {
+        log << "Cannot listen on " << this->socketPath << ": " << strerror(errno) << endl;
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+    this->listenFd = fd;
+    return true;
+}
+
+void CompileServer::Serve()
+{
+    pollfd fds[2] = {{this->listenFd, POLLIN, 0}, {this->stopPipe[0], POLLIN, 0}};
+    for (;;)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (fds[1].revents)
+            break;
+        int fd = accept(this->listenFd, NULL, NULL);
+        if (fd < 0)
+            continue;
+        // a client that stops sending or reading cannot hold its thread, or Stop, forever
+        timeval timeout = {IO_TIMEOUT, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        {
+            // a handler finishes within the timeouts and its compilation
+            unique_lock<mutex> g(this->activeLock);
+            this->idle.wait(g, [this]() { return this->active < MAX_ACTIVE; });
+            this->active++;
+        }
+        thread([this, fd]() {
+            this->handle(fd);
+            close(fd);
+            lock_guard<mutex> g(this->activeLock);
+            // no request can start while the lock is held, so none uses the names
+            if (--this->active == 0)
+                this->forgetNames();
+            this->idle.notify_all();
+        }).detach();
+    }
+
+    // stop taking requests, then let the ones in progress finish
+    close(this->listenFd);
+    unlink(this->socketPath.c_str());
+    this->listenFd = -1;
+    unique_lock<mutex> g(this->activeLock);
+    this->idle.wait(g, [this]() { return this->active == 0; });
+}
+
+void CompileServer::forgetNames()
+{
+    Interner &names = Interner::Global();
+    if (this->retainedNames != SIZE_MAX && names.Size() > this->startupNames + this->retainedNames)
+        names.Truncate(this->startupNames);
+}
+
+void CompileServer::Stop()
+{
+    // write() is async-signal-safe, unlike anything touching a lock
+    char wake = 0;
+    if (this->stopPipe[1] >= 0)
+        (void)!write(this->stopPipe[1], &wake, 1);
+}
+
+void CompileServer::handle(int fd)
+{
+    MessageReader reader(fd);
+    string header, input, output, cacheDir, text;
+    char protocol[8] = "";
+    int hasText = 0, timeReport = 0, useMmap = 1, optimize = 0;
+    size_t maxErrors = 0, inputLength = 0, outputLength = 0, cacheLength = 0, textLength = 0;
+    if (!reader.Header(header) ||
+        sscanf(header.c_str(), "%7s %d %zu %d %d %d %zu %zu %zu %zu", protocol, &hasText, &maxErrors, &timeReport,
+               &useMmap, &optimize, &inputLength, &outputLength, &cacheLength, &textLength) != 10 ||
+        strcmp(protocol, PROTOCOL) != 0 || !reader.Field(inputLength, input) ||
+        !reader.Field(outputLength, output) || !reader.Field(cacheLength, cacheDir) ||
+        !reader.Field(textLength, text) || (!hasText && input.empty()))
+    {
+        string message = "Malformed compile request\n";
+        sendAll(fd, "1 " + to_string(message.size()) + "\n" + message);
+        return;
+    }
+
+    CompileOptions requestOptions = this->options;
+    requestOptions.maxErrors = maxErrors;
+    requestOptions.timeReport = timeReport != 0;
+    requestOptions.useMmap = useMmap != 0;
+    requestOptions.optimize = optimize != 0;
+    requestOptions.cacheDir = cacheDir;
+
+    ostringstream log;
+    int status = hasText ? compileSource(input, text, output, requestOptions, log)
+                         : compileFile(input, output, requestOptions, log);
+    string reply = log.str();
+    sendAll(fd, to_string(status) + " " + to_string(reply.size()) + "\n" + reply);
+    this->served++;
+}
+
+int compileRemote(const string &socketPath, const string &inputFilename, const string *text,
+                  const string &outputFilename, const CompileOptions &options, ostream &log)
+{
+    sockaddr_un address;
+    int fd = socketAddress(socketPath, address) ? socket(AF_UNIX, SOCK_STREAM, 0) : -1;
+    if (fd < 0 || connect(fd, (sockaddr *)&address, sizeof(address)) != 0)
+    {
+        log << "Cannot reach the compile server at " << socketPath << endl;
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    // the server resolves paths against its own working directory
+    error_code ec;
+    string input = inputFilename.empty() || text ? inputFilename : filesystem::absolute(inputFilename, ec).string();
+    string output = filesystem::absolute(outputFilename, ec).string();
+    string cacheDir = options.cacheDir.empty() ? "" : filesystem::absolute(options.cacheDir, ec).string();
+    string body = text ? *text : "";
+
+    string request = string(PROTOCOL) + " " + to_string(text ? 1 : 0) + " " + to_string(options.maxErrors) + " " +
+                     to_string(options.timeReport ? 1 : 0) + " " + to_string(options.useMmap ? 1 : 0) + " " + to_string(options.optimize ? 1 : 0) + " " +
+                     to_string(input.size()) + " " + to_string(output.size()) + " " + to_string(cacheDir.size()) +
+                     " " + to_string(body.size()) + "\n" + input + output + cacheDir + body;
+
+    MessageReader reader(fd);
+    string header, reply;
+    int status;
+    size_t length;
+    bool ok = sendAll(fd, request) && reader.Header(header) &&
+              sscanf(header.c_str(), "%d %zu", &status, &length) == 2 && reader.Field(length, reply);
+    close(fd);
+    if (!ok)
+    {
+        log << "The compile server at " << socketPath << " did not answer" << endl;
+        return -1;
+    }
+    log << reply;
+    return status;
+}
+
+#else
+
+CompileServer::CompileServer(const string &socketPath, const CompileOptions &options)
+{
+    this->socketPath = socketPath;
+    this->options = options;
+    this->served = 0;
+    this->retainedNames = RETAINED_NAMES;
+    this->listenFd = -1;
+    this->active = 0;
+    this->startupNames = 0;
+    this->pool = NULL;
+}
+
+CompileServer::~CompileServer() {}
+
+bool CompileServer::Listen(ostream &log)
+{
+    log << "The compile server needs Unix domain sockets" << endl;
+    return false;
+}
+
+void CompileServer::Serve() {}
+
+void CompileServer::Stop() {}
+
+int compileRemote(const string &socketPath, const string &inputFilename, const string *text,
+                  const string &outputFilename, const CompileOptions &options, ostream &log)
+{
+    log << "The compile server needs Unix domain sockets" << endl;
+    return -1;
+}
+
+#endif
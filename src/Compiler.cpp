@@ -0,0 +1,218 @@
+#include "Compiler.h"
+#include "ast.h"
+#include "Error.h"
+#include "parser.h"
+#include "CommonTypes.h"
+#include "CompilationContext.h"
+#include "SourceBuffer.h"
+#include "TimeReport.h"
+#include "NameResolver.h"
+#include "CompileCache.h"
+#include "ConstantFolder.h"
+#include "PeepholeOptimizer.h"
+#include "RangeAnalysis.h"
+#include <cstdio>
+
+using namespace std;
+extern int yylex_init_extra(CompilationContext*, yyscan_t*);
+extern void yyset_in(FILE*, yyscan_t);
+extern int yylex_destroy(yyscan_t);
+
+// The built-in procedures: write(integer), write(real) and write(boolean), which prints 0 or 1
+struct BuiltIn {
+    Ident* ident;
+    FunctionSignature* sig;
+};
+
+// Builds the built-ins' identifiers and signatures once per process, on the
+// heap rather than in a compilation's arena. They are never modified, so
+// every compilation (on any thread) registers the same objects.
+static const vector<BuiltIn>& builtInFunctions() {
+    static const vector<BuiltIn> builtIns = []() {
+        ArenaScope heap(NULL);
+        vector<BuiltIn> list;
+        for (TypeEnum type : {INTTYPE, REALTYPE, BOOLTYPE}) {
+            std::vector<Type*>* params = new std::vector<Type*>();
+            params->push_back(new StdType(type, 0, 0));
+            FunctionSignature* sig = new FunctionSignature("write", params, VOID);
+            sig->builtIn = true;
+            list.push_back({new Ident("write", 0, 0), sig});
+        }
+        return list;
+    }();
+    return builtIns;
+}
+
+void initializeBuiltInFunctions(SymbolTable* st) {
+    for (const BuiltIn& builtIn : builtInFunctions())
+        st->AddSymbol(builtIn.ident, PROC, builtIn.sig);
+}
+
+// Runs the pipeline on one file (or on `text`, named input_filename, if
+// given), timing every phase into `report`
+static int runPipeline(const string& input_filename, const string* text, const string& output_filename,
+                       const CompileOptions& options, ostream& log, TimeReport& report) {
+    // Everything produced by this compilation lives in its context; the
+    // scanner and parser are reentrant and only see the context they are given.
+    CompilationContext ctx;
+    ctx.log = &log;
+    ctx.errors->maxErrors = options.maxErrors;
+    // Every node of this compilation, built-ins included, goes to ctx.arena
+    ArenaScope arenaScope(&ctx.arena);
+
+    report.Begin("scan/parse");
+    size_t nodesBefore = astNodeCount();
+    yyscan_t scanner;
+    yylex_init_extra(&ctx, &scanner);
+
+    // Source files are mapped and scanned in place, as is source text given
+    // in memory; stdin (or a file that cannot be mapped) goes through the
+    // regular buffered FILE* path.
+    SourceBuffer source;
+    FILE* input = NULL;
+    if (text) {
+        source.Load(*text);
+        scanSourceBuffer(&source, scanner);
+    }
+    else if (input_filename.empty()) {
+        input = stdin;
+        yyset_in(input, scanner);
+    }
+    else if (!options.useMmap || !source.Open(input_filename) || !scanSourceBuffer(&source, scanner)) {
+        input = fopen(input_filename.c_str(), "r");
+        if (!input) {
+            log << "Error opening input file: " << input_filename << endl;
+            yylex_destroy(scanner);
+            report.End();
+            return 1;
+        }
+        yyset_in(input, scanner);
+    }
+    initializeBuiltInFunctions(ctx.symbolTable);
+    // Parsing
+    yyparse(&ctx, scanner);
+    yylex_destroy(scanner);
+    if (input && input != stdin) fclose(input);
+    // Number the nodes of the finished tree for the annotation tables
+    if (ctx.root)
+        ctx.annotations.Number(ctx.root);
+    report.End();
+    report.astNodes = astNodeCount() - nodesBefore;
+    report.arenaBytes = ctx.arena.BytesReserved();
+    if (!ctx.root) {
+        log << "Parsing failed." << endl;
+        return 1;
+    }
+
+    // Subprograms found in the cache are not analyzed or translated again.
+    // A file is read once more for the keys (standard input is not cached).
+    // -O changes the generated code, so it is part of every cache key
+    CompileCache cache(options.cacheDir, input_filename, options.optimize ? "-O" : "");
+    bool useCache = !options.cacheDir.empty() && !input_filename.empty();
+    if (useCache) {
+        report.Begin("cache lookup");
+        string fileText;
+        if (!text)
+            readFile(input_filename, fileText);
+        report.cachedSubprograms = cache.Lookup(&ctx, text ? *text : fileText);
+        report.subprograms = cache.subprograms.size();
+        report.End();
+    }
+
+    report.Begin("name resolution");
+    NameResolver resolver(&ctx);
+    resolver.Dispatch(ctx.root);
+    report.End();
+
+    report.Begin("semantic analysis");
+    TypeVisitor typeVisitor(&ctx);
+    typeVisitor.pool = options.pool;
+    typeVisitor.jobs = options.checkJobs;
+    typeVisitor.cache = useCache ? &cache : NULL;
+    if (!ctx.errors->LimitReached())
+        ctx.root->accept(&typeVisitor);
+    report.End();
+    report.symbols = ctx.symbolTable->symbolCount;
+    report.scopes = ctx.symbolTable->Scopes->size();
+    report.lookups = ctx.symbolTable->lookupCount;
+    report.probes = ctx.symbolTable->probeCount;
+
+    ctx.errors->PrintWarnings(log);
+    ctx.errors->PrintErrors(log);
+
+    if (!ctx.errors->errorStack.empty())
+        return 1;
+
+    // -O: constant expressions become literals, then bounds checks the
+    // index ranges make redundant are left out
+    if (options.optimize) {
+        report.Begin("constant folding");
+        ConstantFolder folder(&ctx.annotations);
+        folder.Dispatch(ctx.root);
+        report.End();
+        report.constantsFolded = folder.folded;
+        report.constantUses = folder.propagated;
+
+        report.Begin("range analysis");
+        RangeAnalysis ranges(&ctx.annotations);
+        ranges.Dispatch(ctx.root);
+        report.End();
+        report.arrayAccesses = ranges.accesses;
+        report.checksRemoved = ranges.inBounds;
+    }
+
+    log << "No errors found. Generating code to " << output_filename << "..." << endl;
+    report.Begin("code generation");
+    CodeGenVisitor codeGen(output_filename, &ctx.annotations);
+    codeGen.cache = useCache ? &cache : NULL;
+    ctx.root->accept(&codeGen);
+    report.End();
+    report.instructions = codeGen.code.InstructionCount();
+
+    // -O: the generated sequences are cleaned up before they are written
+    if (options.optimize) {
+        report.Begin("peephole");
+        PeepholeOptimizer peephole;
+        peephole.Run(codeGen.code);
+        report.End();
+        report.unoptimizedInstructions = report.instructions;
+        report.instructions = codeGen.code.InstructionCount();
+        for (size_t rule = 0; rule < PeepholeOptimizer::RuleCount(); rule++)
+            if (peephole.applied[rule])
+                report.rewrites.push_back(make_pair(string(PeepholeOptimizer::RuleName(rule)), peephole.applied[rule]));
+    }
+
+    report.Begin("output");
+    bool written = codeGen.Flush();
+    report.End();
+    if (!written) {
+        log << "Error: Could not write output file " << output_filename << endl;
+        return 1;
+    }
+    log << "Code generation complete." << endl;
+    if (useCache) {
+        report.Begin("cache store");
+        cache.Store();
+        report.End();
+    }
+    report.arenaBytes = ctx.arena.BytesReserved();
+    return 0;
+}
+
+int compileFile(const string& input_filename, const string& output_filename,
+                const CompileOptions& options, ostream& log) {
+    TimeReport report;
+    int status = runPipeline(input_filename, NULL, output_filename, options, log, report);
+    if (options.timeReport)
+        report.Print(log, input_filename.empty() ? "<stdin>" : input_filename);
+    return status;
+}
+
+int compileSource(const string& name, const string& text, const string& output_filename,
+                  const CompileOptions& options, ostream& log) {
+    TimeReport report;
+    int status = runPipeline(name, &text, output_filename, options, log, report);
+    if (options.timeReport)
+        report.Print(log, name.empty() ? "<buffer>" : name);
+    return status;
+}
@@ -0,0 +1,325 @@
+#include "ConstantFolder.h"
+#include "SymbolTable.h"
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+using namespace std;
+
+// Largest integer magnitude ITOF converts without rounding in single precision
+static const long long EXACT_FLOAT_INTEGER = 1LL << 24;
+
+// Counts the assignments to the variables already present in a map
+class AssignmentCounter : public StaticVisitor<AssignmentCounter>
+{
+public:
+    using StaticVisitor<AssignmentCounter>::Visit;
+    const Annotations *annotations;
+    FlatHashMap<Symbol *, int> *counts;
+
+    AssignmentCounter(const Annotations *annotations, FlatHashMap<Symbol *, int> *counts)
+        : annotations(annotations), counts(counts) {}
+
+    void Visit(Assign *n)
+    {
+        if (n->var->kind != NK_VAR)
+            return;
+        Symbol *sym = this->annotations->SymbolOf(n->var->id);
+        int *count = sym ? this->counts->Find(sym) : NULL;
+        if (count)
+            (*count)++;
+    }
+};
+
+// The value the VM reads back from the text PUSHF writes for a float
+static double asWritten(float v)
+{
+    return strtod(to_string(v).c_str(), NULL);
+}
+
+// Tells whether a real is exact in single precision and written by PUSHF without loss
+static bool exactReal(double r)
+{
+    return isfinite(r) && (double)(float)r == r && asWritten((float)r) == r;
+}
+
+// Tells whether an integer result is one the VM computes without wrapping around
+static bool fitsInteger(long long v)
+{
+    return v >= INT32_MIN && v <= INT32_MAX;
+}
+
+ConstantFolder::ConstantFolder(Annotations *annotations)
+{
+    this->annotations = annotations;
+    this->folded = 0;
+    this->propagated = 0;
+}
+
+void ConstantFolder::Visit(SubDec *n)
+{
+    if (this->annotations->FlagsOf(n) & CACHED)
+        return;
+    this->assignments = FlatHashMap<Symbol *, int>();
+    this->values = FlatHashMap<Symbol *, Constant>();
+    if (n->localDecs)
+        for (LocalDec *ld : *(n->localDecs->localDecs))
+            if (isa<StdType>(ld->tp))
+                for (Ident *id : *(ld->identlist->identLst))
+                    if (Symbol *sym = this->annotations->SymbolOf(id))
+                        this->assignments.Insert(sym, 0);
+    AssignmentCounter counter(this->annotations, &this->assignments);
+    counter.Dispatch(n->compStmt);
+
+    OptionalStmts *stmts = n->compStmt->optitonalStmts;
+    if (stmts && stmts->stmtList)
+        for (Stmt *s : *(stmts->stmtList->stmts))
+        {
+            this->Dispatch(s);
+            this->recordConstant(s);
+        }
+    // nothing is propagated into the main body
+    this->values = FlatHashMap<Symbol *, Constant>();
+}
+
+void ConstantFolder::Visit(Assign *n)
+{
+    n->exp = this->fold(n->exp);
+    if (ArrayElement *element = dyn_cast<ArrayElement>(n->var))
+        element->index = this->fold(element->index);
+}
+
+void ConstantFolder::Visit(ProcStmt *n)
+{
+    this->foldAll(n->expls);
+}
+
+void ConstantFolder::Visit(IfThen *n)
+{
+    n->expr = this->fold(n->expr);
+    this->Dispatch(n->stmt);
+}
+
+void ConstantFolder::Visit(IfThenElse *n)
+{
+    n->expr = this->fold(n->expr);
+    this->Dispatch(n->trueStmt);
+    this->Dispatch(n->falseStmt);
+}
+
+void ConstantFolder::Visit(While *n)
+{
+    n->expr = this->fold(n->expr);
+    this->Dispatch(n->stmt);
+}
+
+Exp *ConstantFolder::fold(Exp *e)
+{
+    Constant c;
+    if (IdExp *id = dyn_cast<IdExp>(e))
+    {
+        Symbol *sym = this->annotations->SymbolOf(id->id);
+        Constant *value = sym ? this->values.Find(sym) : NULL;
+        if (!value)
+            return e;
+        this->propagated++;
+        return this->literal(e, *value);
+    }
+    if (ArrayExp *a = dyn_cast<ArrayExp>(e))
+    {
+        a->index = this->fold(a->index);
+        return e;
+    }
+    if (FuncCall *call = dyn_cast<FuncCall>(e))
+    {
+        this->foldAll(call->exps);
+        return e;
+    }
+    if (UnaryMinus *u = dyn_cast<UnaryMinus>(e))
+    {
+        u->exp = this->fold(u->exp);
+        if (!this->constantOf(u->exp, c))
+            return e;
+        if (c.type == INTTYPE && !fitsInteger(-c.i))
+            return e;
+        c.i = -c.i;
+        c.r = -c.r;
+    }
+    else if (Not *nt = dyn_cast<Not>(e))
+    {
+        nt->exp = this->fold(nt->exp);
+        if (!this->constantOf(nt->exp, c))
+            return e;
+        c.i = !c.i;
+    }
+    else if (BinOp *b = dyn_cast<BinOp>(e))
+    {
+        b->leftExp = this->fold(b->leftExp);
+        b->rightExp = this->fold(b->rightExp);
+        Exp *result = this->foldBinary(b);
+        if (result)
+            this->folded++;
+        return result ? result : e;
+    }
+    else
+        return e;
+    this->folded++;
+    return this->literal(e, c);
+}
+
+void ConstantFolder::foldAll(ExpList *list)
+{
+    if (!list)
+        return;
+    for (Exp *&arg : *(list->expList))
+        arg = this->fold(arg);
+}
+
+Exp *ConstantFolder::foldBinary(BinOp *b)
+{
+    Constant l, r, result;
+    bool leftConstant = this->constantOf(b->leftExp, l);
+    bool rightConstant = this->constantOf(b->rightExp, r);
+
+    if (isa<And>(b) || isa<Or>(b))
+    {
+        // the operand value that decides the result on its own
+        long long decisive = isa<Or>(b) ? 1 : 0;
+        result = Constant{BOOLTYPE, decisive, 0};
+        // the right operand is skipped once the left one decides, the left one never is,
+        // so it is only dropped when evaluating it can neither fault nor call
+        if (leftConstant && l.i == decisive)
+            return this->literal(b, result);
+        if (rightConstant && r.i == decisive && !mayTrap(b->leftExp))
+            return this->literal(b, result);
+        if (!leftConstant || !rightConstant)
+            return NULL;
+        result.i = isa<And>(b) ? (l.i && r.i) : (l.i || r.i);
+        return this->literal(b, result);
+    }
+    if (!leftConstant || !rightConstant)
+        return NULL;
+
+    unsigned flags = this->annotations->FlagsOf(b);
+    if (b->kind >= NK_GT && b->kind <= NK_NE)
+    {
+        // compared as reals after the conversions the type checker recorded
+        bool real = flags & REAL_OPERANDS;
+        if (real && (!this->toReal(l) || !this->toReal(r)))
+            return NULL;
+        double x = real ? l.r : l.i, y = real ? r.r : r.i;
+        bool truth;
+        switch (b->kind)
+        {
+        case NK_GT: truth = x > y; break;
+        case NK_LT: truth = x < y; break;
+        case NK_GE: truth = x >= y; break;
+        case NK_LE: truth = x <= y; break;
+        case NK_ET: truth = x == y; break;
+        default: truth = x != y; break;
+        }
+        return this->literal(b, Constant{BOOLTYPE, truth, 0});
+    }
+
+    if (this->annotations->TypeOf(b) == REALTYPE)
+    {
+        // an integer operand must be one the checker marked for ITOF
+        if ((l.type == INTTYPE && !(flags & ITOF_LEFT)) || (r.type == INTTYPE && !(flags & ITOF_RIGHT)))
+            return NULL;
+        if (!this->toReal(l) || !this->toReal(r))
+            return NULL;
+        double value;
+        switch (b->kind)
+        {
+        case NK_ADD: value = l.r + r.r; break;
+        case NK_SUB: value = l.r - r.r; break;
+        case NK_MULT: value = l.r * r.r; break;
+        case NK_DIVIDE:
+            if (r.r == 0) // left to the run-time check
+                return NULL;
+            value = l.r / r.r;
+            break;
+        default: return NULL;
+        }
+        if (!exactReal(value))
+            return NULL;
+        return this->literal(b, Constant{REALTYPE, 0, value});
+    }
+
+    if (l.type != INTTYPE || r.type != INTTYPE)
+        return NULL;
+    long long value;
+    switch (b->kind)
+    {
+    case NK_ADD: value = l.i + r.i; break;
+    case NK_SUB: value = l.i - r.i; break;
+    case NK_MULT: value = l.i * r.i; break;
+    case NK_INTDIV:
+        if (r.i == 0) // left to the run-time check
+            return NULL;
+        // truncation and flooring agree unless an operand is negative and the division inexact
+        if ((l.i < 0 || r.i < 0) && l.i % r.i != 0)
+            return NULL;
+        value = l.i / r.i;
+        break;
+    default: return NULL;
+    }
+    if (!fitsInteger(value))
+        return NULL;
+    return this->literal(b, Constant{INTTYPE, value, 0});
+}
+
+bool ConstantFolder::constantOf(Exp *e, Constant &c)
+{
+    if (Integer *i = dyn_cast<Integer>(e))
+        c = Constant{INTTYPE, i->val, 0};
+    else if (Bool *bl = dyn_cast<Bool>(e))
+        c = Constant{BOOLTYPE, bl->val, 0};
+    else if (Real *re = dyn_cast<Real>(e))
+    {
+        c = Constant{REALTYPE, 0, asWritten(re->val)};
+        return exactReal(c.r);
+    }
+    else
+        return false;
+    return true;
+}
+
+bool ConstantFolder::toReal(Constant &c)
+{
+    if (c.type == REALTYPE)
+        return true;
+    if (c.type != INTTYPE || c.i > EXACT_FLOAT_INTEGER || c.i < -EXACT_FLOAT_INTEGER)
+        return false;
+    c.type = REALTYPE;
+    c.r = (double)c.i;
+    return true;
+}
+
+Exp *ConstantFolder::literal(Exp *replaced, const Constant &c)
+{
+    Exp *lit;
+    if (c.type == REALTYPE)
+        lit = new Real((float)c.r, replaced->line, replaced->column);
+    else if (c.type == BOOLTYPE)
+        lit = new Bool(c.i != 0, replaced->line, replaced->column);
+    else
+        lit = new Integer((int)c.i, replaced->line, replaced->column);
+    lit->father = replaced->father;
+    this->annotations->Add(lit);
+    this->annotations->SetType(lit, c.type);
+    return lit;
+}
+
+void ConstantFolder::recordConstant(Stmt *s)
+{
+    Assign *a = dyn_cast<Assign>(s);
+    if (!a || a->var->kind != NK_VAR)
+        return;
+    Symbol *sym = this->annotations->SymbolOf(a->var->id);
+    int *count = sym ? this->assignments.Find(sym) : NULL;
+    Constant c;
+    // a constant of another type would be stored without conversion
+    if (count && *count == 1 && this->constantOf(a->exp, c) && c.type == this->annotations->TypeOf(a->var))
+        this->values.Insert(sym, c);
+}
@@ -4,54 +4,76 @@
 using namespace std;
 
 
-Error::Error(string message, int lin, int col) : Node(lin, col)
+Errors::Errors()
 {
-    this->Message = message;
+    this->maxErrors = 0;
+    this->duplicates = 0;
 }
 
-Errors::Errors()
+bool Errors::FirstReport(char severity, const string &message, int lin, int col)
 {
-    this->errorStack = new vector<Error *>;
-    this->warningsStack = new vector<Error *>;
+    string key = severity + to_string(lin) + ':' + to_string(col) + ':' + message;
+    if (this->seen.insert(key).second)
+        return true;
+    this->duplicates++;
+    return false;
 }
 
 void Errors::AddError(string message, int lin, int col)
 {
-    Error *newError = new Error(message, lin, col);
-    this->errorStack->push_back(newError);
+    if (this->LimitReached() || !this->FirstReport('E', message, lin, col))
+        return;
+    this->errorStack.push_back(Diagnostic{std::move(message), lin, col});
 }
 
 void Errors::AddWarning(string message, int lin, int col)
 {
-    Error *newWarning = new Error(message, lin, col);
-    this->warningsStack->push_back(newWarning);
+    if (!this->FirstReport('W', message, lin, col))
+        return;
+    this->warningsStack.push_back(Diagnostic{std::move(message), lin, col});
+}
+
+void Errors::Append(Errors &other)
+{
+    for (Diagnostic &d : other.errorStack)
+        this->AddError(std::move(d.Message), d.line, d.column);
+    for (Diagnostic &d : other.warningsStack)
+        this->AddWarning(std::move(d.Message), d.line, d.column);
+    this->duplicates += other.duplicates;
+    other.errorStack.clear();
+    other.warningsStack.clear();
+    other.duplicates = 0;
 }
 
-void Errors::PrintWarnings()
+void Errors::PrintWarnings(ostream &out)
 {
-    int n = this->warningsStack->size();
+    int n = this->warningsStack.size();
     if(n == 0)
         return;
-    cout << "** Found " << n << " Warnings **" << endl;
+    out << "** Found " << n << " Warnings **" << endl;
     for (int i = 0; i < n; i++)
     {
-        cout << "Warnning:" << this->warningsStack->at(i)->line << ":" << this->warningsStack->at(i)->column;
-        cout << " Message: " << this->warningsStack->at(i)->Message << endl;
+        out << "Warnning:" << this->warningsStack[i].line << ":" << this->warningsStack[i].column;
+        out << " Message: " << this->warningsStack[i].Message << endl;
     }
-    if(this->errorStack->size() == 0)
-        cout << "Not a problem, but might face unexpected behaviour" << endl;
+    if(this->errorStack.size() == 0)
+        out << "Not a problem, but might face unexpected behaviour" << endl;
 }
 
-void Errors::PrintErrors()
+void Errors::PrintErrors(ostream &out)
 {
-    int n = this->errorStack->size();
+    int n = this->errorStack.size();
     if(n == 0)
         return;
-    cout << "** Found " << n << " Errors **" << endl;
+    out << "** Found " << n << " Errors **" << endl;
     for (int i = 0; i < n; i++)
     {
-        cout << "Error:" << this->errorStack->at(i)->line << ":" << this->errorStack->at(i)->column;
-        cout << " Message: " << this->errorStack->at(i)->Message << endl;
+        out << "Error:" << this->errorStack[i].line << ":" << this->errorStack[i].column;
+        out << " Message: " << this->errorStack[i].Message << endl;
     }
-    cout << "Fix these then try to compile again ;)" << endl;
+    if (this->duplicates > 0)
+        out << "(" << this->duplicates << " repeated diagnostics not shown)" << endl;
+    if (this->LimitReached())
+        out << "** Stopped after " << n << " errors (--max-errors) **" << endl;
+    out << "Fix these then try to compile again ;)" << endl;
 }
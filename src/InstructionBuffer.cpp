@@ -0,0 +1,105 @@
+#include "InstructionBuffer.h"
+#include <fstream>
+
+using namespace std;
+
+void InstructionBuffer::Emit(const string &instruction)
+{
+    VMInstr instr;
+    if (instruction.compare(0, 2, "//") == 0 || instruction.find_first_not_of('\n') == string::npos)
+    {
+        instr.kind = VMInstr::TEXT;
+        instr.op = instruction;
+    }
+    else
+    {
+        instr.kind = VMInstr::OP;
+        size_t space = instruction.find(' ');
+        if (space == string::npos)
+            instr.op = instruction;
+        else
+        {
+            instr.op = instruction.substr(0, space);
+            instr.operand = instruction.substr(space + 1);
+        }
+    }
+    this->code.push_back(move(instr));
+}
+
+void InstructionBuffer::Emit(const string &op, const string &operand)
+{
+    VMInstr instr;
+    instr.kind = VMInstr::OP;
+    instr.op = op;
+    instr.operand = operand;
+    this->code.push_back(move(instr));
+}
+
+void InstructionBuffer::EmitLabel(const string &label)
+{
+    VMInstr instr;
+    instr.kind = VMInstr::LABEL;
+    instr.op = label;
+    this->code.push_back(move(instr));
+}
+
+size_t InstructionBuffer::InstructionCount() const
+{
+    size_t n = 0;
+    for (auto &instr : this->code)
+        if (instr.kind == VMInstr::OP)
+            n++;
+    return n;
+}
+
+string InstructionBuffer::ToString() const
+{
+    size_t size = 0;
+    for (auto &instr : this->code)
+        size += instr.op.size() + instr.operand.size() + 6;
+
+    string text;
+    text.reserve(size);
+    for (auto &instr : this->code)
+    {
+        switch (instr.kind)
+        {
+        case VMInstr::LABEL:
+            text += instr.op;
+            text += ":\n";
+            break;
+        case VMInstr::OP:
+            text += "    ";
+            text += instr.op;
+            if (!instr.operand.empty())
+            {
+                text += ' ';
+                text += instr.operand;
+            }
+            text += '\n';
+            break;
+        case VMInstr::TEXT:
+            text += "    ";
+            text += instr.op;
+            text += '\n';
+            break;
+        }
+    }
+    return text;
+}
+
+void InstructionBuffer::Write(ostream &out) const
+{
+    string text = this->ToString();
+    out.write(text.data(), text.size());
+}
+
+bool InstructionBuffer::WriteFile(const string &path) const
+{
+    ofstream out(path, ios::binary);
+    if (!out.is_open())
+        return false;
+    this->Write(out);
+    out.close();
+    return !out.fail();
+}
@@ -0,0 +1,61 @@
+#include "Interner.h"
+
+using namespace std;
+
+Interner &Interner::Global()
+{
+    static Interner instance;
+    return instance;
+}
+
+InternedName Interner::InternName(const char *text, size_t len)
+{
+    // folded into a buffer kept by the thread, so a lookup that hits does not allocate
+    static thread_local string folded;
+    folded.assign(text, len);
+    for (auto &c : folded)
+        if (c >= 'A' && c <= 'Z')
+            c = c - 'A' + 'a';
+
+    lock_guard<mutex> g(this->lock);
+    auto found = this->ids.find(folded);
+    if (found != this->ids.end())
+        return InternedName{found->second, &found->first};
+    NameId id = this->names.size();
+    auto inserted = this->ids.emplace(folded, id).first;
+    this->names.push_back(&inserted->first);
+    return InternedName{id, &inserted->first};
+}
+
+NameId Interner::Intern(const char *text, size_t len)
+{
+    return this->InternName(text, len).id;
+}
+
+NameId Interner::Intern(const string &text)
+{
+    return this->Intern(text.data(), text.size());
+}
+
+const string &Interner::Name(NameId id)
+{
+    lock_guard<mutex> g(this->lock);
+    return *this->names[id];
+}
+
+size_t Interner::Size()
+{
+    lock_guard<mutex> g(this->lock);
+    return this->names.size();
+}
+
+void Interner::Truncate(size_t size)
+{
+    lock_guard<mutex> g(this->lock);
+    while (this->names.size() > size)
+    {
+        // erased through an iterator: the key passed to erase(key) would be the one destroyed
+        this->ids.erase(this->ids.find(*this->names.back()));
+        this->names.pop_back();
+    }
+}
@@ -0,0 +1,150 @@
+#include "NameResolver.h"
+#include "CompilationContext.h"
+#include "Error.h"
+
+using namespace std;
+
+NameResolver::NameResolver(CompilationContext *ctx)
+{
+    this->symbolTable = ctx->symbolTable;
+    this->annotations = &ctx->annotations;
+    this->errors = ctx->errors;
+    this->currentFunction = nullptr;
+    this->unit = 0;
+}
+
+void NameResolver::Declare(Ident *id, SymbolKind kind, Type *type)
+{
+    Symbol *sym = this->symbolTable->AddSymbol(id, kind, type);
+    if (!sym)
+        return;
+    this->annotations->SetSymbol(id, sym);
+    id->address = sym->Address();
+
+    Symbol **binding = this->visible.Find(id->nameId);
+    if (binding)
+    {
+        this->shadowed.push_back(make_pair(id->nameId, *binding));
+        *binding = sym;
+    }
+    else
+    {
+        this->shadowed.push_back(make_pair(id->nameId, (Symbol *)NULL));
+        this->visible.Insert(id->nameId, sym);
+    }
+}
+
+void NameResolver::Bind(Ident *id)
+{
+    this->symbolTable->lookupCount++;
+    this->symbolTable->probeCount++;
+    Symbol *sym = this->visible.Get(id->nameId);
+    if (!sym)
+    {
+        int *reportedIn = this->undeclared.Find(id->nameId);
+        if (reportedIn && *reportedIn == this->unit)
+            return;
+        if (reportedIn)
+            *reportedIn = this->unit;
+        else
+            this->undeclared.Insert(id->nameId, this->unit);
+        this->errors->AddError("Undeclared Variable: " + id->name, id->line + 1, id->column);
+        return;
+    }
+    this->annotations->SetSymbol(id, sym);
+    id->address = sym->Address();
+}
+
+void NameResolver::Visit(Decs *n)
+{
+    for (ParDec *pd : *(n->decs))
+        for (Ident *id : *(pd->identList->identLst))
+            this->Declare(id, GLOBAL_VAR, pd->tp);
+}
+
+void NameResolver::Visit(SubDec *n)
+{
+    if (this->errors->LimitReached())
+        return;
+    Func *funcNode = dyn_cast<Func>(n->subHead);
+    Proc *procNode = dyn_cast<Proc>(n->subHead);
+    Ident *subId = funcNode ? funcNode->id : procNode->id;
+    Args *args = funcNode ? funcNode->args : procNode->args;
+    ParList *params = args ? args->parList : nullptr;
+
+    // the signature lists one type per parameter name
+    vector<Type *> *astParamTypes = new vector<Type *>();
+    if (params)
+        for (ParDec *pd : *(params->parList))
+            for (size_t i = 0; i < pd->identList->identLst->size(); ++i)
+                astParamTypes->push_back(pd->tp);
+    FunctionSignature *sig = funcNode ? new FunctionSignature(subId->name, astParamTypes, funcNode->typ->type)
+                                      : new FunctionSignature(subId->name, astParamTypes, VOID);
+    if (Symbol *subSym = this->symbolTable->AddSymbol(subId, funcNode ? FUNC : PROC, sig))
+        this->annotations->SetSymbol(subId, subSym);
+
+    // parameters and locals live in the subprogram's own scope
+    this->symbolTable->NewScope();
+    this->unit++;
+    size_t mark = this->shadowed.size();
+    Func *previousFunction = this->currentFunction;
+    this->currentFunction = funcNode;
+
+    if (params)
+        for (ParDec *pd : *(params->parList))
+            for (Ident *id : *(pd->identList->identLst))
+                this->Declare(id, PARAM_VAR, pd->tp);
+    if (n->localDecs)
+        for (LocalDec *ld : *(n->localDecs->localDecs))
+            for (Ident *id : *(ld->identlist->identLst))
+                this->Declare(id, LOCAL_VAR, ld->tp);
+
+    // the body of a subprogram taken from the cache is not analyzed again
+    if (!(this->annotations->FlagsOf(n) & CACHED))
+        this->Dispatch(n->compStmt);
+
+    this->currentFunction = previousFunction;
+    while (this->shadowed.size() > mark)
+    {
+        *this->visible.Find(this->shadowed.back().first) = this->shadowed.back().second;
+        this->shadowed.pop_back();
+    }
+    this->symbolTable->CloseScope();
+    this->unit++;
+}
+
+void NameResolver::Visit(StmtList *n)
+{
+    for (Stmt *stmt : *(n->stmts))
+    {
+        if (this->errors->LimitReached())
+            return;
+        this->Dispatch(stmt);
+    }
+}
+
+void NameResolver::Visit(Var *n)
+{
+    // assigning to the function's own name sets its result
+    if (this->currentFunction && n->id->nameId == this->currentFunction->id->nameId)
+        this->annotations->SetSymbol(n->id, this->annotations->SymbolOf(this->currentFunction->id));
+    else
+        this->Bind(n->id);
+}
+
+void NameResolver::Visit(ArrayElement *n)
+{
+    this->Bind(n->id);
+    this->Dispatch(n->index);
+}
+
+void NameResolver::Visit(IdExp *n)
+{
+    this->Bind(n->id);
+}
+
+void NameResolver::Visit(ArrayExp *n)
+{
+    this->Bind(n->id);
+    this->Dispatch(n->index);
+}
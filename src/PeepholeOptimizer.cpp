@@ -0,0 +1,318 @@
+#include "PeepholeOptimizer.h"
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+// The lines a rule matched, without the comments between them
+typedef vector<const VMInstr *> Window;
+
+// One row of the rule table
+struct PeepholeRule
+{
+    const char *name;                                       // Reported in the statistics
+    vector<const char *> pattern;                           // Opcodes, "A|B" for either, ":" for a label
+    bool (*rewrite)(const Window &m, vector<VMInstr> &out); // Builds the replacement, false to decline
+};
+
+static VMInstr instr(const string &op, const string &operand = "")
+{
+    VMInstr in;
+    in.kind = VMInstr::OP;
+    in.op = op;
+    in.operand = operand;
+    return in;
+}
+
+// Reads an integer operand; false if it is not one
+static bool integerOperand(const VMInstr *in, long long &v)
+{
+    char *end;
+    v = strtoll(in->operand.c_str(), &end, 10);
+    return !in->operand.empty() && *end == '\0';
+}
+
+// Tells whether an integer is one the VM holds without wrapping around
+static bool fitsInteger(long long v)
+{
+    return v >= INT32_MIN && v <= INT32_MAX;
+}
+
+// Pushes an integer, leaving the stack as PUSHI a; PUSHI b; op would
+static bool foldIntegers(const Window &m, vector<VMInstr> &out)
+{
+    long long a, b, r;
+    if (!integerOperand(m[0], a) || !integerOperand(m[1], b))
+        return false;
+    const string &op = m[2]->op;
+    r = op == "ADD" ? a + b : op == "SUB" ? a - b : a * b;
+    if (!fitsInteger(r))
+        return false;
+    out.push_back(instr("PUSHI", to_string(r)));
+    return true;
+}
+
+// x + a - b: one addition of a - b, or none if that is 0
+static bool mergeOffsets(const Window &m, vector<VMInstr> &out)
+{
+    long long a, b;
+    if (!integerOperand(m[0], a) || !integerOperand(m[2], b))
+        return false;
+    long long r = (m[1]->op == "ADD" ? a : -a) + (m[3]->op == "ADD" ? b : -b);
+    if (!fitsInteger(r))
+        return false;
+    if (r != 0)
+    {
+        out.push_back(instr("PUSHI", to_string(r)));
+        out.push_back(instr("ADD"));
+    }
+    return true;
+}
+
+// x + 0, x - 0 and x * 1 leave x
+static bool dropIdentity(const Window &m, vector<VMInstr> &)
+{
+    long long v;
+    return integerOperand(m[0], v) && v == (m[1]->op == "MUL" ? 1 : 0);
+}
+
+// The negation of a real constant, written by flipping its sign
+static bool negateReal(const Window &m, vector<VMInstr> &out)
+{
+    if (strtod(m[1]->operand.c_str(), NULL) != -1.0)
+        return false;
+    const string &v = m[0]->operand;
+    out.push_back(instr("PUSHF", v[0] == '-' ? v.substr(1) : "-" + v));
+    return true;
+}
+
+// a + (-x) is a - x and a - (-x) is a + x
+static bool subtractNegation(const Window &m, vector<VMInstr> &out)
+{
+    long long v;
+    bool real = m[0]->op == "PUSHF";
+    // integer and real operations are not mixed
+    if ((m[1]->op[0] == 'F') != real || (m[2]->op[0] == 'F') != real)
+        return false;
+    if (real ? strtod(m[0]->operand.c_str(), NULL) != -1.0 : !integerOperand(m[0], v) || v != -1)
+        return false;
+    bool add = m[2]->op == "ADD" || m[2]->op == "FADD";
+    out.push_back(instr(real ? (add ? "FSUB" : "FADD") : (add ? "SUB" : "ADD")));
+    return true;
+}
+
+// -(-x) is x
+static bool dropDoubleNegation(const Window &m, vector<VMInstr> &)
+{
+    long long a, b;
+    return integerOperand(m[0], a) && a == -1 && integerOperand(m[2], b) && b == -1;
+}
+
+// Converting the left operand of a comparison under a pushed right one: convert it first
+static bool convertBeforePush(const Window &m, vector<VMInstr> &out)
+{
+    out.push_back(instr("ITOF"));
+    out.push_back(*m[0]);
+    return true;
+}
+
+// Swapping twice changes nothing
+static bool dropSwaps(const Window &, vector<VMInstr> &)
+{
+    return true;
+}
+
+// A jump to the label right after it
+static bool dropJumpToNext(const Window &m, vector<VMInstr> &out)
+{
+    if (m[0]->operand != m[1]->op)
+        return false;
+    out.push_back(*m[1]);
+    return true;
+}
+
+// A constant index within the bounds needs no check
+static bool dropConstantCheck(const Window &m, vector<VMInstr> &out)
+{
+    long long v, begin, end;
+    char *rest;
+    begin = strtoll(m[1]->operand.c_str(), &rest, 10);
+    end = strtoll(rest, NULL, 10);
+    if (!integerOperand(m[0], v) || v < begin || v > end)
+        return false;
+    out.push_back(*m[0]);
+    return true;
+}
+
+// A constant element offset goes into the instruction
+static bool loadOffset(const Window &m, vector<VMInstr> &out)
+{
+    long long v;
+    if (!integerOperand(m[0], v))
+        return false;
+    out.push_back(instr("LOAD", m[0]->operand));
+    return true;
+}
+
+// [address, value] PUSHI k; SWAP; STOREN stores the value at address[k]
+static bool storeOffset(const Window &m, vector<VMInstr> &out)
+{
+    long long v;
+    if (!integerOperand(m[0], v))
+        return false;
+    out.push_back(instr("STORE", m[0]->operand));
+    return true;
+}
+
+// Tried in order at every position; the first that applies wins (at most 32, see rulesStartingWith)
+static const vector<PeepholeRule> RULES = {
+    {"swap-swap", {"SWAP", "SWAP"}, dropSwaps},
+    {"convert-before-push", {"PUSHI|PUSHF|PUSHG|PUSHL", "SWAP", "ITOF", "SWAP"}, convertBeforePush},
+    {"fold-integers", {"PUSHI", "PUSHI", "ADD|SUB|MUL"}, foldIntegers},
+    {"negate-real", {"PUSHF", "PUSHF", "FMUL"}, negateReal},
+    {"double-negation", {"PUSHI", "MUL", "PUSHI", "MUL"}, dropDoubleNegation},
+    {"subtract-negation", {"PUSHI|PUSHF", "MUL|FMUL", "ADD|SUB|FADD|FSUB"}, subtractNegation},
+    {"merge-offsets", {"PUSHI", "ADD|SUB", "PUSHI", "ADD|SUB"}, mergeOffsets},
+    {"identity", {"PUSHI", "ADD|SUB|MUL"}, dropIdentity},
+    {"constant-check", {"PUSHI", "CHECK"}, dropConstantCheck},
+    {"constant-load", {"PUSHI", "LOADN"}, loadOffset},
+    {"constant-store", {"PUSHI", "SWAP", "STOREN"}, storeOffset},
+    {"jump-to-next", {"JUMP", ":"}, dropJumpToNext},
+};
+
+// Tells whether a line matches one element of a pattern
+static bool matches(const char *spec, const VMInstr &in)
+{
+    if (in.kind == VMInstr::LABEL)
+        return spec[0] == ':' && spec[1] == '\0';
+    for (const char *start = spec;;)
+    {
+        const char *bar = start;
+        while (*bar && *bar != '|')
+            bar++;
+        if (in.op.size() == (size_t)(bar - start) && in.op.compare(0, in.op.size(), start, bar - start) == 0)
+            return true;
+        if (!*bar)
+            return false;
+        start = bar + 1;
+    }
+}
+
+// Bit r is set if rule r can start at an instruction with this opcode
+static uint32_t rulesStartingWith(const string &op)
+{
+    static const unordered_map<string, uint32_t> index = []() {
+        unordered_map<string, uint32_t> firsts;
+        for (size_t r = 0; r < RULES.size(); r++)
+        {
+            string alternatives = RULES[r].pattern[0];
+            for (size_t start = 0, bar; start <= alternatives.size(); start = bar + 1)
+            {
+                bar = alternatives.find('|', start);
+                if (bar == string::npos)
+                    bar = alternatives.size();
+                firsts[alternatives.substr(start, bar - start)] |= 1u << r;
+            }
+        }
+        return firsts;
+    }();
+    auto found = index.find(op);
+    return found == index.end() ? 0 : found->second;
+}
+
+// Moves a line to the next kept position, unless it is there already
+static void keep(vector<VMInstr> &code, size_t &kept, VMInstr &in)
+{
+    if (&code[kept] != &in)
+        code[kept] = move(in);
+    kept++;
+}
+
+PeepholeOptimizer::PeepholeOptimizer()
+{
+    this->applied.assign(RULES.size(), 0);
+    this->passes = 0;
+}
+
+size_t PeepholeOptimizer::Run(InstructionBuffer &program)
+{
+    size_t total = 0;
+    for (;;)
+    {
+        this->passes++;
+        size_t rewrites = this->pass(program.code);
+        if (rewrites == 0)
+            return total;
+        total += rewrites;
+    }
+}
+
+size_t PeepholeOptimizer::RuleCount()
+{
+    return RULES.size();
+}
+
+const char *PeepholeOptimizer::RuleName(size_t rule)
+{
+    return RULES[rule].name;
+}
+
+size_t PeepholeOptimizer::pass(vector<VMInstr> &code)
+{
+    // The program is compacted in place: a rewrite never produces more lines
+    // than it matched, so the lines kept (written below `kept`) never
+    // overtake the ones still to be read (from `i` on).
+    Window window;
+    vector<VMInstr> replacement;
+    size_t rewrites = 0;
+    size_t kept = 0;
+    size_t i = 0;
+    while (i < code.size())
+    {
+        bool rewritten = false;
+        // most instructions start no rule
+        uint32_t candidates = code[i].kind == VMInstr::OP ? rulesStartingWith(code[i].op) : 0;
+        for (size_t r = 0; candidates >> r && !rewritten; r++)
+        {
+            if (!(candidates >> r & 1))
+                continue;
+            const PeepholeRule &rule = RULES[r];
+            window.clear();
+            size_t j = i;
+            while (j < code.size() && window.size() < rule.pattern.size())
+            {
+                if (code[j].kind == VMInstr::TEXT)
+                {
+                    j++;
+                    continue;
+                }
+                if (!matches(rule.pattern[window.size()], code[j]))
+                    break;
+                window.push_back(&code[j]);
+                // nothing may jump into the middle of a window
+                if (code[j++].kind == VMInstr::LABEL)
+                    break;
+            }
+            replacement.clear();
+            if (window.size() != rule.pattern.size() || !rule.rewrite(window, replacement) ||
+                replacement.size() > window.size())
+                continue;
+            // the comments inside the window stay, in front of the replacement
+            for (size_t k = i; k < j; k++)
+                if (code[k].kind == VMInstr::TEXT)
+                    keep(code, kept, code[k]);
+            for (VMInstr &in : replacement)
+                keep(code, kept, in);
+            this->applied[r]++;
+            rewrites++;
+            rewritten = true;
+            i = j;
+        }
+        if (!rewritten)
+            keep(code, kept, code[i++]);
+    }
+    code.resize(kept);
+    return rewrites;
+}
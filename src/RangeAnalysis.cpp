@@ -0,0 +1,432 @@
+#include "RangeAnalysis.h"
+#include "SymbolTable.h"
+#include <algorithm>
+
+using namespace std;
+
+// Rounds a loop is analyzed with exact joins before moving bounds are widened
+static const int WIDEN_AFTER = 2;
+
+// Counts the array accesses of a body and the ones flagged IN_BOUNDS
+class AccessCounter : public StaticVisitor<AccessCounter>
+{
+public:
+    using StaticVisitor<AccessCounter>::Visit;
+    const Annotations *annotations;
+    size_t accesses = 0;
+    size_t inBounds = 0;
+
+    AccessCounter(const Annotations *annotations) : annotations(annotations) {}
+
+    void Enter(Node *n)
+    {
+        if (isa<ArrayExp>(n) || isa<ArrayElement>(n))
+        {
+            this->accesses++;
+            if (this->annotations->FlagsOf(n) & IN_BOUNDS)
+                this->inBounds++;
+        }
+    }
+};
+
+// A range computed in 64 bits, or unknown if the VM may have wrapped it around
+static ValueRange checked(int64_t lo, int64_t hi)
+{
+    if (lo < INT32_MIN || hi > INT32_MAX)
+        return ValueRange::All();
+    return ValueRange{lo, hi};
+}
+
+// The comparison that holds when `op` does not (a < b fails: a >= b)
+static OpType negated(OpType op)
+{
+    switch (op)
+    {
+    case OP_GT: return OP_LE;
+    case OP_GE: return OP_LT;
+    case OP_LT: return OP_GE;
+    case OP_LE: return OP_GT;
+    case OP_ET: return OP_NE;
+    default: return OP_ET;
+    }
+}
+
+// The comparison with its operands swapped (a < b: b > a)
+static OpType mirrored(OpType op)
+{
+    switch (op)
+    {
+    case OP_GT: return OP_LT;
+    case OP_GE: return OP_LE;
+    case OP_LT: return OP_GT;
+    case OP_LE: return OP_GE;
+    default: return op;
+    }
+}
+
+RangeAnalysis::RangeAnalysis(Annotations *annotations)
+{
+    this->annotations = annotations;
+    this->accesses = 0;
+    this->inBounds = 0;
+    this->globals = NULL;
+    this->globalSlots = 0;
+    this->state.reachable = true;
+}
+
+void RangeAnalysis::addSlots(IdentList *ids, int &next)
+{
+    for (Ident *id : *(ids->identLst))
+    {
+        Symbol *sym = this->annotations->SymbolOf(id);
+        if (sym && sym->DataType == INTTYPE && this->slots.Insert(sym, next))
+            next++;
+    }
+}
+
+void RangeAnalysis::beginBody(SubDec *sub)
+{
+    this->slots = FlatHashMap<Symbol *, int>();
+    int next = 0;
+    if (this->globals)
+        for (ParDec *pd : *(this->globals->decs))
+            this->addSlots(pd->identList, next);
+    this->globalSlots = next;
+    if (sub)
+    {
+        Func *func = dyn_cast<Func>(sub->subHead);
+        Args *args = func ? func->args : cast<Proc>(sub->subHead)->args;
+        if (args && args->parList)
+            for (ParDec *pd : *(args->parList->parList))
+                this->addSlots(pd->identList, next);
+        if (sub->localDecs)
+            for (LocalDec *ld : *(sub->localDecs->localDecs))
+                this->addSlots(ld->identlist, next);
+    }
+    // nothing is known where a body starts
+    this->state.ranges.assign(next, ValueRange::All());
+    this->state.reachable = true;
+}
+
+void RangeAnalysis::endBody(Node *body)
+{
+    AccessCounter counter(this->annotations);
+    counter.Dispatch(body);
+    this->accesses += counter.accesses;
+    this->inBounds += counter.inBounds;
+}
+
+int RangeAnalysis::slotOf(Ident *id)
+{
+    Symbol *sym = this->annotations->SymbolOf(id);
+    int *slot = sym ? this->slots.Find(sym) : NULL;
+    return slot ? *slot : -1;
+}
+
+void RangeAnalysis::forgetGlobals()
+{
+    fill(this->state.ranges.begin(), this->state.ranges.begin() + this->globalSlots, ValueRange::All());
+}
+
+void RangeAnalysis::forgetGlobalsIfCalls(Exp *e)
+{
+    if (callsFunction(e))
+        this->forgetGlobals();
+}
+
+ValueRange RangeAnalysis::rangeOf(const RangeState &s, Exp *e)
+{
+    if (this->annotations->TypeOf(e) != INTTYPE)
+        return ValueRange::All();
+    switch (e->kind)
+    {
+    case NK_INTEGER:
+        return ValueRange::Of(cast<Integer>(e)->val);
+    case NK_IDEXP:
+    {
+        int slot = this->slotOf(cast<IdExp>(e)->id);
+        return slot >= 0 ? s.ranges[slot] : ValueRange::All();
+    }
+    case NK_UNARYMINUS:
+    {
+        ValueRange v = this->rangeOf(s, cast<UnaryMinus>(e)->exp);
+        return checked(-v.hi, -v.lo);
+    }
+    case NK_ADD:
+    case NK_SUB:
+    case NK_MULT:
+    case NK_INTDIV:
+    {
+        BinOp *b = cast<BinOp>(e);
+        ValueRange l = this->rangeOf(s, b->leftExp);
+        ValueRange r = this->rangeOf(s, b->rightExp);
+        if (e->kind == NK_ADD)
+            return checked(l.lo + r.lo, l.hi + r.hi);
+        if (e->kind == NK_SUB)
+            return checked(l.lo - r.hi, l.hi - r.lo);
+        if (e->kind == NK_INTDIV && r.lo <= 0 && r.hi >= 0)
+            return ValueRange::All();
+        // products and quotients are extreme at the corners (division by a range without 0)
+        int64_t corners[4];
+        if (e->kind == NK_MULT)
+        {
+            corners[0] = l.lo * r.lo, corners[1] = l.lo * r.hi;
+            corners[2] = l.hi * r.lo, corners[3] = l.hi * r.hi;
+        }
+        else
+        {
+            corners[0] = l.lo / r.lo, corners[1] = l.lo / r.hi;
+            corners[2] = l.hi / r.lo, corners[3] = l.hi / r.hi;
+        }
+        int64_t lo = *min_element(corners, corners + 4), hi = *max_element(corners, corners + 4);
+        // a VM rounding negative quotients down may give one less than truncation
+        if (e->kind == NK_INTDIV && (l.lo < 0 || r.lo < 0))
+            lo--;
+        return checked(lo, hi);
+    }
+    default:
+        return ValueRange::All();
+    }
+}
+
+void RangeAnalysis::narrow(RangeState &s, Exp *e, OpType op, ValueRange bound, bool keepGlobals)
+{
+    IdExp *var = dyn_cast<IdExp>(e);
+    int slot = var ? this->slotOf(var->id) : -1;
+    if (slot < 0 || (keepGlobals && slot < this->globalSlots))
+        return;
+    ValueRange &v = s.ranges[slot];
+    switch (op)
+    {
+    case OP_GT:
+        v.lo = max(v.lo, bound.lo + 1);
+        break;
+    case OP_GE:
+        v.lo = max(v.lo, bound.lo);
+        break;
+    case OP_LT:
+        v.hi = min(v.hi, bound.hi - 1);
+        break;
+    case OP_LE:
+        v.hi = min(v.hi, bound.hi);
+        break;
+    case OP_ET:
+        v.lo = max(v.lo, bound.lo);
+        v.hi = min(v.hi, bound.hi);
+        break;
+    default: // OP_NE only excludes a constant at either end of the range
+        if (bound.lo == bound.hi && v.lo == bound.lo)
+            v.lo++;
+        else if (bound.lo == bound.hi && v.hi == bound.lo)
+            v.hi--;
+        break;
+    }
+    if (v.lo > v.hi)
+        s.reachable = false;
+}
+
+void RangeAnalysis::assume(RangeState &s, Exp *cond, bool truth, bool callsAfter)
+{
+    switch (cond->kind)
+    {
+    case NK_NOT:
+        this->assume(s, cast<Not>(cond)->exp, !truth, callsAfter);
+        return;
+    case NK_AND:
+    case NK_OR:
+    {
+        BinOp *b = cast<BinOp>(cond);
+        // a call in the right operand may assign the globals the left one tested
+        bool leftCallsAfter = callsAfter || callsFunction(b->rightExp);
+        if ((cond->kind == NK_AND) == truth)
+        { // both operands hold: true and true, or false or false
+            this->assume(s, b->leftExp, truth, leftCallsAfter);
+            this->assume(s, b->rightExp, truth, callsAfter);
+            return;
+        }
+        // the left operand decides, or it does not and the right one does
+        RangeState decided = s;
+        this->assume(decided, b->leftExp, truth, leftCallsAfter);
+        this->assume(s, b->leftExp, !truth, leftCallsAfter);
+        this->assume(s, b->rightExp, truth, callsAfter);
+        this->join(s, decided);
+        return;
+    }
+    case NK_GT:
+    case NK_GE:
+    case NK_LT:
+    case NK_LE:
+    case NK_ET:
+    case NK_NE:
+    {
+        BinOp *b = cast<BinOp>(cond);
+        if (this->annotations->TypeOf(b->leftExp) != INTTYPE || this->annotations->TypeOf(b->rightExp) != INTTYPE)
+            return;
+        static const OpType ops[] = {OP_GT, OP_LT, OP_GE, OP_LE, OP_ET, OP_NE}; // in NodeKind order
+        OpType op = ops[cond->kind - NK_GT];
+        if (!truth)
+            op = negated(op);
+        ValueRange l = this->rangeOf(s, b->leftExp);
+        ValueRange r = this->rangeOf(s, b->rightExp);
+        // a global read before a call in the comparison itself may be stale too
+        bool keepGlobals = callsAfter || callsFunction(b);
+        this->narrow(s, b->leftExp, op, r, keepGlobals);
+        this->narrow(s, b->rightExp, mirrored(op), l, keepGlobals);
+        return;
+    }
+    default:
+        return;
+    }
+}
+
+bool RangeAnalysis::join(RangeState &s, const RangeState &other)
+{
+    if (!other.reachable)
+        return false;
+    if (!s.reachable)
+    {
+        s = other;
+        return true;
+    }
+    bool grew = false;
+    for (size_t i = 0; i < s.ranges.size(); i++)
+    {
+        if (other.ranges[i].lo < s.ranges[i].lo)
+            s.ranges[i].lo = other.ranges[i].lo, grew = true;
+        if (other.ranges[i].hi > s.ranges[i].hi)
+            s.ranges[i].hi = other.ranges[i].hi, grew = true;
+    }
+    return grew;
+}
+
+void RangeAnalysis::decide(Node *access, Ident *array, Exp *index)
+{
+    unsigned flags = this->annotations->FlagsOf(access) & ~IN_BOUNDS;
+    Symbol *sym = this->annotations->SymbolOf(array);
+    if (sym && this->state.reachable)
+    {
+        ValueRange r = this->rangeOf(this->state, index);
+        if (r.lo >= sym->beginIndex && r.hi <= sym->endIndex)
+            flags |= IN_BOUNDS;
+    }
+    this->annotations->SetFlags(access, flags);
+}
+
+void RangeAnalysis::Visit(Prog *n)
+{
+    this->globals = n->declarations;
+    if (n->subDeclarations)
+        this->Dispatch(n->subDeclarations);
+    this->beginBody(NULL);
+    this->Dispatch(n->compoundStatment);
+    this->endBody(n->compoundStatment);
+}
+
+void RangeAnalysis::Visit(SubDec *n)
+{
+    // the code of a cached subprogram is not generated again
+    if (this->annotations->FlagsOf(n) & CACHED)
+        return;
+    this->beginBody(n);
+    this->Dispatch(n->compStmt);
+    this->endBody(n->compStmt);
+}
+
+void RangeAnalysis::Visit(Assign *n)
+{
+    ArrayElement *element = dyn_cast<ArrayElement>(n->var);
+    this->forgetGlobalsIfCalls(n->exp);
+    if (element)
+        this->forgetGlobalsIfCalls(element->index);
+
+    // the value is computed before the element's index
+    this->Dispatch(n->exp);
+    if (element)
+    {
+        this->Dispatch(element->index);
+        this->decide(element, element->id, element->index);
+        return;
+    }
+    int slot = this->slotOf(n->var->id);
+    if (slot >= 0)
+        this->state.ranges[slot] = this->rangeOf(this->state, n->exp);
+}
+
+void RangeAnalysis::Visit(ProcStmt *n)
+{
+    if (n->expls)
+    {
+        for (Exp *arg : *(n->expls->expList))
+            this->forgetGlobalsIfCalls(arg);
+        this->Dispatch(n->expls);
+    }
+    // the built-in write assigns nothing; a user procedure may share its name
+    Symbol *sym = this->annotations->SymbolOf(n->id);
+    if (!sym || !sym->funcSig || !sym->funcSig->builtIn)
+        this->forgetGlobals();
+}
+
+void RangeAnalysis::Visit(IfThen *n)
+{
+    this->forgetGlobalsIfCalls(n->expr);
+    this->Dispatch(n->expr);
+    RangeState skipped = this->state;
+    this->assume(skipped, n->expr, false);
+    this->assume(this->state, n->expr, true);
+    this->Dispatch(n->stmt);
+    this->join(this->state, skipped);
+}
+
+void RangeAnalysis::Visit(IfThenElse *n)
+{
+    this->forgetGlobalsIfCalls(n->expr);
+    this->Dispatch(n->expr);
+    RangeState otherwise = this->state;
+    this->assume(otherwise, n->expr, false);
+    this->assume(this->state, n->expr, true);
+    this->Dispatch(n->trueStmt);
+    swap(this->state, otherwise);
+    this->Dispatch(n->falseStmt);
+    this->join(this->state, otherwise);
+}
+
+void RangeAnalysis::Visit(While *n)
+{
+    RangeState head = this->state;
+    for (int round = 0;; round++)
+    {
+        this->state = head;
+        this->forgetGlobalsIfCalls(n->expr);
+        this->Dispatch(n->expr);
+        RangeState exit = this->state;
+        this->assume(exit, n->expr, false);
+        this->assume(this->state, n->expr, true);
+        this->Dispatch(n->stmt);
+
+        RangeState next = head;
+        if (!this->join(next, this->state))
+        {
+            // stable: the last analysis of the body was made with every state it can start in
+            this->state = exit;
+            return;
+        }
+        if (round >= WIDEN_AFTER && head.reachable)
+        {
+            // bounds still moving go to the limits, so the loop converges
+            for (size_t i = 0; i < next.ranges.size(); i++)
+            {
+                if (next.ranges[i].lo < head.ranges[i].lo)
+                    next.ranges[i].lo = INT32_MIN;
+                if (next.ranges[i].hi > head.ranges[i].hi)
+                    next.ranges[i].hi = INT32_MAX;
+            }
+        }
+        head = next;
+    }
+}
+
+void RangeAnalysis::Visit(ArrayExp *n)
+{
+    this->Dispatch(n->index);
+    this->decide(n, n->id, n->index);
+}
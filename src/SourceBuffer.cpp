@@ -0,0 +1,117 @@
+#include "SourceBuffer.h"
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+SourceBuffer::SourceBuffer()
+{
+    this->data = NULL;
+    this->size = 0;
+    this->mappedSize = 0;
+}
+
+SourceBuffer::~SourceBuffer()
+{
+    this->Close();
+}
+
+#ifndef _WIN32
+
+bool SourceBuffer::Open(const string &path)
+{
+    this->Close();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    size_t fileSize = st.st_size;
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t total = ((fileSize + 2 + page - 1) / page) * page;
+
+    // Reserve a zero-filled region big enough for the file plus the two
+    // end-of-buffer bytes, then map the file over its beginning. Bytes past
+    // the end of the file are zero whether they fall in the last file page
+    // or in the extra anonymous page.
+    void *region = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+    void *file = mmap(region, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED)
+    {
+        munmap(region, total);
+        return false;
+    }
+    madvise(region, fileSize, MADV_SEQUENTIAL);
+
+    this->data = (char *)region;
+    this->size = fileSize;
+    this->mappedSize = total;
+    return true;
+}
+
+void SourceBuffer::Close()
+{
+    if (this->data && this->mappedSize)
+        munmap(this->data, this->mappedSize);
+    this->loaded.clear();
+    this->data = NULL;
+    this->size = 0;
+    this->mappedSize = 0;
+}
+
+#else
+
+bool SourceBuffer::Open(const string &path)
+{
+    // No mmap support, callers fall back to stdio input
+    return false;
+}
+
+void SourceBuffer::Close()
+{
+    this->loaded.clear();
+    this->data = NULL;
+    this->size = 0;
+}
+
+#endif
+
+void SourceBuffer::Load(const string &text)
+{
+    this->Close();
+    this->loaded.reserve(text.size() + 2);
+    this->loaded.assign(text);
+    this->loaded.append(2, '\0');
+    this->data = &this->loaded[0];
+    this->size = text.size();
+}
+
+bool readFile(const string &path, string &contents)
+{
+    ifstream in(path, ios::binary | ios::ate);
+    if (!in)
+        return false;
+    contents.resize((size_t)in.tellg());
+    in.seekg(0);
+    in.read(&contents[0], contents.size());
+    return (bool)in;
+}
@@ -5,17 +5,40 @@
 
 using namespace std;
 
-
-Errors *errorStack = new Errors();
-
-
-
+PackedSignature packSignature(const vector<TypeEnum> &types)
+{
+    PackedSignature packed = 1;
+    for (size_t i = 0; i < types.size(); i++)
+    {
+        if (i == MAX_PACKED_PARAMS)
+            return packed | PACKED_SIGNATURE_TRUNCATED;
+        packed = (packed << 3) | (PackedSignature)types[i];
+    }
+    return packed;
+}
 
 FunctionSignature::FunctionSignature(string n, vector<Type*>* params, TypeEnum ret)
 {
     this->name = n;
+    this->nameId = Interner::Global().Intern(n);
     this->returnType = ret;
     this->paramTypes = params;
+    this->builtIn = false;
+    if (params != NULL)
+        for (auto *t : *params)
+        {
+            if (isa<StdType>(t))
+                this->paramTypeEnums.push_back(cast<StdType>(t)->type);
+            else
+                this->paramTypeEnums.push_back(cast<Array>(t)->stdType->type);
+        }
+    this->packed = packSignature(this->paramTypeEnums);
+    this->label = (ret == VOID ? 'p' : 'f') + this->getSignatureString();
+}
+
+FunctionSignature::~FunctionSignature()
+{
+    delete this->paramTypes;
 }
 
 string FunctionSignature::getSignatureString()
@@ -28,12 +51,12 @@ string FunctionSignature::getSignatureString()
         if (i > 0)
             res += 'D';
             TypeEnum x;
-            if(dynamic_cast<StdType*>(this->paramTypes->at(i))){
-                StdType* s = dynamic_cast<StdType*>(this->paramTypes->at(i));
+            if(isa<StdType>(this->paramTypes->at(i))){
+                StdType* s = cast<StdType>(this->paramTypes->at(i));
                 x = s->type;
             }
             else{
-                Array* s = dynamic_cast<Array*>(this->paramTypes->at(i));
+                Array* s = cast<Array>(this->paramTypes->at(i));
                 x = s->stdType->type;
 
             }
@@ -42,6 +65,23 @@ string FunctionSignature::getSignatureString()
     return res;
 }
 
+Symbol *OverloadSet::Find(PackedSignature packed, const vector<TypeEnum> &types)
+{
+    for (auto &member : this->members)
+        if (member.first == packed &&
+            (!(packed & PACKED_SIGNATURE_TRUNCATED) || member.second->funcSig->paramTypeEnums == types))
+            return member.second;
+    return NULL;
+}
+
+bool OverloadSet::Add(Symbol *sym)
+{
+    if (this->Find(sym->funcSig->packed, sym->funcSig->paramTypeEnums))
+        return false;
+    this->members.push_back(make_pair(sym->funcSig->packed, sym));
+    return true;
+}
+
 Symbol::Symbol(string name, SymbolKind kind, TypeEnum type)
 {
     this->Name = name;
@@ -49,6 +89,7 @@ Symbol::Symbol(string name, SymbolKind kind, TypeEnum type)
     this->DataType = type;
     this->funcSig = NULL;
     this->Offset = 0; 
+    this->Depth = 0;
 }
 
 Symbol::Symbol(string name, SymbolKind kind, FunctionSignature *sig)
@@ -58,6 +99,7 @@ Symbol::Symbol(string name, SymbolKind kind, FunctionSignature *sig)
     this->DataType = sig->returnType;
     this->funcSig = sig;
     this->Offset = 0; 
+    this->Depth = 0;
     this->beginIndex = 0;
 }
 
@@ -70,60 +112,82 @@ Scope::Scope()
     this->param_offset = -1;
     // Locals are at positive offsets from FP.
     this->local_offset = 0;
+    this->depth = 0;
+}
+
+Scope::~Scope()
+{
+    delete this->hashTab;
+    delete this->Children;
 }
 
 void Scope::AddChildScope(Scope *s)
 {
     this->Children->push_back(s);
     s->Parent = this;
+    s->depth = this->depth + 1;
 }
 
-SymbolTable::SymbolTable()
+SymbolTable::SymbolTable(Errors *errs)
 {
+    this->errors = errs;
+    this->symbolCount = 0;
+    this->lookupCount = 0;
+    this->probeCount = 0;
     this->Scopes = new vector<Scope *>();
     this->Scopes->push_back(new Scope());
     this->currentScope = this->Scopes->at(0);
     this->rootScope = this->currentScope;
 }
 
-bool SymbolTable::AddSymbol(Ident *ident, SymbolKind kind, Type* type)
+SymbolTable::~SymbolTable()
+{
+    for (Scope *s : *(this->Scopes))
+        delete s;
+    delete this->Scopes;
+    for (Symbol *sym : this->symbols)
+        delete sym;
+    this->overloads.ForEach([](const SymbolKey &, OverloadSet *set) { delete set; });
+    for (FunctionSignature *sig : this->signatures)
+        delete sig;
+}
+
+Symbol *SymbolTable::AddSymbol(Ident *ident, SymbolKind kind, Type* type)
 {
 
-    string key;
     int offset = 0;
     switch (kind)
     {
     case PARAM_VAR:
-        key = "par" + ident->name; // parameter var for function or procedure
-        offset = this->currentScope->param_offset--;
+        offset = this->currentScope->param_offset--; // parameter var for function or procedure
         break;
     case GLOBAL_VAR:
-        key = 'g' + ident->name; // global variables
-        offset = this->rootScope->local_offset++;
+        offset = this->rootScope->local_offset++; // global variables
         break;
     case LOCAL_VAR:
-        key = 'l' + ident->name; // local variable
-        offset = this->currentScope->local_offset++;
+        offset = this->currentScope->local_offset++; // local variable
         break;
     default:
         cout << "Error in symbol table, invalid kind for a variable \n";
-        return false;
+        return NULL;
         break;
     }
-    Symbol *temp = this->currentScope->hashTab->GetMember(key);
-    if (temp)
+    SymbolKey key(ident->nameId, NS_VAR);
+    Symbol **existing = this->currentScope->hashTab->Find(key);
+    // a local may shadow a parameter of the same name, anything else is a redefinition
+    if (existing && !(kind == LOCAL_VAR && (*existing)->Kind == PARAM_VAR))
     {
-        errorStack->AddError( "Redifintion Of Variable: " + ident->name, ident->line+1, ident->column);
-        return false;
+        this->errors->AddError( "Redifintion Of Variable: " + ident->name, ident->line+1, ident->column);
+        return NULL;
     }
     TypeEnum typ;
     int beg_indx = 0, end_indx;
-    if(dynamic_cast<StdType*>(type)){
-        StdType* x = dynamic_cast<StdType*>(type);
+    if(isa<StdType>(type)){
+        StdType* x = cast<StdType>(type);
         typ = x->type;
     }
     else{
-        Array* x = dynamic_cast<Array*>(type);
+        Array* x = cast<Array>(type);
         beg_indx = x->beginIndex;
         end_indx = x->endIndex;
         switch (x->stdType->type)
@@ -144,118 +208,82 @@ bool SymbolTable::AddSymbol(Ident *ident, SymbolKind kind, Type* type)
         }
     }
     Symbol *newSymbol = new Symbol(ident->name, kind, typ);
+    this->symbols.push_back(newSymbol);
     newSymbol->Offset = offset;
+    newSymbol->Depth = kind == GLOBAL_VAR ? 0 : this->currentScope->depth;
     newSymbol->beginIndex = beg_indx;
     newSymbol->endIndex = end_indx;
-    this->currentScope->hashTab->AddKey(key, newSymbol);
-    ident->symbol = newSymbol;
-    return true;
+    if (existing)
+        *existing = newSymbol;
+    else
+        this->currentScope->hashTab->Insert(key, newSymbol);
+    this->symbolCount++;
+    return newSymbol;
 }
 
-bool SymbolTable::AddSymbol(Ident *ident, SymbolKind kind, FunctionSignature *sig)
+Symbol *SymbolTable::AddSymbol(Ident *ident, SymbolKind kind, FunctionSignature *sig)
 {
-    string key;
+    if (!sig->builtIn)
+        this->signatures.push_back(sig);
+    SymbolNamespace ns;
     switch (kind)
     {
     case FUNC:
-        key = "f";
+        ns = NS_FUNC;
         break;
     case PROC:
-        key = "p";
+        ns = NS_PROC;
         break;
     default:
         cout << "Error in symbol table, invalid kind for a function/procedure \n";
-        return false;
+        return NULL;
         break;
     }
 
-    key = key + sig->getSignatureString();
-    Symbol *temp = this->rootScope->hashTab->GetMember(key);
+    SymbolKey key(ident->nameId, ns);
+    OverloadSet **set = this->overloads.Find(key);
+    if (!set)
+    {
+        this->overloads.Insert(key, new OverloadSet());
+        set = this->overloads.Find(key);
+    }
 
-    if (temp)
+    if ((*set)->Find(sig->packed, sig->paramTypeEnums))
     {
         if (kind == PROC)
-            errorStack->AddError("Redifinition of Procedure: " + ident->name, ident->line+1, ident->column);
+            this->errors->AddError("Redifinition of Procedure: " + ident->name, ident->line+1, ident->column);
         else
-            errorStack->AddError("Redifinition of Function: " + ident->name, ident->line+1, ident->column);
-        return false;
+            this->errors->AddError("Redifinition of Function: " + ident->name, ident->line+1, ident->column);
+        return NULL;
     }
     Symbol *newSymbol = new Symbol(ident->name, kind, sig);
-    this->rootScope->hashTab->AddKey(key, newSymbol);
-    ident->symbol = newSymbol;
-    return true;
+    this->symbols.push_back(newSymbol);
+    (*set)->Add(newSymbol);
+    this->symbolCount++;
+    return newSymbol;
 }
 
 Symbol *SymbolTable::LookUpSymbol(Ident *ident)
 {
-    string key;
-    Symbol *sym;
-    
-    Scope *scope_to_check = this->currentScope;
-    while (scope_to_check != NULL)
+    this->lookupCount++;
+    SymbolKey key(ident->nameId, NS_VAR);
+
+    // locals and parameters of the enclosing scopes, then the globals of the root scope
+    for (Scope *scope_to_check = this->currentScope; scope_to_check != NULL; scope_to_check = scope_to_check->Parent)
     {
-        key = "l" + ident->name;
-        sym = scope_to_check->hashTab->GetMember(key);
+        this->probeCount++;
+        Symbol *sym = scope_to_check->hashTab->Get(key);
         if (sym)
-        {
-            ident->symbol = sym;
             return sym;
-        }
-        // now look if there exist a parameter variable with that name in the currrent scope (function/procedure)
-        key = "par" + ident->name;
-        sym = scope_to_check->hashTab->GetMember(key);
-        if (sym)
-        {
-            ident->symbol = sym;
-            return sym;
-        }
-        scope_to_check = scope_to_check->Parent;
-    }
-    // if there  were  no local variables or parameters
-    key = 'g' + ident->name;
-    sym = this->rootScope->hashTab->GetMember(key);
-    if (sym != NULL)
-    {
-        ident->symbol = sym;
-        return sym;
     }
-    errorStack->AddError("Undeclared Variable: " + ident->name, ident->line+1, ident->column);
+    this->errors->AddError("Undeclared Variable: " + ident->name, ident->line+1, ident->column);
     return NULL;
 }
 
-Symbol *SymbolTable::LookUpSymbol(Ident *ident, SymbolKind kind, vector<TypeEnum>* paramTypes)
+Symbol *SymbolTable::FindOverload(NameId nameId, SymbolKind kind, const vector<TypeEnum> &argTypes)
 {
-    string key;
-    Symbol *sym;
-    switch (kind)
-    {
-    case FUNC:
-        key = 'f';
-        break;
-    case PROC:
-        key = 'p';
-        break;
-    default:
-        cout << "Error in lookup function/procedure, invalid kind\n";
-        break;
-    }
-    key += ident->name + 'D';
-    if(paramTypes != NULL)
-        for(int i = 0; i <  paramTypes->size(); i++){
-            if(i > 0) key +='D';
-            key += TypeEnumToString(paramTypes->at(i));
-        }
-    sym = this->rootScope->hashTab->GetMember(key);
-    if(sym != NULL){
-        ident->symbol = sym;
-        return sym;
-    }
-
-    if (kind == FUNC)
-        errorStack->AddError("Undeclared Function: " + key, ident->line+1, ident->column);
-    else
-        errorStack->AddError("Undeclared Procedure: " + key, ident->line+1, ident->column);
-    return NULL;
+    OverloadSet *set = this->overloads.Get(SymbolKey(nameId, kind == FUNC ? NS_FUNC : NS_PROC));
+    return set ? set->Find(packSignature(argTypes), argTypes) : NULL;
 }
 
 void SymbolTable::NewScope()
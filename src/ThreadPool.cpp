@@ -0,0 +1,147 @@
+#include "ThreadPool.h"
+
+using namespace std;
+
+// The pool and queue index of the worker running on this thread, if any
+static thread_local ThreadPool *currentPool = NULL;
+static thread_local unsigned currentWorker = 0;
+
+ThreadPool::ThreadPool(unsigned numThreads)
+{
+    if (numThreads == 0)
+        numThreads = 1;
+    this->queued = 0;
+    this->nextQueue = 0;
+    this->stopping = false;
+    for (unsigned i = 0; i < numThreads; i++)
+        this->queues.push_back(new WorkQueue());
+    for (unsigned i = 0; i < numThreads; i++)
+        this->workers.push_back(thread(&ThreadPool::WorkerLoop, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> g(this->stateLock);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    for (auto &worker : this->workers)
+        worker.join();
+    for (auto *q : this->queues)
+        delete q;
+}
+
+unsigned ThreadPool::Size() const
+{
+    return this->workers.size();
+}
+
+bool ThreadPool::TryPop(unsigned self, function<void()> &task)
+{
+    unsigned n = this->queues.size();
+    for (unsigned i = 0; i < n; i++)
+    {
+        WorkQueue *q = this->queues[(self + i) % n];
+        {
+            lock_guard<mutex> g(q->lock);
+            if (q->tasks.empty())
+                continue;
+            if (i == 0)
+            { // own queue: newest first, keeps nested work cache-warm
+                task = move(q->tasks.back());
+                q->tasks.pop_back();
+            }
+            else
+            { // steal the oldest task of another worker
+                task = move(q->tasks.front());
+                q->tasks.pop_front();
+            }
+        }
+        lock_guard<mutex> g(this->stateLock);
+        this->queued--;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::WorkerLoop(unsigned self)
+{
+    currentPool = this;
+    currentWorker = self;
+    for (;;)
+    {
+        function<void()> task;
+        if (this->TryPop(self, task))
+        {
+            task();
+            continue;
+        }
+        unique_lock<mutex> g(this->stateLock);
+        if (this->stopping && this->queued == 0)
+            return;
+        if (this->queued == 0)
+            this->wake.wait(g);
+        else
+        { // a task is counted but still being pushed, try again shortly
+            g.unlock();
+            this_thread::yield();
+        }
+    }
+}
+
+void ThreadPool::Run(vector<function<void()>> &tasks)
+{
+    if (tasks.empty())
+        return;
+
+    bool onWorker = (currentPool == this);
+    size_t remaining = tasks.size(); // guarded by stateLock
+
+    for (auto &task : tasks)
+    {
+        function<void()> wrapped = [this, &task, &remaining]()
+        {
+            task();
+            lock_guard<mutex> g(this->stateLock);
+            remaining--;
+            this->finished.notify_all();
+        };
+
+        // Nested batches stay on the submitting worker's queue (others can
+        // still steal them); outside batches are spread round-robin.
+        unsigned target;
+        {
+            lock_guard<mutex> g(this->stateLock);
+            target = onWorker ? currentWorker : this->nextQueue++ % this->queues.size();
+            this->queued++;
+        }
+        {
+            lock_guard<mutex> g(this->queues[target]->lock);
+            this->queues[target]->tasks.push_back(move(wrapped));
+        }
+    }
+    this->wake.notify_all();
+
+    unique_lock<mutex> g(this->stateLock);
+    if (!onWorker)
+    {
+        this->finished.wait(g, [&remaining]()
+                            { return remaining == 0; });
+        return;
+    }
+
+    // A worker waiting on its own batch keeps executing queued tasks so
+    // nested batches cannot starve the pool.
+    while (remaining > 0)
+    {
+        g.unlock();
+        function<void()> task;
+        bool found = this->TryPop(currentWorker, task);
+        if (found)
+            task();
+        g.lock();
+        if (!found && remaining > 0 && this->queued == 0)
+            this->finished.wait(g);
+    }
+}
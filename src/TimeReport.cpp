@@ -0,0 +1,118 @@
+#include "TimeReport.h"
+#include <iomanip>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+// Allocations are counted per thread so that the jobs of a parallel batch
+// each see only their own allocations.
+thread_local size_t TimeReport::threadAllocations = 0;
+bool TimeReport::countAllocations = false;
+
+TimeReport::TimeReport()
+{
+    this->astNodes = 0;
+    this->symbols = 0;
+    this->scopes = 0;
+    this->lookups = 0;
+    this->probes = 0;
+    this->instructions = 0;
+    this->arenaBytes = 0;
+    this->subprograms = 0;
+    this->cachedSubprograms = 0;
+    this->constantsFolded = 0;
+    this->constantUses = 0;
+    this->arrayAccesses = 0;
+    this->checksRemoved = 0;
+    this->unoptimizedInstructions = 0;
+    this->startAllocations = 0;
+}
+
+size_t TimeReport::AllocationCount()
+{
+    return TimeReport::threadAllocations;
+}
+
+long TimeReport::PeakRssKb()
+{
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        return usage.ru_maxrss; // KiB on Linux
+#endif
+    return 0;
+}
+
+void TimeReport::Begin(const string &phase)
+{
+    this->current = phase;
+    this->startAllocations = AllocationCount();
+    this->start = chrono::steady_clock::now();
+}
+
+void TimeReport::End()
+{
+    PhaseStats stats;
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - this->start).count();
+    stats.name = this->current;
+    stats.allocations = AllocationCount() - this->startAllocations;
+    stats.peakRssKb = PeakRssKb();
+    this->phases.push_back(stats);
+}
+
+void TimeReport::Print(ostream &out, const string &title) const
+{
+    double totalSeconds = 0;
+    size_t totalAllocations = 0;
+    for (auto &p : this->phases)
+    {
+        totalSeconds += p.seconds;
+        totalAllocations += p.allocations;
+    }
+
+    out << "=== Time report: " << title << " ===" << endl;
+    out << left << setw(20) << "phase" << right << setw(12) << "wall (ms)" << setw(8) << "%"
+        << setw(14) << "allocations" << setw(16) << "peak RSS (KiB)" << endl;
+    out << fixed;
+    // without the counter (see AllocationCounter.cpp) the column stays empty
+    auto allocations = [](size_t n) { return TimeReport::countAllocations ? to_string(n) : string("-"); };
+    for (auto &p : this->phases)
+    {
+        out << left << setw(20) << p.name << right
+            << setw(12) << setprecision(3) << p.seconds * 1000
+            << setw(8) << setprecision(1) << (totalSeconds > 0 ? 100 * p.seconds / totalSeconds : 0)
+            << setw(14) << allocations(p.allocations) << setw(16) << p.peakRssKb << endl;
+    }
+    out << left << setw(20) << "total" << right
+        << setw(12) << setprecision(3) << totalSeconds * 1000
+        << setw(8) << setprecision(1) << 100.0
+        << setw(14) << allocations(totalAllocations) << setw(16) << PeakRssKb() << endl;
+    out << "AST nodes: " << this->astNodes << ", symbols: " << this->symbols
+        << ", scopes: " << this->scopes << ", lookups: " << this->lookups
+        << " (" << this->probes << " probes), VM instructions: " << this->instructions
+        << ", AST arena: " << (this->arenaBytes + 1023) / 1024 << " KiB" << endl;
+    if (this->subprograms)
+        out << "Compilation cache: " << this->cachedSubprograms << " of " << this->subprograms
+            << " subprograms reused" << endl;
+    if (this->constantsFolded || this->constantUses)
+        out << "Constants: " << this->constantsFolded << " operators folded, " << this->constantUses
+            << " uses of constant locals replaced" << endl;
+    if (this->arrayAccesses)
+        out << "Bounds checks: " << this->checksRemoved << " of " << this->arrayAccesses
+            << " array accesses proven in range" << endl;
+    if (this->unoptimizedInstructions)
+    {
+        size_t total = 0;
+        for (auto &r : this->rewrites)
+            total += r.second;
+        out << "Peephole: " << total << " rewrites, " << this->unoptimizedInstructions << " -> "
+            << this->instructions << " VM instructions";
+        for (size_t i = 0; i < this->rewrites.size(); i++)
+            out << (i ? ", " : " (") << this->rewrites[i].first << " " << this->rewrites[i].second;
+        out << (this->rewrites.empty() ? "" : ")") << endl;
+    }
+    out.unsetf(ios::floatfield);
+    out << setprecision(6);
+}
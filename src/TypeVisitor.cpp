@@ -1,16 +1,160 @@
 #include "CommonTypes.h"
 #include "ast.h"
 #include "Error.h"
+#include "CompilationContext.h"
+#include "ThreadPool.h"
+#include "CompileCache.h"
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <sstream>
 
 using namespace std;
 
-extern SymbolTable *symbolTable;
-extern Errors *errorStack;
+// Programs with fewer subprograms are checked serially, the thread hand-off would cost more than it saves
+static const size_t PARALLEL_CHECK_MIN_SUBPROGRAMS = 64;
 
-TypeVisitor::TypeVisitor()
+TypeEnum TypeVisitor::typeOf(const Node *n) const
+{
+    return this->annotations->TypeOf(n);
+}
+
+void TypeVisitor::setType(const Node *n, TypeEnum t)
+{
+    this->annotations->SetType(n, t);
+}
+
+void TypeVisitor::markConversions(BinOp *b)
+{
+    if (typeOf(b) != REALTYPE)
+        return;
+    unsigned flags = 0;
+    if (typeOf(b->leftExp) == INTTYPE)
+        flags |= ITOF_LEFT;
+    if (typeOf(b->rightExp) == INTTYPE)
+        flags |= ITOF_RIGHT;
+    this->annotations->SetFlags(b, flags);
+}
+
+void TypeVisitor::markComparison(BinOp *b)
+{
+    TypeEnum lType = typeOf(b->leftExp);
+    TypeEnum rType = typeOf(b->rightExp);
+    unsigned flags = 0;
+    if (rType == INTTYPE && lType == REALTYPE)
+        flags |= ITOF_RIGHT;
+    else if (rType == REALTYPE && lType == INTTYPE)
+        flags |= ITOF_LEFT;
+    if (lType == REALTYPE || rType == REALTYPE)
+        flags |= REAL_OPERANDS;
+    this->annotations->SetFlags(b, flags);
+}
+
+TypeVisitor::TypeVisitor(CompilationContext *ctx)
 {
     this->currentFunction = nullptr;
+    this->symbolTable = ctx->symbolTable;
+    this->annotations = &ctx->annotations;
+    this->errorStack = ctx->errors;
+    this->log = ctx->log;
+    this->pool = NULL;
+    this->jobs = 1;
+    this->callLookups = 0;
+    this->cache = NULL;
+}
+
+void TypeVisitor::logWarning(const string &message, int line, int column)
+{
+    *this->log << "Warning:" << line << ":" << column << " " << message << endl;
+    if (this->cache)
+        this->logWarnings.push_back(Diagnostic{message, line, column});
+}
+
+Symbol *TypeVisitor::lookUpCall(Ident *ident, SymbolKind kind, const vector<TypeEnum> &argTypes)
+{
+    this->callLookups++;
+    Symbol *sym = this->symbolTable->FindOverload(ident->nameId, kind, argTypes);
+    if (sym)
+    {
+        this->annotations->SetSymbol(ident, sym);
+        return sym;
+    }
+
+    // spell the signature out for the error message
+    string key(1, kind == FUNC ? 'f' : 'p');
+    key += ident->name + 'D';
+    for (size_t i = 0; i < argTypes.size(); i++)
+    {
+        if (i > 0)
+            key += 'D';
+        key += TypeEnumToString(argTypes[i]);
+    }
+    this->errorStack->AddError((kind == FUNC ? "Undeclared Function: " : "Undeclared Procedure: ") + key,
+                               ident->line + 1, ident->column);
+    return NULL;
+}
+
+void TypeVisitor::checkInParallel(SubDecs *n)
+{
+    NodeList<SubDec *> &subdecs = *n->subdecs;
+    unique_ptr<ThreadPool> ownPool;
+    ThreadPool *workers = this->pool;
+    if (!workers)
+    {
+        ownPool.reset(new ThreadPool(this->jobs));
+        workers = ownPool.get();
+    }
+
+    // a few chunks per worker balance uneven bodies without a task per subprogram
+    size_t chunkSize = max((size_t)8, subdecs.size() / (workers->Size() * 4));
+    size_t numChunks = (subdecs.size() + chunkSize - 1) / chunkSize;
+    vector<Errors> chunkErrors(numChunks);
+    // a chunk stops once it alone would fill what is left of the error limit
+    if (this->errorStack->maxErrors)
+        for (Errors &e : chunkErrors)
+            e.maxErrors = this->errorStack->maxErrors - this->errorStack->errorStack.size();
+    vector<ostringstream> chunkLogs(numChunks);
+    vector<long> chunkLookups(numChunks, 0);
+
+    vector<function<void()>> tasks;
+    for (size_t c = 0; c < numChunks; c++)
+    {
+        tasks.push_back([this, &subdecs, &chunkErrors, &chunkLogs, &chunkLookups, c, chunkSize]() {
+            // diagnostics go to the heap: the compilation's arena is not
+            // thread-safe, and a worker may have another file's arena current
+            ArenaScope noArena(NULL);
+            TypeVisitor checker(*this);
+            checker.errorStack = &chunkErrors[c];
+            checker.log = &chunkLogs[c];
+            checker.pool = NULL;
+            checker.jobs = 1;
+            checker.callLookups = 0;
+            size_t end = min(subdecs.size(), (c + 1) * chunkSize);
+            for (size_t i = c * chunkSize; i < end; i++)
+                subdecs[i]->accept(&checker);
+            chunkLookups[c] = checker.callLookups;
+        });
+    }
+    workers->Run(tasks);
+
+    // chunks hold consecutive subprograms, so appending them in order keeps the serial order
+    for (size_t c = 0; c < numChunks && !this->errorStack->LimitReached(); c++)
+    {
+        Errors *errors = this->errorStack;
+        if (errors->maxErrors && chunkErrors[c].errorStack.size() >= errors->maxErrors - errors->errorStack.size())
+        {
+            // the error limit is reached in this chunk; where a serial check
+            // stops depends on the errors before it, so check it again here
+            size_t end = min(subdecs.size(), (c + 1) * chunkSize);
+            for (size_t i = c * chunkSize; i < end && !errors->LimitReached(); i++)
+                subdecs[i]->accept(this);
+            break;
+        }
+        this->errorStack->Append(chunkErrors[c]);
+        *this->log << chunkLogs[c].str();
+        this->callLookups += chunkLookups[c];
+    }
 }
 
 bool TypeVisitor::checkReturn(Stmt *statement)
@@ -20,14 +164,14 @@ bool TypeVisitor::checkReturn(Stmt *statement)
         return false;
     }
 
-    if (auto *assign = dynamic_cast<Assign *>(statement))
+    if (auto *assign = dyn_cast<Assign>(statement))
     {
-        if (this->currentFunction && assign->var->id->name == this->currentFunction->id->name)
+        if (this->currentFunction && assign->var->id->nameId == this->currentFunction->id->nameId)
         {
             return true;
         }
     }
-    else if (auto *compStmt = dynamic_cast<CompStmt *>(statement))
+    else if (auto *compStmt = dyn_cast<CompStmt>(statement))
     {
         if (compStmt->optitonalStmts && compStmt->optitonalStmts->stmtList)
         {
@@ -37,7 +181,7 @@ bool TypeVisitor::checkReturn(Stmt *statement)
                     return checkReturn(compStmt->optitonalStmts->stmtList->stmts->back());
         }
     }
-    else if (auto *ifThenElse = dynamic_cast<IfThenElse *>(statement))
+    else if (auto *ifThenElse = dyn_cast<IfThenElse>(statement))
     {
         // An if-then-else returns if BOTH branches return.
         return checkReturn(ifThenElse->trueStmt) && checkReturn(ifThenElse->falseStmt);
@@ -61,110 +205,50 @@ void TypeVisitor::Visit(Prog *n)
 
     if (n->compoundStatment) // program body
         n->compoundStatment->accept(this);
-}
 
-void TypeVisitor::Visit(Decs *n)
-{
-    for (ParDec *pd : *(n->decs))
-    {
-        for (Ident *id : *(pd->identList->identLst))
-        {
-            symbolTable->AddSymbol(id, GLOBAL_VAR, pd->tp);
-        }
-    }
+    // every overload lookup is a single probe
+    this->symbolTable->lookupCount += this->callLookups;
+    this->symbolTable->probeCount += this->callLookups;
+    this->callLookups = 0;
 }
 
+void TypeVisitor::Visit(Decs *n) { /* Declared by NameResolver */ }
+
 void TypeVisitor::Visit(SubDecs *n)
 {
+    // Every subprogram is declared by now, so the bodies only read shared state
+    if ((this->pool || this->jobs > 1) && n->subdecs->size() >= PARALLEL_CHECK_MIN_SUBPROGRAMS)
+    {
+        this->checkInParallel(n);
+        return;
+    }
     for (SubDec *sd : *(n->subdecs))
     {
+        if (errorStack->LimitReached())
+            return;
         sd->accept(this);
     }
 }
 
 void TypeVisitor::Visit(SubDec *n)
 {
-    Func *funcNode = dynamic_cast<Func *>(n->subHead);
-    Proc *procNode = dynamic_cast<Proc *>(n->subHead);
-    Ident *subId = nullptr;
-    FunctionSignature *sig = nullptr;
-    SymbolKind kind;
-    vector<Type *> *astParamTypes = new vector<Type *>();
-    if (funcNode)
-    {
-        subId = funcNode->id;
-        kind = FUNC;
-        if (funcNode->args && funcNode->args->parList)
-        {
-            for (ParDec *pd : *(funcNode->args->parList->parList))
-            {
-                for (size_t i = 0; i < pd->identList->identLst->size(); ++i)
-                {
-                    astParamTypes->push_back(pd->tp);
-                }
-            }
-        }
-        // funcNode->typ is StdType*, its ->type is the TypeEnum return type
-        sig = new FunctionSignature(subId->name, astParamTypes, funcNode->typ->type);
-    }
-    else if (procNode)
-    {
-        subId = procNode->id;
-        kind = PROC;
-
-        if (procNode->args)
-        {
-            if (procNode->args->parList && procNode->args->parList->parList)
-            {
-                for (ParDec *pd : *(procNode->args->parList->parList))
-                {
-                    for (size_t i = 0; i < pd->identList->identLst->size(); ++i)
-                    {
-                        astParamTypes->push_back(pd->tp);
-                    }
-                }
-            }
-        }
-        sig = new FunctionSignature(subId->name, astParamTypes, VOID); // Procedures return VOID
-    }
-    else
-    {
-        // Should not happen
-        delete astParamTypes;
+    if (this->annotations->FlagsOf(n) & CACHED)
+    {
+        // checked by an earlier compilation: report what it reported
+        CachedSubprogram *entry = this->cache->Find(n);
+        for (const Diagnostic &d : entry->logWarnings)
+            logWarning(d.Message, entry->firstLine + d.line, d.column);
+        for (const Diagnostic &d : entry->warnings)
+            errorStack->AddWarning(d.Message, entry->firstLine + d.line, d.column);
         return;
     }
+    size_t firstWarning = errorStack->warningsStack.size();
+    this->logWarnings.clear();
 
-    symbolTable->AddSymbol(subId, kind, sig);
-
-    // New Scope for local variables and function/pocedure body
-    symbolTable->NewScope();
-
+    // The subprogram, its parameters and locals were declared by NameResolver
+    Func *funcNode = dyn_cast<Func>(n->subHead);
     Func *previousFunctionContext = this->currentFunction;
-
-    if (funcNode)
-    {
-        this->currentFunction = funcNode;
-    }
-    else
-    {
-        this->currentFunction = nullptr;
-    }
-
-    // Add parameters to the new (current) scope
-    if (funcNode && funcNode->args && funcNode->args->parList)
-    {
-        funcNode->args->parList->accept(this);
-    }
-    else if (procNode && procNode->args && procNode->args->parList)
-    {
-        procNode->args->parList->accept(this);
-    }
-
-    // Add local variables to the new (current) scope
-    if (n->localDecs)
-    {
-        n->localDecs->accept(this);
-    }
+    this->currentFunction = funcNode;
 
     // Visit the body
     if (n->compStmt)
@@ -181,40 +265,17 @@ void TypeVisitor::Visit(SubDec *n)
                              funcNode->id->line + 1, funcNode->id->column);
     }
 
-    symbolTable->CloseScope();
-
     this->currentFunction = previousFunctionContext;
+    if (this->cache)
+        this->cache->RecordWarnings(n, errorStack->warningsStack, firstWarning, this->logWarnings);
 }
 
-void TypeVisitor::Visit(ParList *n)
-{
-    for (ParDec *pd : *(n->parList))
-    {
-        for (Ident *id : *(pd->identList->identLst))
-        {
-            symbolTable->AddSymbol(id, PARAM_VAR, pd->tp);
-        }
-    }
-}
+void TypeVisitor::Visit(ParList *n) { /* Declared by NameResolver */ }
+
+void TypeVisitor::Visit(LocalDecs *n) { /* Declared by NameResolver */ }
+
+void TypeVisitor::Visit(LocalDec *n) { /* Declared by NameResolver */ }
 
-void TypeVisitor::Visit(LocalDecs *n)
-{
-    if (!n || !n->localDecs)
-        return;
-    for (LocalDec *ld : *(n->localDecs))
-    {
-        ld->accept(this);
-    }
-}
-void TypeVisitor::Visit(LocalDec *n)
-{
-    if (!n || !n->identlist || !n->tp)
-        return;
-    for (Ident *id : *(n->identlist->identLst))
-    {
-        symbolTable->AddSymbol(id, LOCAL_VAR, n->tp);
-    }
-}
 void TypeVisitor::Visit(ParDec *n) {}
 
 void TypeVisitor::Visit(Stmt *s)
@@ -248,7 +309,7 @@ void TypeVisitor::Visit(OptionalStmts *n)
 
 void TypeVisitor::Visit(StmtList *n)
 {
-    for (int i = 0; i < n->stmts->size(); i++)
+    for (int i = 0; i < n->stmts->size() && !errorStack->LimitReached(); i++)
     {
         n->stmts->at(i)->accept(this);
     }
@@ -257,27 +318,22 @@ void TypeVisitor::Visit(StmtList *n)
 void TypeVisitor::Visit(Var *n)
 {
 
-    if (this->currentFunction && n->id->name == this->currentFunction->id->name)
+    if (this->currentFunction && n->id->nameId == this->currentFunction->id->nameId)
     {
         // Function Return
-        n->type = this->currentFunction->typ->type;
-
-        if (!n->id->symbol)
-        {
-            n->id->symbol = this->currentFunction->id->symbol;
-        }
+        setType(n, this->currentFunction->typ->type);
     }
     else
     {
-        // Regular variable
-        Symbol *sym = symbolTable->LookUpSymbol(n->id);
+        // Regular variable, bound by NameResolver (NULL if undeclared)
+        Symbol *sym = this->annotations->SymbolOf(n->id);
         if (sym)
         {
-            n->type = sym->DataType;
+            setType(n, sym->DataType);
         }
         else
         {
-            n->type = VOID; // Mark as VOID type if undeclared.
+            setType(n, VOID); // Mark as VOID type if undeclared.
         }
     }
 }
@@ -293,29 +349,29 @@ void TypeVisitor::Visit(Assign *n)
     n->var->accept(this);
     n->exp->accept(this);
 
-    if (n->var->type == VOID || n->exp->type == VOID)
+    if (typeOf(n->var) == VOID || typeOf(n->exp) == VOID)
     {
         return;
     }
 
-    if (this->currentFunction != nullptr && n->var->id->name == this->currentFunction->id->name)
+    if (this->currentFunction != nullptr && n->var->id->nameId == this->currentFunction->id->nameId)
     {
         // This is a return statement
         TypeEnum expectedReturnType = this->currentFunction->typ->type;
 
-        if (n->exp->type != expectedReturnType)
+        if (typeOf(n->exp) != expectedReturnType)
         {
 
-            if (expectedReturnType == REALTYPE && n->exp->type == INTTYPE)
+            if (expectedReturnType == REALTYPE && typeOf(n->exp) == INTTYPE)
             {
                 errorStack->AddWarning("Implicitly casting integer expression to real for return value of function '" + this->currentFunction->id->name + "'.", n->line + 1, n->column);
-                cout << "Warning:" << n->line + 1 << ":" << n->column << " Implicitly casting integer expression to real for return value of function '" << this->currentFunction->id->name << "'." << endl;
+                logWarning("Implicitly casting integer expression to real for return value of function '" + this->currentFunction->id->name + "'.", n->line + 1, n->column);
             }
             else
             {
                 errorStack->AddError("Type mismatch in return assignment for function '" + this->currentFunction->id->name +
                                          "'. Expected " + TypeEnumToString(expectedReturnType) +
-                                         " but got " + TypeEnumToString(n->exp->type) + ".",
+                                         " but got " + TypeEnumToString(typeOf(n->exp)) + ".",
                                      n->line + 1, n->column);
             }
         }
@@ -323,18 +379,18 @@ void TypeVisitor::Visit(Assign *n)
     else
     {
 
-        if (n->var->type != n->exp->type)
+        if (typeOf(n->var) != typeOf(n->exp))
         {
 
-            if (n->var->type == REALTYPE && n->exp->type == INTTYPE)
+            if (typeOf(n->var) == REALTYPE && typeOf(n->exp) == INTTYPE)
             {
                 errorStack->AddWarning("Implicitly casting integer to real in assignment to '" + n->var->id->name + "'.", n->line + 1, n->column);
-                cout << "Warning:" << n->line + 1 << ":" << n->column << " Implicitly casting integer to real in assignment to '" << n->var->id->name << "'." << endl;
+                logWarning("Implicitly casting integer to real in assignment to '" + n->var->id->name + "'.", n->line + 1, n->column);
             }
             else
             {
-                errorStack->AddError("Cannot assign expression of type " + TypeEnumToString(n->exp->type) +
-                                         " to variable '" + n->var->id->name + "' of type " + TypeEnumToString(n->var->type) + ".",
+                errorStack->AddError("Cannot assign expression of type " + TypeEnumToString(typeOf(n->exp)) +
+                                         " to variable '" + n->var->id->name + "' of type " + TypeEnumToString(typeOf(n->var)) + ".",
                                      n->line + 1, n->column);
             }
         }
@@ -344,48 +400,43 @@ void TypeVisitor::Visit(Assign *n)
 void TypeVisitor::Visit(FuncCall *a)
 {
 
-    vector<TypeEnum> *argTypes = new vector<TypeEnum>();
+    vector<TypeEnum> argTypes;
     if (a->exps)
     {
         a->exps->accept(this);
         for (Exp *argExp : *(a->exps->expList))
         {
-            argTypes->push_back(argExp->type);
+            argTypes.push_back(typeOf(argExp));
         }
     }
 
-    Symbol *funcSym = symbolTable->LookUpSymbol(a->id, FUNC, argTypes);
-
-    delete argTypes;
+    Symbol *funcSym = lookUpCall(a->id, FUNC, argTypes);
 
     if (funcSym)
     {
-        a->type = funcSym->DataType; // DataType of FUNC symbol is its return type
-        if (a->id->symbol == nullptr)
-            a->id->symbol = funcSym;
+        setType(a, funcSym->DataType); // DataType of FUNC symbol is its return type
     }
     else
     {
         // todo: Suggest Similar Functions
 
-        a->type = VOID;
+        setType(a, VOID);
     }
 }
 
 void TypeVisitor::Visit(ProcStmt *n)
 {
-    vector<TypeEnum> *argTypes = new vector<TypeEnum>();
+    vector<TypeEnum> argTypes;
     if (n->expls)
     {
         n->expls->accept(this);
         for (Exp *argExp : *(n->expls->expList))
         {
-            argTypes->push_back(argExp->type);
+            argTypes.push_back(typeOf(argExp));
         }
     }
 
-    Symbol *procSym = symbolTable->LookUpSymbol(n->id, PROC, argTypes);
-    delete argTypes;
+    lookUpCall(n->id, PROC, argTypes);
 }
 
 void TypeVisitor::Visit(ExpList *n)
@@ -399,10 +450,10 @@ void TypeVisitor::Visit(ExpList *n)
 void TypeVisitor::Visit(IfThen *n)
 {
     n->expr->accept(this);
-    if (n->expr->type != BOOLTYPE && n->expr->type != VOID)
+    if (typeOf(n->expr) != BOOLTYPE && typeOf(n->expr) != VOID)
     {
         errorStack->AddError("IF condition must be a boolean expression, but got " +
-                                 TypeEnumToString(n->expr->type) + ".",
+                                 TypeEnumToString(typeOf(n->expr)) + ".",
                              n->expr->line + 1, n->expr->column);
     }
     n->stmt->accept(this);
@@ -411,10 +462,10 @@ void TypeVisitor::Visit(IfThen *n)
 void TypeVisitor::Visit(IfThenElse *n)
 {
     n->expr->accept(this);
-    if (n->expr->type != BOOLTYPE && n->expr->type != VOID)
+    if (typeOf(n->expr) != BOOLTYPE && typeOf(n->expr) != VOID)
     {
         errorStack->AddError("IF-ELSE condition must be a boolean expression, but got " +
-                                 TypeEnumToString(n->expr->type) + ".",
+                                 TypeEnumToString(typeOf(n->expr)) + ".",
                              n->expr->line + 1, n->expr->column);
     }
     n->trueStmt->accept(this);
@@ -424,10 +475,10 @@ void TypeVisitor::Visit(IfThenElse *n)
 void TypeVisitor::Visit(While *n)
 {
     n->expr->accept(this);
-    if (n->expr->type != BOOLTYPE && n->expr->type != VOID)
+    if (typeOf(n->expr) != BOOLTYPE && typeOf(n->expr) != VOID)
     {
         errorStack->AddError("WHILE condition must be a boolean expression, but got " +
-                                 TypeEnumToString(n->expr->type) + ".",
+                                 TypeEnumToString(typeOf(n->expr)) + ".",
                              n->expr->line + 1, n->expr->column);
     }
     n->stmt->accept(this);
@@ -439,17 +490,15 @@ void TypeVisitor::Visit(StdType *t) {}
 
 void TypeVisitor::Visit(IdExp *e)
 {
-    Symbol *sym = symbolTable->LookUpSymbol(e->id);
+    Symbol *sym = this->annotations->SymbolOf(e->id);
     if (sym)
     {
 
-        e->type = sym->DataType;
-        if (e->id->symbol == nullptr)
-            e->id->symbol = sym;
+        setType(e, sym->DataType);
     }
     else
     {
-        e->type = VOID;
+        setType(e, VOID);
     }
 }
 void TypeVisitor::Visit(ArrayExp *e)
@@ -461,52 +510,50 @@ void TypeVisitor::Visit(ArrayExp *e)
     else
     {
         e->index->accept(this);
-        if (e->index->type != INTTYPE)
-            errorStack->AddError("Index of Array '" + e->id->name + "' must be integr by got " + TypeEnumToString(e->index->type), e->index->line, e->index->column);
+        if (typeOf(e->index) != INTTYPE)
+            errorStack->AddError("Index of Array '" + e->id->name + "' must be integr by got " + TypeEnumToString(typeOf(e->index)), e->index->line, e->index->column);
     }
-    Symbol *sym = symbolTable->LookUpSymbol(e->id);
+    Symbol *sym = this->annotations->SymbolOf(e->id);
     if (sym)
     {
 
-        e->type = sym->DataType;
+        setType(e, sym->DataType);
         switch (sym->DataType)
         {
         case INT_ARRAY:
-            e->type = INTTYPE;
+            setType(e, INTTYPE);
             break;
         case REAL_ARRAY:
-            e->type = REALTYPE;
+            setType(e, REALTYPE);
             break;
         case BOOL_ARRAY:
-            e->type = BOOLTYPE;
+            setType(e, BOOLTYPE);
             break;
 
         default:
             //! should nott happen
             break;
         }
-        if (e->id->symbol == nullptr)
-            e->id->symbol = sym;
     }
     else
     {
-        e->type = VOID;
+        setType(e, VOID);
     }
 }
 
 void TypeVisitor::Visit(Integer *n)
 {
-    n->type = INTTYPE;
+    setType(n, INTTYPE);
 }
 
 void TypeVisitor::Visit(Real *n)
 {
-    n->type = REALTYPE;
+    setType(n, REALTYPE);
 }
 
 void TypeVisitor::Visit(Bool *n)
 {
-    n->type = BOOLTYPE;
+    setType(n, BOOLTYPE);
 }
 
 void TypeVisitor::Visit(Array *a)
@@ -516,34 +563,32 @@ void TypeVisitor::Visit(Array *a)
 
 void TypeVisitor::Visit(ArrayElement *a)
 {
-    Symbol *arraySym = symbolTable->LookUpSymbol(a->id);
+    Symbol *arraySym = this->annotations->SymbolOf(a->id);
 
     if (!arraySym)
     {
-        a->type = VOID;
+        setType(a, VOID);
         // Visit index to catch potential errors there too, though main issue is undeclared array
         if (a->index)
             a->index->accept(this);
         return;
     }
-    if (a->id->symbol == nullptr)
-        a->id->symbol = arraySym;
 
     switch (arraySym->DataType)
     {
     case INT_ARRAY:
-        a->type = INTTYPE;
+        setType(a, INTTYPE);
         break;
     case REAL_ARRAY:
-        a->type = REALTYPE;
+        setType(a, REALTYPE);
         break;
     case BOOL_ARRAY:
-        a->type = BOOLTYPE;
+        setType(a, BOOLTYPE);
         break;
 
     default:
         errorStack->AddError("Identifier '" + a->id->name + "' is not an array.", a->line + 1, a->column);
-        a->type = VOID;
+        setType(a, VOID);
 
         // Still visit the index to find errors there if any
         if (a->index)
@@ -553,9 +598,9 @@ void TypeVisitor::Visit(ArrayElement *a)
     if (a->index)
     {
         a->index->accept(this);
-        if (a->index->type != INTTYPE)
+        if (typeOf(a->index) != INTTYPE)
         {
-            errorStack->AddError("Array index for '" + a->id->name + "' must be an integer expression, but got " + TypeEnumToString(a->index->type) + ".",
+            errorStack->AddError("Array index for '" + a->id->name + "' must be an integer expression, but got " + TypeEnumToString(typeOf(a->index)) + ".",
                                  a->index->line + 1, a->index->column);
         }
     }
@@ -569,24 +614,24 @@ void TypeVisitor::Visit(UnaryMinus *n)
 {
     n->exp->accept(this);
 
-    if (n->exp->type == INTTYPE)
+    if (typeOf(n->exp) == INTTYPE)
     {
-        n->type = INTTYPE;
+        setType(n, INTTYPE);
     }
-    else if (n->exp->type == REALTYPE)
+    else if (typeOf(n->exp) == REALTYPE)
     {
-        n->type = REALTYPE;
+        setType(n, REALTYPE);
     }
-    else if (n->exp->type != VOID)
+    else if (typeOf(n->exp) != VOID)
     {
         errorStack->AddError("Unary minus operator requires an integer or real expression, but got " +
-                                 TypeEnumToString(n->exp->type) + ".",
+                                 TypeEnumToString(typeOf(n->exp)) + ".",
                              n->line + 1, n->column);
-        n->type = VOID;
+        setType(n, VOID);
     }
     else
     {
-        n->type = VOID;
+        setType(n, VOID);
     }
 }
 void TypeVisitor::Visit(BinOp *b)
@@ -600,24 +645,24 @@ void TypeVisitor::Visit(Add *b)
     b->leftExp->accept(this);
     b->rightExp->accept(this);
 
-    TypeEnum lType = b->leftExp->type;
-    TypeEnum rType = b->rightExp->type;
+    TypeEnum lType = typeOf(b->leftExp);
+    TypeEnum rType = typeOf(b->rightExp);
 
     if (lType == VOID || rType == VOID)
     { // Error in operands already reported
-        b->type = VOID;
+        setType(b, VOID);
         return;
     }
 
     if (lType == INTTYPE && rType == INTTYPE)
     {
-        b->type = INTTYPE;
+        setType(b, INTTYPE);
     }
     else if ((lType == REALTYPE && rType == REALTYPE) ||
              (lType == REALTYPE && rType == INTTYPE) ||
              (lType == INTTYPE && rType == REALTYPE))
     {
-        b->type = REALTYPE;
+        setType(b, REALTYPE);
         if (lType == INTTYPE || rType == INTTYPE)
         { // Only one is int
             errorStack->AddWarning("Implicitly casting integer to real in addition", b->line + 1, b->column);
@@ -628,8 +673,9 @@ void TypeVisitor::Visit(Add *b)
         errorStack->AddError("Type mismatch in addition: Cannot add " + TypeEnumToString(lType) +
                                  " and " + TypeEnumToString(rType) + ".",
                              b->line + 1, b->column);
-        b->type = VOID;
+        setType(b, VOID);
     }
+    markConversions(b);
 }
 
 void TypeVisitor::Visit(Sub *b)
@@ -637,24 +683,24 @@ void TypeVisitor::Visit(Sub *b)
     b->leftExp->accept(this);
     b->rightExp->accept(this);
 
-    TypeEnum lType = b->leftExp->type;
-    TypeEnum rType = b->rightExp->type;
+    TypeEnum lType = typeOf(b->leftExp);
+    TypeEnum rType = typeOf(b->rightExp);
 
     if (lType == VOID || rType == VOID)
     { // Error in operands already reported
-        b->type = VOID;
+        setType(b, VOID);
         return;
     }
 
     if (lType == INTTYPE && rType == INTTYPE)
     {
-        b->type = INTTYPE;
+        setType(b, INTTYPE);
     }
     else if ((lType == REALTYPE && rType == REALTYPE) ||
              (lType == REALTYPE && rType == INTTYPE) ||
              (lType == INTTYPE && rType == REALTYPE))
     {
-        b->type = REALTYPE;
+        setType(b, REALTYPE);
         if (lType == INTTYPE || rType == INTTYPE)
         { // Only one is int
             errorStack->AddWarning("Implicitly casting integer to real in subtraction", b->line + 1, b->column);
@@ -665,8 +711,9 @@ void TypeVisitor::Visit(Sub *b)
         errorStack->AddError("Type mismatch in addition: Cannot subtact " + TypeEnumToString(rType) +
                                  " from " + TypeEnumToString(lType) + ".",
                              b->line + 1, b->column);
-        b->type = VOID;
+        setType(b, VOID);
     }
+    markConversions(b);
 }
 
 void TypeVisitor::Visit(Mult *b)
@@ -674,24 +721,24 @@ void TypeVisitor::Visit(Mult *b)
     b->leftExp->accept(this);
     b->rightExp->accept(this);
 
-    TypeEnum lType = b->leftExp->type;
-    TypeEnum rType = b->rightExp->type;
+    TypeEnum lType = typeOf(b->leftExp);
+    TypeEnum rType = typeOf(b->rightExp);
 
     if (lType == VOID || rType == VOID)
     { // Error in operands already reported
-        b->type = VOID;
+        setType(b, VOID);
         return;
     }
 
     if (lType == INTTYPE && rType == INTTYPE)
     {
-        b->type = INTTYPE;
+        setType(b, INTTYPE);
     }
     else if ((lType == REALTYPE && rType == REALTYPE) ||
              (lType == REALTYPE && rType == INTTYPE) ||
              (lType == INTTYPE && rType == REALTYPE))
     {
-        b->type = REALTYPE;
+        setType(b, REALTYPE);
         if (lType == INTTYPE || rType == INTTYPE)
         { // Only one is int
             errorStack->AddWarning("Implicitly casting integer to real in multiplication", b->line + 1, b->column);
@@ -702,8 +749,9 @@ void TypeVisitor::Visit(Mult *b)
         errorStack->AddError("Type mismatch in addition: Cannot multiply " + TypeEnumToString(lType) +
                                  " and " + TypeEnumToString(rType) + ".",
                              b->line + 1, b->column);
-        b->type = VOID;
+        setType(b, VOID);
     }
+    markConversions(b);
 }
 
 void TypeVisitor::Visit(Divide *b)
@@ -711,12 +759,12 @@ void TypeVisitor::Visit(Divide *b)
     b->leftExp->accept(this);
     b->rightExp->accept(this);
 
-    TypeEnum lType = b->leftExp->type;
-    TypeEnum rType = b->rightExp->type;
+    TypeEnum lType = typeOf(b->leftExp);
+    TypeEnum rType = typeOf(b->rightExp);
 
     if (lType == VOID || rType == VOID)
     { // Error in operands already reported
-        b->type = VOID;
+        setType(b, VOID);
         return;
     }
 
@@ -725,7 +773,7 @@ void TypeVisitor::Visit(Divide *b)
         (lType == REALTYPE && rType == INTTYPE) ||
         (lType == INTTYPE && rType == REALTYPE))
     {
-        b->type = REALTYPE;
+        setType(b, REALTYPE);
         if (lType == INTTYPE || rType == INTTYPE)
         { //  one is int
             errorStack->AddWarning("Implicitly casting integer to real in divison", b->line + 1, b->column);
@@ -736,8 +784,9 @@ void TypeVisitor::Visit(Divide *b)
         errorStack->AddError("Type mismatch in addition: Cannot divide " + TypeEnumToString(lType) +
                                  " on " + TypeEnumToString(rType) + ".",
                              b->line + 1, b->column);
-        b->type = VOID;
+        setType(b, VOID);
     }
+    markConversions(b);
 }
 
 void TypeVisitor::Visit(IntDiv *b)
@@ -745,22 +794,22 @@ void TypeVisitor::Visit(IntDiv *b)
     b->leftExp->accept(this);
     b->rightExp->accept(this);
 
-    TypeEnum lType = b->leftExp->type;
-    TypeEnum rType = b->rightExp->type;
+    TypeEnum lType = typeOf(b->leftExp);
+    TypeEnum rType = typeOf(b->rightExp);
 
     if (lType == VOID || rType == VOID)
     { // Error in operands already reported
-        b->type = VOID;
+        setType(b, VOID);
         return;
     }
 
     if (lType == INTTYPE && rType == INTTYPE)
     {
-        b->type = INTTYPE;
+        setType(b, INTTYPE);
     }
     else
     {
-        errorStack->AddError("Can't calculate  Integer Divison for types : " + TypeEnumToString(b->rightExp->type) + " and: " + TypeEnumToString(b->leftExp->type), b->line + 1, b->column);
+        errorStack->AddError("Can't calculate  Integer Divison for types : " + TypeEnumToString(typeOf(b->rightExp)) + " and: " + TypeEnumToString(typeOf(b->leftExp)), b->line + 1, b->column);
         return;
     }
 }
@@ -769,20 +818,21 @@ void TypeVisitor::Visit(GT *b)
 {
     b->leftExp->accept(this);
     b->rightExp->accept(this);
-    b->type = BOOLTYPE;
+    markComparison(b);
+    setType(b, BOOLTYPE);
 
-    if (b->leftExp->type == VOID || b->rightExp->type == VOID)
+    if (typeOf(b->leftExp) == VOID || typeOf(b->rightExp) == VOID)
     {
-        b->type = VOID;
+        setType(b, VOID);
         return;
     }
 
-    bool leftIsNumeric = (b->leftExp->type == INTTYPE || b->leftExp->type == REALTYPE);
-    bool rightIsNumeric = (b->rightExp->type == INTTYPE || b->rightExp->type == REALTYPE);
+    bool leftIsNumeric = (typeOf(b->leftExp) == INTTYPE || typeOf(b->leftExp) == REALTYPE);
+    bool rightIsNumeric = (typeOf(b->rightExp) == INTTYPE || typeOf(b->rightExp) == REALTYPE);
 
     if (leftIsNumeric && rightIsNumeric)
     {
-        if (b->leftExp->type != b->rightExp->type)
+        if (typeOf(b->leftExp) != typeOf(b->rightExp))
         {
             errorStack->AddWarning("Implicitly casting integer to real in comparison.", b->line + 1, b->column);
         }
@@ -790,10 +840,10 @@ void TypeVisitor::Visit(GT *b)
     else
     {
         errorStack->AddError("Incompatible types for '>' operator: Cannot compare " +
-                                 TypeEnumToString(b->leftExp->type) + " and " +
-                                 TypeEnumToString(b->rightExp->type) + ".",
+                                 TypeEnumToString(typeOf(b->leftExp)) + " and " +
+                                 TypeEnumToString(typeOf(b->rightExp)) + ".",
                              b->line + 1, b->column);
-        b->type = VOID;
+        setType(b, VOID);
     }
 }
 
@@ -801,20 +851,21 @@ void TypeVisitor::Visit(LT *b)
 {
     b->leftExp->accept(this);
     b->rightExp->accept(this);
-    b->type = BOOLTYPE;
+    markComparison(b);
+    setType(b, BOOLTYPE);
 
-    if (b->leftExp->type == VOID || b->rightExp->type == VOID)
+    if (typeOf(b->leftExp) == VOID || typeOf(b->rightExp) == VOID)
     {
-        b->type = VOID;
+        setType(b, VOID);
         return;
     }
 
-    bool leftIsNumeric = (b->leftExp->type == INTTYPE || b->leftExp->type == REALTYPE);
-    bool rightIsNumeric = (b->rightExp->type == INTTYPE || b->rightExp->type == REALTYPE);
+    bool leftIsNumeric = (typeOf(b->leftExp) == INTTYPE || typeOf(b->leftExp) == REALTYPE);
+    bool rightIsNumeric = (typeOf(b->rightExp) == INTTYPE || typeOf(b->rightExp) == REALTYPE);
 
     if (leftIsNumeric && rightIsNumeric)
     {
-        if (b->leftExp->type != b->rightExp->type)
+        if (typeOf(b->leftExp) != typeOf(b->rightExp))
         {
             errorStack->AddWarning("Implicitly casting integer to real in comparison.", b->line + 1, b->column);
         }
@@ -822,10 +873,10 @@ void TypeVisitor::Visit(LT *b)
     else
     {
         errorStack->AddError("Incompatible types for '<' operator: Cannot compare " +
-                                 TypeEnumToString(b->leftExp->type) + " and " +
-                                 TypeEnumToString(b->rightExp->type) + ".",
+                                 TypeEnumToString(typeOf(b->leftExp)) + " and " +
+                                 TypeEnumToString(typeOf(b->rightExp)) + ".",
                              b->line + 1, b->column);
-        b->type = VOID;
+        setType(b, VOID);
     }
 }
 
@@ -833,20 +884,21 @@ void TypeVisitor::Visit(GE *b)
 {
     b->leftExp->accept(this);
     b->rightExp->accept(this);
-    b->type = BOOLTYPE;
+    markComparison(b);
+    setType(b, BOOLTYPE);
 
-    if (b->leftExp->type == VOID || b->rightExp->type == VOID)
+    if (typeOf(b->leftExp) == VOID || typeOf(b->rightExp) == VOID)
     {
-        b->type = VOID;
+        setType(b, VOID);
         return;
     }
 
-    bool leftIsNumeric = (b->leftExp->type == INTTYPE || b->leftExp->type == REALTYPE);
-    bool rightIsNumeric = (b->rightExp->type == INTTYPE || b->rightExp->type == REALTYPE);
+    bool leftIsNumeric = (typeOf(b->leftExp) == INTTYPE || typeOf(b->leftExp) == REALTYPE);
+    bool rightIsNumeric = (typeOf(b->rightExp) == INTTYPE || typeOf(b->rightExp) == REALTYPE);
 
     if (leftIsNumeric && rightIsNumeric)
     {
-        if (b->leftExp->type != b->rightExp->type)
+        if (typeOf(b->leftExp) != typeOf(b->rightExp))
         {
             errorStack->AddWarning("Implicitly casting integer to real in comparison.", b->line + 1, b->column);
         }
@@ -854,10 +906,10 @@ void TypeVisitor::Visit(GE *b)
     else
     {
         errorStack->AddError("Incompatible types for '>=' operator: Cannot compare " +
-                                 TypeEnumToString(b->leftExp->type) + " and " +
-                                 TypeEnumToString(b->rightExp->type) + ".",
+                                 TypeEnumToString(typeOf(b->leftExp)) + " and " +
+                                 TypeEnumToString(typeOf(b->rightExp)) + ".",
                              b->line + 1, b->column);
-        b->type = VOID;
+        setType(b, VOID);
     }
 }
 
@@ -865,20 +917,21 @@ void TypeVisitor::Visit(LE *b)
 {
     b->leftExp->accept(this);
     b->rightExp->accept(this);
-    b->type = BOOLTYPE;
+    markComparison(b);
+    setType(b, BOOLTYPE);
 
-    if (b->leftExp->type == VOID || b->rightExp->type == VOID)
+    if (typeOf(b->leftExp) == VOID || typeOf(b->rightExp) == VOID)
     {
-        b->type = VOID;
+        setType(b, VOID);
         return;
     }
 
-    bool leftIsNumeric = (b->leftExp->type == INTTYPE || b->leftExp->type == REALTYPE);
-    bool rightIsNumeric = (b->rightExp->type == INTTYPE || b->rightExp->type == REALTYPE);
+    bool leftIsNumeric = (typeOf(b->leftExp) == INTTYPE || typeOf(b->leftExp) == REALTYPE);
+    bool rightIsNumeric = (typeOf(b->rightExp) == INTTYPE || typeOf(b->rightExp) == REALTYPE);
 
     if (leftIsNumeric && rightIsNumeric)
     {
-        if (b->leftExp->type != b->rightExp->type)
+        if (typeOf(b->leftExp) != typeOf(b->rightExp))
         {
             errorStack->AddWarning("Implicitly casting integer to real in comparison.", b->line + 1, b->column);
         }
@@ -886,10 +939,10 @@ void TypeVisitor::Visit(LE *b)
     else
     {
         errorStack->AddError("Incompatible types for '<=' operator: Cannot compare " +
-                                 TypeEnumToString(b->leftExp->type) + " and " +
-                                 TypeEnumToString(b->rightExp->type) + ".",
+                                 TypeEnumToString(typeOf(b->leftExp)) + " and " +
+                                 TypeEnumToString(typeOf(b->rightExp)) + ".",
                              b->line + 1, b->column);
-        b->type = VOID;
+        setType(b, VOID);
     }
 }
 
@@ -897,17 +950,18 @@ void TypeVisitor::Visit(ET *b)
 {
     b->leftExp->accept(this);
     b->rightExp->accept(this);
+    markComparison(b);
 
-    b->type = BOOLTYPE;
-    if (b->leftExp->type == b->rightExp->type)
+    setType(b, BOOLTYPE);
+    if (typeOf(b->leftExp) == typeOf(b->rightExp))
         return;
-    else if ((b->leftExp->type == REALTYPE && b->rightExp->type == INTTYPE) || (b->rightExp->type == REALTYPE && b->leftExp->type == INTTYPE))
+    else if ((typeOf(b->leftExp) == REALTYPE && typeOf(b->rightExp) == INTTYPE) || (typeOf(b->rightExp) == REALTYPE && typeOf(b->leftExp) == INTTYPE))
     {
         errorStack->AddWarning("Implicitly casting integer to real", b->line, b->column);
     }
     else
     {
-        errorStack->AddError("Can't evaluate '=' operator for expressions of type : " + TypeEnumToString(b->rightExp->type) + " and: " + TypeEnumToString(b->leftExp->type), b->line + 1, b->column);
+        errorStack->AddError("Can't evaluate '=' operator for expressions of type : " + TypeEnumToString(typeOf(b->rightExp)) + " and: " + TypeEnumToString(typeOf(b->leftExp)), b->line + 1, b->column);
         return;
     }
 }
@@ -916,17 +970,18 @@ void TypeVisitor::Visit(NE *b)
 {
     b->leftExp->accept(this);
     b->rightExp->accept(this);
+    markComparison(b);
 
-    b->type = BOOLTYPE;
-    if (b->leftExp->type == b->rightExp->type)
+    setType(b, BOOLTYPE);
+    if (typeOf(b->leftExp) == typeOf(b->rightExp))
         return;
-    else if ((b->leftExp->type == REALTYPE && b->rightExp->type == INTTYPE) || (b->rightExp->type == REALTYPE && b->leftExp->type == INTTYPE))
+    else if ((typeOf(b->leftExp) == REALTYPE && typeOf(b->rightExp) == INTTYPE) || (typeOf(b->rightExp) == REALTYPE && typeOf(b->leftExp) == INTTYPE))
     {
         errorStack->AddWarning("Implicitly casting integer to real", b->line, b->column);
     }
     else
     {
-        errorStack->AddError("Can't evaluate '<>' operator for expressions of type : " + TypeEnumToString(b->rightExp->type) + " and: " + TypeEnumToString(b->leftExp->type), b->line + 1, b->column);
+        errorStack->AddError("Can't evaluate '<>' operator for expressions of type : " + TypeEnumToString(typeOf(b->rightExp)) + " and: " + TypeEnumToString(typeOf(b->leftExp)), b->line + 1, b->column);
         return;
     }
 }
@@ -936,11 +991,11 @@ void TypeVisitor::Visit(And *b)
     b->leftExp->accept(this);
     b->rightExp->accept(this);
 
-    b->type = BOOLTYPE;
+    setType(b, BOOLTYPE);
 
-    if (b->leftExp->type != BOOLTYPE || b->rightExp->type != BOOLTYPE)
+    if (typeOf(b->leftExp) != BOOLTYPE || typeOf(b->rightExp) != BOOLTYPE)
     {
-        errorStack->AddError("Can't evaluate (Logical And) operator for expressions of type : " + TypeEnumToString(b->rightExp->type) + " and: " + TypeEnumToString(b->leftExp->type), b->line + 1, b->column);
+        errorStack->AddError("Can't evaluate (Logical And) operator for expressions of type : " + TypeEnumToString(typeOf(b->rightExp)) + " and: " + TypeEnumToString(typeOf(b->leftExp)), b->line + 1, b->column);
         return;
     }
 }
@@ -950,11 +1005,11 @@ void TypeVisitor::Visit(Or *b)
     b->leftExp->accept(this);
     b->rightExp->accept(this);
 
-    b->type = BOOLTYPE;
+    setType(b, BOOLTYPE);
 
-    if (b->leftExp->type != BOOLTYPE || b->rightExp->type != BOOLTYPE)
+    if (typeOf(b->leftExp) != BOOLTYPE || typeOf(b->rightExp) != BOOLTYPE)
     {
-        errorStack->AddError("Can't evaluate (Logical Or) operator for expressions of type : " + TypeEnumToString(b->rightExp->type) + " and: " + TypeEnumToString(b->leftExp->type), b->line + 1, b->column);
+        errorStack->AddError("Can't evaluate (Logical Or) operator for expressions of type : " + TypeEnumToString(typeOf(b->rightExp)) + " and: " + TypeEnumToString(typeOf(b->leftExp)), b->line + 1, b->column);
         return;
     }
 }
@@ -962,19 +1017,19 @@ void TypeVisitor::Visit(Or *b)
 void TypeVisitor::Visit(Not *n)
 {
     n->exp->accept(this);
-    if (n->exp->type == BOOLTYPE)
+    if (typeOf(n->exp) == BOOLTYPE)
     {
-        n->type = BOOLTYPE;
+        setType(n, BOOLTYPE);
     }
-    else if (n->exp->type != VOID)
+    else if (typeOf(n->exp) != VOID)
     {
         errorStack->AddError("Logical NOT operator requires a boolean expression, but got " +
-                                 TypeEnumToString(n->exp->type) + ".",
+                                 TypeEnumToString(typeOf(n->exp)) + ".",
                              n->line + 1, n->column);
-        n->type = VOID;
+        setType(n, VOID);
     }
     else
     {
-        n->type = VOID;
+        setType(n, VOID);
     }
 }
@@ -1,8 +1,37 @@
 #include "ast.h"
 #include <iostream>
 
+// Nodes created on this thread, see astNodeCount
+static thread_local size_t nodesCreated = 0;
+
+size_t astNodeCount()
+{
+    return nodesCreated;
+}
+
+// Creates an empty child list in the current arena
+template <class T>
+static NodeList<T> *newNodeList()
+{
+    Arena *arena = Arena::Current();
+    if (!arena)
+        return new NodeList<T>();
+    return new (arena->Allocate(sizeof(NodeList<T>), alignof(NodeList<T>))) NodeList<T>(ArenaAllocator<T>(arena));
+}
+
+void *Node::operator new(size_t size)
+{
+    Arena *arena = Arena::Current();
+    if (!arena)
+        return ::operator new(size);
+    return arena->Allocate(size);
+}
+
 Node::Node(int lin, int col)
 {
+    nodesCreated++;
+    this->kind = NK_COUNT;
+    this->nodeId = NO_NODE_ID;
     this->line = lin;
     this->column = col;
     this->father = NULL;
@@ -10,6 +39,7 @@ Node::Node(int lin, int col)
 
 Prog::Prog(Ident *n, Decs *decl, SubDecs *subdecl, CompStmt *comst, int lin, int col) : Node(lin, col)
 {
+    this->kind = NK_PROG;
     this->name = n;
     n->father = this;
     this->declarations = decl;
@@ -20,15 +50,19 @@ Prog::Prog(Ident *n, Decs *decl, SubDecs *subdecl, CompStmt *comst, int lin, int
     comst->father = this;
 }
 
-Ident::Ident(string n, int lin, int col) : Node(lin, col)
+Ident::Ident(const InternedName &n, int lin, int col) : Node(lin, col), nameId(n.id), name(*n.spelling)
+{
+    this->kind = NK_IDENT;
+}
+
+Ident::Ident(string n, int lin, int col) : Ident(Interner::Global().InternName(n.data(), n.size()), lin, col)
 {
-    this->name = n;
-    this->symbol = NULL;
 }
 
 Decs::Decs(int lin, int col) : Node(lin, col)
 {
-    this->decs = new vector<ParDec *>;
+    this->kind = NK_DECS;
+    this->decs = newNodeList<ParDec *>();
 }
 
 void Decs::AddDec(ParDec *parDec)
@@ -39,6 +73,7 @@ void Decs::AddDec(ParDec *parDec)
 
 ParDec::ParDec(IdentList *idlst, Type *typ, int lin, int col) : Node(lin, col)
 {
+    this->kind = NK_PARDEC;
     this->identList = idlst;
     idlst->father = this;
     this->tp = typ;
@@ -47,7 +82,8 @@ ParDec::ParDec(IdentList *idlst, Type *typ, int lin, int col) : Node(lin, col)
 
 IdentList::IdentList(Ident *id, int lin, int col) : Node(lin, col)
 {
-    this->identLst = new vector<Ident *>;
+    this->kind = NK_IDENTLIST;
+    this->identLst = newNodeList<Ident *>();
     this->AddIdent(id);
 }
 
@@ -61,11 +97,13 @@ Type::Type(int lin, int col) : Node(lin, col) {}
 
 StdType::StdType(TypeEnum tp, int lin, int col) : Type(lin, col)
 {
+    this->kind = NK_STDTYPE;
     this->type = tp;
 }
 
 Array::Array(int beg, int end, StdType *tp, int lin, int col) : Type(lin, col)
 {
+    this->kind = NK_ARRAY;
     this->beginIndex = beg;
     this->endIndex = end;
     this->stdType = tp;
@@ -73,7 +111,8 @@ Array::Array(int beg, int end, StdType *tp, int lin, int col) : Type(lin, col)
 
 SubDecs::SubDecs(int lin, int col) : Node(lin, col)
 {
-    this->subdecs = new vector<SubDec *>;
+    this->kind = NK_SUBDECS;
+    this->subdecs = newNodeList<SubDec *>();
 }
 
 void SubDecs::AddDec(SubDec *sd)
@@ -84,6 +123,7 @@ void SubDecs::AddDec(SubDec *sd)
 
 SubDec::SubDec(SubHead *head, LocalDecs *locdecs, CompStmt *cmst, int lin, int col) : Node(lin, col)
 {
+    this->kind = NK_SUBDEC;
     this->subHead = head;
     if (head != NULL)
         head->father = this;
@@ -99,6 +139,7 @@ SubHead::SubHead(int lin, int col) : Node(lin, col) {}
 
 Func::Func(Ident *ident, Args *ags, StdType *tp, int lin, int col) : SubHead(lin, col)
 {
+    this->kind = NK_FUNC;
     this->id = ident;
     ident->father = this;
     this->args = ags;
@@ -110,6 +151,7 @@ Func::Func(Ident *ident, Args *ags, StdType *tp, int lin, int col) : SubHead(lin
 
 Proc::Proc(Ident *ident, Args *ags, int lin, int col) : SubHead(lin, col)
 {
+    this->kind = NK_PROC;
     this->id = ident;
     ident->father = this;
     this->args = ags;
@@ -119,6 +161,7 @@ Proc::Proc(Ident *ident, Args *ags, int lin, int col) : SubHead(lin, col)
 
 Args::Args(ParList *parls, int lin, int col) : Node(lin, col)
 {
+    this->kind = NK_ARGS;
     this->parList = parls;
     if (parls != NULL)
         parls->father = this;
@@ -126,13 +169,15 @@ Args::Args(ParList *parls, int lin, int col) : Node(lin, col)
 
 ParList::ParList(ParDec *prDec, int lin, int col) : Node(lin, col)
 {
-    this->parList = new vector<ParDec *>;
+    this->kind = NK_PARLIST;
+    this->parList = newNodeList<ParDec *>();
     this->AddDec(prDec);
 }
 
 LocalDecs::LocalDecs(int lin, int col) : Node(lin, col)
 {
-    this->localDecs = new vector<LocalDec *>;
+    this->kind = NK_LOCALDECS;
+    this->localDecs = newNodeList<LocalDec *>();
 }
 
 void LocalDecs::AddDec(LocalDec *localdec)
@@ -142,6 +187,7 @@ void LocalDecs::AddDec(LocalDec *localdec)
 
 LocalDec::LocalDec(IdentList *identlst, Type *typ, int lin, int col) : Node(lin, col)
 {
+    this->kind = NK_LOCALDEC;
     this->identlist = identlst;
     if (identlst != NULL)
         identlst->father = this;
@@ -158,6 +204,7 @@ void ParList::AddDec(ParDec *prDec)
 
 CompStmt::CompStmt(OptionalStmts *opst, int lin, int col) : Stmt(lin, col)
 {
+    this->kind = NK_COMPSTMT;
     this->optitonalStmts = opst;
     if (opst != NULL)
         opst->father = this;
@@ -165,6 +212,7 @@ CompStmt::CompStmt(OptionalStmts *opst, int lin, int col) : Stmt(lin, col)
 
 OptionalStmts::OptionalStmts(StmtList *stls, int lin, int col) : Node(lin, col)
 {
+    this->kind = NK_OPTIONALSTMTS;
     this->stmtList = stls;
     if (stls != NULL)
         stls->father = this;
@@ -172,7 +220,8 @@ OptionalStmts::OptionalStmts(StmtList *stls, int lin, int col) : Node(lin, col)
 
 StmtList::StmtList(Stmt *st, int lin, int col) : Node(lin, col)
 {
-    this->stmts = new vector<Stmt *>;
+    this->kind = NK_STMTLIST;
+    this->stmts = newNodeList<Stmt *>();
     this->AddStmt(st);
 }
 
@@ -186,6 +235,7 @@ Stmt::Stmt(int lin, int col) : Node(lin, col) {}
 
 Assign::Assign(Var *vr, Exp *ex, int lin, int col) : Stmt(lin, col)
 {
+    this->kind = NK_ASSIGN;
     this->var = vr;
     vr->father = this;
     this->exp = ex;
@@ -194,6 +244,7 @@ Assign::Assign(Var *vr, Exp *ex, int lin, int col) : Stmt(lin, col)
 
 ProcStmt::ProcStmt(Ident *ident, ExpList *exls, int lin, int col) : Stmt(lin, col)
 {
+    this->kind = NK_PROCSTMT;
     this->id = ident;
     if (ident)
         ident->father = this;
@@ -204,7 +255,8 @@ ProcStmt::ProcStmt(Ident *ident, ExpList *exls, int lin, int col) : Stmt(lin, co
 
 ExpList::ExpList(Exp *ex, int lin, int col) : Node(lin, col)
 {
-    this->expList = new vector<Exp *>;
+    this->kind = NK_EXPLIST;
+    this->expList = newNodeList<Exp *>();
     this->AddExp(ex);
 }
 
@@ -218,11 +270,13 @@ Exp::Exp(int lin, int col) : Node(lin, col) {}
 
 IdExp::IdExp(Ident *ident, int lin, int col) : Exp(lin, col)
 {
+    this->kind = NK_IDEXP;
     this->id = ident;
     ident->father = this;
 }
 ArrayExp::ArrayExp(Ident *ident, Exp *ind, int lin, int col) : Exp(lin, col)
 {
+    this->kind = NK_ARRAYEXP;
     this->id = ident;
     if(ident)
         ident->father = this;
@@ -233,27 +287,32 @@ ArrayExp::ArrayExp(Ident *ident, Exp *ind, int lin, int col) : Exp(lin, col)
 
 Integer::Integer(int value, int lin, int col) : Exp(lin, col)
 {
+    this->kind = NK_INTEGER;
     this->val = value;
 }
 
 Real::Real(float value, int lin, int col) : Exp(lin, col)
 {
+    this->kind = NK_REAL;
     this->val = value;
 }
 
 Bool::Bool(bool value, int lin, int col) : Exp(lin, col)
 {
+    this->kind = NK_BOOL;
     this->val = value;
 }
 
 Not::Not(Exp *e, int lin, int col) : Exp(lin, col)
 {
+    this->kind = NK_NOT;
     this->exp = e;
     e->father = this;
 }
 
 UnaryMinus::UnaryMinus(Exp *e, int lin, int col) : Exp(lin, col)
 {
+    this->kind = NK_UNARYMINUS;
     this->exp = e;
     e->father = this;
 }
@@ -266,34 +325,74 @@ BinOp::BinOp(Exp *lexp, Exp *rexp, int lin, int col) : Exp(lin, col)
     rexp->father = this;
 }
 
-Add::Add(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col) {}
+Add::Add(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col)
+{
+    this->kind = NK_ADD;
+}
 
-Sub::Sub(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col) {}
+Sub::Sub(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col)
+{
+    this->kind = NK_SUB;
+}
 
-Mult::Mult(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col) {}
+Mult::Mult(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col)
+{
+    this->kind = NK_MULT;
+}
 
-Divide::Divide(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col) {}
+Divide::Divide(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col)
+{
+    this->kind = NK_DIVIDE;
+}
 
-IntDiv::IntDiv(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col) {}
+IntDiv::IntDiv(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col)
+{
+    this->kind = NK_INTDIV;
+}
 
-GT::GT(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col) {}
+GT::GT(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col)
+{
+    this->kind = NK_GT;
+}
 
-LT::LT(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col) {}
+LT::LT(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col)
+{
+    this->kind = NK_LT;
+}
 
-GE::GE(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col) {}
+GE::GE(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col)
+{
+    this->kind = NK_GE;
+}
 
-LE::LE(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col) {}
+LE::LE(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col)
+{
+    this->kind = NK_LE;
+}
 
-ET::ET(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col) {}
+ET::ET(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col)
+{
+    this->kind = NK_ET;
+}
 
-NE::NE(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col) {}
+NE::NE(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col)
+{
+    this->kind = NK_NE;
+}
 
-And::And(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col) {}
+And::And(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col)
+{
+    this->kind = NK_AND;
+}
 
-Or::Or(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col) {}
+Or::Or(Exp *lexp, Exp *rexp, int lin, int col) : BinOp(lexp, rexp, lin, col)
+{
+    this->kind = NK_OR;
+}
 
 IfThen::IfThen(Exp *exp, Stmt *st, int lin, int col) : Stmt(lin, col)
 {
+    this->kind = NK_IFTHEN;
     this->expr = exp;
     exp->father = this;
     this->stmt = st;
@@ -302,6 +401,7 @@ IfThen::IfThen(Exp *exp, Stmt *st, int lin, int col) : Stmt(lin, col)
 
 IfThenElse::IfThenElse(Exp *exp, Stmt *frstSt, Stmt *scndSt, int lin, int col) : Stmt(lin, col)
 {
+    this->kind = NK_IFTHENELSE;
     this->expr = exp;
     exp->father = this;
     this->trueStmt = frstSt;
@@ -312,6 +412,7 @@ IfThenElse::IfThenElse(Exp *exp, Stmt *frstSt, Stmt *scndSt, int lin, int col) :
 
 While::While(Exp *exp, Stmt *st, int lin, int col) : Stmt(lin, col)
 {
+    this->kind = NK_WHILE;
     this->expr = exp;
     exp->father = this;
     this->stmt = st;
@@ -320,19 +421,21 @@ While::While(Exp *exp, Stmt *st, int lin, int col) : Stmt(lin, col)
 
 Var::Var(Ident *ident, int lin, int col) : Node(lin, col)
 {
-    this->type = VOID;
+    this->kind = NK_VAR;
     this->id = ident;
     ident->father = this;
 }
 
 ArrayElement::ArrayElement(Ident *ident, Exp *ind, int lin, int col) : Var(ident, lin, col)
 {
+    this->kind = NK_ARRAYELEMENT;
     this->index = ind;
     ind->father = this;
 }
 
 FuncCall::FuncCall(Ident *iden, ExpList *exls, int lin, int col) : Exp(lin, col)
 {
+    this->kind = NK_FUNCCALL;
     this->id = iden;
     iden->father = this;
     this->exps = exls;
@@ -604,4 +707,31 @@ void Not::accept(Visitor *v)
 void UnaryMinus::accept(Visitor *v)
 {
     v->Visit(this);
-}
\ No newline at end of file
+}
+bool callsFunction(Exp *e)
+{
+    if (isa<FuncCall>(e))
+        return true;
+    if (BinOp *b = dyn_cast<BinOp>(e))
+        return callsFunction(b->leftExp) || callsFunction(b->rightExp);
+    if (UnaryMinus *u = dyn_cast<UnaryMinus>(e))
+        return callsFunction(u->exp);
+    if (Not *nt = dyn_cast<Not>(e))
+        return callsFunction(nt->exp);
+    if (ArrayExp *a = dyn_cast<ArrayExp>(e))
+        return callsFunction(a->index);
+    return false;
+}
+
+bool mayTrap(Exp *e)
+{
+    if (isa<FuncCall>(e) || isa<ArrayExp>(e) || isa<IntDiv>(e) || isa<Divide>(e))
+        return true;
+    if (BinOp *b = dyn_cast<BinOp>(e))
+        return mayTrap(b->leftExp) || mayTrap(b->rightExp);
+    if (UnaryMinus *u = dyn_cast<UnaryMinus>(e))
+        return mayTrap(u->exp);
+    if (Not *nt = dyn_cast<Not>(e))
+        return mayTrap(nt->exp);
+    return false;
+}
@@ -1,19 +1,23 @@
-%{
+%code requires {
     #include "ast.h"
+    #include "CompilationContext.h"
+
+    #ifndef YY_TYPEDEF_YY_SCANNER_T
+    #define YY_TYPEDEF_YY_SCANNER_T
+    typedef void* yyscan_t;
+    #endif
+}
+
+%{
     #include <iostream>
     using std::endl;
     using std::cout;
-
-    extern int yylex();
-    extern int yyerror(const char*);
-    extern int yydebug;
-    
-    extern int lin, col;
-    Prog* root;
-
-    SymbolTable *symbolTable = new SymbolTable();
 %}
 
+%define api.pure full
+%parse-param {CompilationContext *ctx} {yyscan_t scanner}
+%lex-param {yyscan_t scanner}
+
 %union {
     // AST Nodes
     Prog* tProg;
@@ -48,6 +52,11 @@
     enum OpType tOp;
 }
 
+%code {
+    extern int yylex(YYSTYPE *, yyscan_t);
+    extern int yyerror(CompilationContext *, yyscan_t, const char*);
+}
+
 %token <tStdtype> KINT KREAL KBOOL
 %token <tFunc> KFUNC
 %token <tProc> KPROC
@@ -81,6 +90,7 @@
 %token KADD
 %token KSUB
 %token KDIVIDE
+%token KDOTDOT
 
 %type <tProg> program
 %type <tDecs> declarations
@@ -123,25 +133,25 @@
 %%
 program: KPROGRAM KIDENT ';' declarations sub_declarations comp_stmt 
     {
-        $$ = new Prog($2, $4, $5, $6, lin, col);
-        root = $$;
+        $$ = new Prog($2, $4, $5, $6, ctx->lin, ctx->col);
+        ctx->root = $$;
     }
 
 ;
 declarations: declarations  KVAR ident_list ':' type ';' 
     {
         $$ = $1;
-        ParDec* parDec = new ParDec($3, $5, lin, col);
+        ParDec* parDec = new ParDec($3, $5, ctx->lin, ctx->col);
         $$->AddDec(parDec); 
     }
     | /* empty */
     {
-        $$ = new Decs(lin, col);
+        $$ = new Decs(ctx->lin, ctx->col);
     }
 ;
 ident_list: KIDENT 
     {
-        $$ = new IdentList($1, lin, col);
+        $$ = new IdentList($1, ctx->lin, ctx->col);
     }
     | ident_list ',' KIDENT
     {
@@ -151,32 +161,32 @@ ident_list: KIDENT
 ;
 type: std_type 
     {
-        $$ = $1
+        $$ = $1;
     }
-    | KARRAY '[' KINTNUM '..' KINTNUM ']' KOF std_type
+    | KARRAY '[' KINTNUM KDOTDOT KINTNUM ']' KOF std_type
     {
-        $$ = new Array($3->val, $5->val, $8, lin, col);
+        $$ = new Array($3->val, $5->val, $8, ctx->lin, ctx->col);
     }
-    | KARRAY '[' KSUB KINTNUM '..' KSUB KINTNUM ']' KOF std_type
+    | KARRAY '[' KSUB KINTNUM KDOTDOT KSUB KINTNUM ']' KOF std_type
     {
-        $$ = new Array(-1 * $4->val, -1 * $7->val, $10, lin, col);
+        $$ = new Array(-1 * $4->val, -1 * $7->val, $10, ctx->lin, ctx->col);
     }
-    | KARRAY '[' KSUB KINTNUM '..' KINTNUM ']' KOF std_type
+    | KARRAY '[' KSUB KINTNUM KDOTDOT KINTNUM ']' KOF std_type
     {
-        $$ = new Array(-1 * $4->val, $6->val, $9, lin, col);
+        $$ = new Array(-1 * $4->val, $6->val, $9, ctx->lin, ctx->col);
     }
 ;
 std_type: KINT 
     {
-        $$ = new StdType(INTTYPE, lin, col);
+        $$ = new StdType(INTTYPE, ctx->lin, ctx->col);
     }
     | KREAL 
     {
-        $$ = new StdType(REALTYPE, lin, col);
+        $$ = new StdType(REALTYPE, ctx->lin, ctx->col);
     }
     | KBOOL
     {
-        $$ = new StdType(BOOLTYPE, lin, col);
+        $$ = new StdType(BOOLTYPE, ctx->lin, ctx->col);
     }
 ;
 sub_declarations: sub_declarations sub_dec ';'
@@ -187,26 +197,26 @@ sub_declarations: sub_declarations sub_dec ';'
     }
     | /* empty */
     {
-        $$ = new SubDecs(lin, col);
+        $$ = new SubDecs(ctx->lin, ctx->col);
     }
 ;
 sub_dec:  sub_head  local_dec comp_stmt
     {
-        $$ = new SubDec($1, $2, $3, lin, col);
+        $$ = new SubDec($1, $2, $3, ctx->lin, ctx->col);
     }
 ;
 sub_head: KFUNC KIDENT args ':' std_type ';'
     {
-        $$ = new Func($2, $3, $5, lin, col);
+        $$ = new Func($2, $3, $5, ctx->lin, ctx->col);
     }
     | KPROC KIDENT args ';'
     {
-        $$ = new Proc($2, $3, lin, col);
+        $$ = new Proc($2, $3, ctx->lin, ctx->col);
     }
 ;
 args: '(' param_list ')' 
     {
-        $$ =  new Args($2, lin, col);
+        $$ =  new Args($2, ctx->lin, ctx->col);
 
     }
     |'(' /* empty */ ')'
@@ -217,47 +227,47 @@ args: '(' param_list ')'
 ;
 param_list: ident_list ':' type 
     {
-        ParDec* parDec = new ParDec($1, $3, lin, col);
-        $$ = new ParList(parDec, lin, col);
+        ParDec* parDec = new ParDec($1, $3, ctx->lin, ctx->col);
+        $$ = new ParList(parDec, ctx->lin, ctx->col);
     }
     | param_list ';' ident_list ':' type
     {
         $$ = $1;
-        ParDec* parDec = new ParDec($3, $5, lin, col);
+        ParDec* parDec = new ParDec($3, $5, ctx->lin, ctx->col);
         $$->AddDec(parDec);
     }
 ;
 local_dec: local_dec KVAR ident_list ':' type ';' 
         {
             $$ = $1;
-            LocalDec* newDec = new LocalDec($3, $5, lin, col);
+            LocalDec* newDec = new LocalDec($3, $5, ctx->lin, ctx->col);
             $$->AddDec(newDec);
         }
         | /* empty */
         {
             // $$ = NULL;
-            $$ = new LocalDecs(lin, col);
+            $$ = new LocalDecs(ctx->lin, ctx->col);
         }
 ;
 
 comp_stmt: KBEGIN optional_stmts KEND
     {
-        $$ = new CompStmt($2, lin, col);
+        $$ = new CompStmt($2, ctx->lin, ctx->col);
     }
 ;
 optional_stmts: stmt_list 
     {
-        $$ = new OptionalStmts($1, lin, col);
+        $$ = new OptionalStmts($1, ctx->lin, ctx->col);
     }
     | /* empty */
     {
-        $$ = NULL
+        $$ = NULL;
         //cout << "Reduced optional_stmts to empty\n";
     }
 ;
 stmt_list: stmt 
     {
-        $$ = new StmtList($1, lin, col);
+        $$ = new StmtList($1, ctx->lin, ctx->col);
     }
     | stmt_list ';' stmt
     {
@@ -267,7 +277,7 @@ stmt_list: stmt
 ;
 stmt: variable KASSIGN exp
     {
-        $$ = new Assign($1, $3, lin, col);
+        $$ = new Assign($1, $3, ctx->lin, ctx->col);
     }
     | proc_stmt
     {
@@ -279,38 +289,38 @@ stmt: variable KASSIGN exp
     }
     | KIF exp KTHEN stmt %prec IF_PREC
     {
-        $$ = new IfThen($2, $4, lin, col);
+        $$ = new IfThen($2, $4, ctx->lin, ctx->col);
     }
     | KIF exp KTHEN stmt KELSE stmt
     {
-        $$ = new IfThenElse($2, $4, $6, lin, col);
+        $$ = new IfThenElse($2, $4, $6, ctx->lin, ctx->col);
     }
     | KWHILE exp KDO stmt
     {
-        $$ = new While($2, $4, lin, col);
+        $$ = new While($2, $4, ctx->lin, ctx->col);
     }
 ;
 variable: KIDENT
     {
-        $$ = new Var($1, lin, col);
+        $$ = new Var($1, ctx->lin, ctx->col);
     }
     | KIDENT '[' exp ']'
     {   
-        $$ = new ArrayElement($1, $3, lin, col);
+        $$ = new ArrayElement($1, $3, ctx->lin, ctx->col);
     }
 ;
 proc_stmt: KIDENT  '('  ')'
     {
-        $$ = new ProcStmt($1, NULL, lin, col);
+        $$ = new ProcStmt($1, NULL, ctx->lin, ctx->col);
     }
     | KIDENT '(' exp_list ')'
     {
-        $$ = new ProcStmt($1, $3, lin, col);
+        $$ = new ProcStmt($1, $3, ctx->lin, ctx->col);
     }
 ;
 exp_list: exp 
     {
-        $$ = new ExpList($1, lin, col);
+        $$ = new ExpList($1, ctx->lin, ctx->col);
     }
     | exp_list ',' exp
     {
@@ -320,19 +330,19 @@ exp_list: exp
 ;
 exp: KIDENT
     {
-        $$ = new IdExp($1, lin, col);
+        $$ = new IdExp($1, ctx->lin, ctx->col);
     }
     | KIDENT '[' exp ']'
     {
-        $$ = new ArrayExp($1, $3, lin, col);
+        $$ = new ArrayExp($1, $3, ctx->lin, ctx->col);
     }
     | KINTNUM
     {
-        $$ = new Integer($1->val, lin, col);
+        $$ = new Integer($1->val, ctx->lin, ctx->col);
     }
     | KREALNUM
     {
-        $$ = new Real($1->val, lin, col);
+        $$ = new Real($1->val, ctx->lin, ctx->col);
     }
     | KTRUE
     {
@@ -344,33 +354,33 @@ exp: KIDENT
     }
     | KIDENT '(' exp_list ')'
     {
-        $$ = new FuncCall($1, $3, lin, col);
+        $$ = new FuncCall($1, $3, ctx->lin, ctx->col);
 
     }
     | KIDENT '(' ')'
     {
-        $$ = new FuncCall($1, NULL, lin, col);
+        $$ = new FuncCall($1, NULL, ctx->lin, ctx->col);
 
     }
     | '(' exp ')'
     {
         $$ = $2;
     }
-    | exp KADD exp     { $$ = new Add($1, $3, lin, col); }
-    | exp KSUB exp     { $$ = new Sub($1, $3, lin, col); }
-    | exp KMULT exp    { $$ = new Mult($1, $3, lin, col); }
-    | exp KDIVIDE exp  { $$ = new Divide($1, $3, lin, col); }
-    | exp KINTDIV exp     { $$ = new IntDiv($1, $3, lin, col); }
-    | exp KOR exp      { $$ = new Or($1, $3, lin, col); }
-    | exp KAND exp     { $$ = new And($1, $3, lin, col); }
-    | exp KET exp      { $$ = new ET($1, $3, lin, col); }
-    | exp KNE exp      { $$ = new NE($1, $3, lin, col); }
-    | exp KLT exp      { $$ = new LT($1, $3, lin, col); }
-    | exp KGT exp      { $$ = new GT($1, $3, lin, col); }
-    | exp KLE exp      { $$ = new LE($1, $3, lin, col); }
-    | exp KGE exp      { $$ = new GE($1, $3, lin, col); }
-    | KNOT exp         { $$ = new Not($2, lin, col); }
-    | KSUB exp %prec KUMINUS { $$ = new UnaryMinus($2, lin, col); } 
+    | exp KADD exp     { $$ = new Add($1, $3, ctx->lin, ctx->col); }
+    | exp KSUB exp     { $$ = new Sub($1, $3, ctx->lin, ctx->col); }
+    | exp KMULT exp    { $$ = new Mult($1, $3, ctx->lin, ctx->col); }
+    | exp KDIVIDE exp  { $$ = new Divide($1, $3, ctx->lin, ctx->col); }
+    | exp KINTDIV exp     { $$ = new IntDiv($1, $3, ctx->lin, ctx->col); }
+    | exp KOR exp      { $$ = new Or($1, $3, ctx->lin, ctx->col); }
+    | exp KAND exp     { $$ = new And($1, $3, ctx->lin, ctx->col); }
+    | exp KET exp      { $$ = new ET($1, $3, ctx->lin, ctx->col); }
+    | exp KNE exp      { $$ = new NE($1, $3, ctx->lin, ctx->col); }
+    | exp KLT exp      { $$ = new LT($1, $3, ctx->lin, ctx->col); }
+    | exp KGT exp      { $$ = new GT($1, $3, ctx->lin, ctx->col); }
+    | exp KLE exp      { $$ = new LE($1, $3, ctx->lin, ctx->col); }
+    | exp KGE exp      { $$ = new GE($1, $3, ctx->lin, ctx->col); }
+    | KNOT exp         { $$ = new Not($2, ctx->lin, ctx->col); }
+    | KSUB exp %prec KUMINUS { $$ = new UnaryMinus($2, ctx->lin, ctx->col); } 
 
 
 ;
@@ -378,7 +388,7 @@ exp: KIDENT
 
 %%
 
-int yyerror(const char* s){
-    cout << "SYNTAX ERROR: " << s << " Line: "<<lin+1 << " Column: " << col << endl;
+int yyerror(CompilationContext *ctx, yyscan_t scanner, const char* s){
+    *ctx->log << "SYNTAX ERROR: " << s << " Line: "<<ctx->lin+1 << " Column: " << ctx->col << endl;
     return 0; 
 }
@@ -1,104 +1,243 @@
-#include "ast.h"
-#include "Error.h"
-#include "parser.h"
-#include "CommonTypes.h"
+#include "Compiler.h"
+#include "CompileServer.h"
+#include "ThreadPool.h"
+#include "TimeReport.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
 #include <cstdio>    
 #include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 using namespace std;
 extern int yydebug;
-extern int yyparse();
-extern Prog* root;
-extern FILE* yyin;
-extern Errors *errorStack;
-extern SymbolTable* symbolTable;
-
-void initializeBuiltInFunctions(SymbolTable* st) {
-    // Built-in procedure: write(integer)
-    {
-        Ident* writeIdent = new Ident("write", 0, 0);
-        std::vector<Type*>* params = new std::vector<Type*>();
-        params->push_back(new StdType(INTTYPE, 0, 0));
-        FunctionSignature* sig = new FunctionSignature("write", params, VOID);
-        st->AddSymbol(writeIdent, PROC, sig);
-        delete writeIdent; // Clean up temporary Ident
+
+/**
+ * @brief Result of one job of a batch compilation
+ */
+struct BatchJob {
+    string input;     ///< Source file
+    string output;    ///< Generated VM file
+    int status;       ///< compileFile's return value
+    double seconds;   ///< Wall time spent on this file
+    string log;       ///< Everything the compilation printed
+};
+
+// Compiles every input on a work-stealing pool; each job writes
+// <outdir>/<stem>.vm and buffers its messages so they do not interleave.
+static int compileBatch(const vector<string>& inputs, const string& outdir,
+                        unsigned jobs, const CompileOptions& options) {
+    auto start = chrono::steady_clock::now();
+
+    // Two inputs with the same stem (a/main.txt, b/main.txt) would write one file from two threads
+    vector<BatchJob> results(inputs.size());
+    unordered_map<string, string> inputOf;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        BatchJob& job = results[i];
+        job.input = inputs[i];
+        string name = filesystem::path(inputs[i]).stem().string() + ".vm";
+        job.output = outdir.empty() ? name : (filesystem::path(outdir) / name).string();
+        auto claimed = inputOf.emplace(job.output, job.input);
+        if (!claimed.second) {
+            cerr << "Error: " << claimed.first->second << " and " << job.input << " would both be compiled to "
+                 << job.output << "; rename one or compile them in separate runs" << endl;
+            return 1;
+        }
+    }
+
+    if (!outdir.empty()) {
+        error_code ec;
+        filesystem::create_directories(outdir, ec);
+        if (ec) {
+            cerr << "Error creating output directory " << outdir << ": " << ec.message() << endl;
+            return 1;
+        }
     }
 
-    // Built-in procedure: write(real)
-    {
-        Ident* writeIdent = new Ident("write", 0, 0);
-        std::vector<Type*>* params = new std::vector<Type*>();
-        params->push_back(new StdType(REALTYPE, 0, 0));
-        FunctionSignature* sig = new FunctionSignature("write", params, VOID);
-        st->AddSymbol(writeIdent, PROC, sig);
-        delete writeIdent;
+    // The jobs check large programs' subprogram bodies on the same pool
+    ThreadPool pool(jobs);
+    CompileOptions jobOptions = options;
+    jobOptions.pool = &pool;
+
+    vector<function<void()>> tasks;
+    for (BatchJob& job : results) {
+        tasks.push_back([&job, &jobOptions]() {
+            auto jobStart = chrono::steady_clock::now();
+            ostringstream log;
+            job.status = compileFile(job.input, job.output, jobOptions, log);
+            job.log = log.str();
+            job.seconds = chrono::duration<double>(chrono::steady_clock::now() - jobStart).count();
+        });
     }
 
-    // Built-in procedure: write(boolean) - will print 0 or 1
-    {
-        Ident* writeIdent = new Ident("write", 0, 0);
-        std::vector<Type*>* params = new std::vector<Type*>();
-        params->push_back(new StdType(BOOLTYPE, 0, 0));
-        FunctionSignature* sig = new FunctionSignature("write", params, VOID);
-        st->AddSymbol(writeIdent, PROC, sig);
-        delete writeIdent;
+    pool.Run(tasks);
+
+    // Report in command-line order, whatever order the jobs finished in
+    int failed = 0;
+    cout << fixed << setprecision(3);
+    for (auto& job : results) {
+        if (job.status == 0) {
+            cout << "[ OK ] " << job.input << " -> " << job.output << " (" << job.seconds << "s)" << endl;
+        } else {
+            failed++;
+            cout << "[FAIL] " << job.input << " (" << job.seconds << "s)" << endl;
+            cout << job.log;
+        }
     }
+    double total = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << results.size() - failed << " succeeded, " << failed << " failed, "
+         << jobs << " jobs, total wall time " << total << "s" << endl;
+    return failed ? 1 : 0;
+}
+
+// Parses the count given to an option; false unless it is a whole number of at least `min`
+// (atoi would take "-1" as 4 billion threads once stored unsigned)
+static bool parseCount(const char* text, unsigned long min, unsigned long& value) {
+    char* end;
+    errno = 0;
+    value = strtoul(text, &end, 10);
+    return text[0] >= '0' && text[0] <= '9' && *end == '\0' && errno == 0 && value >= min &&
+           value <= UINT32_MAX;
 }
 
+// The running server, stopped by SIGINT and SIGTERM
+static CompileServer* runningServer = NULL;
+
+static void stopServer(int) {
+    if (runningServer)
+        runningServer->Stop();
+}
+
+// Answers compile requests on `socketPath` until interrupted
+static int serve(const string& socketPath, const CompileOptions& options) {
+    CompileServer server(socketPath, options);
+    if (!server.Listen(cerr))
+        return 1;
+    runningServer = &server;
+    signal(SIGINT, stopServer);
+    signal(SIGTERM, stopServer);
+    cout << "Compile server listening on " << socketPath << endl;
+    server.Serve();
+    runningServer = NULL;
+    cout << "Compile server stopped after " << server.served << " requests" << endl;
+    return 0;
+}
 
 int main(int argc, char* argv[]) {
     yydebug = 0;  // Enable debug if needed
     string output_filename = "build/output.vm";
-    if (argc < 2) {
-
-        cerr << "If you want to pass input from a file then \n Usage: " << argv[0] << " <input-file>\n";
-        cerr << "Compiling from standard input." << endl;
-        yyin = stdin;
-
-    }
-    else{
-        yyin = fopen(argv[1], "r");
-        if (!yyin) {
-            perror("Error opening input file");
-            return 1;
+    vector<string> input_filenames;
+    CompileOptions options;
+    string outdir;
+    string serverSocket, connectSocket;
+    unsigned jobs = 0;
+    bool batch = false;
+    bool outputGiven = false;
+    options.checkJobs = max(1u, thread::hardware_concurrency()); // which is 0 if unknown
+    unsigned long count;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            output_filename = argv[++i];
+            outputGiven = true;
+        }
+        else if (arg == "--no-mmap") {
+            options.useMmap = false;
+        }
+        else if (arg == "-O") {
+            options.optimize = true;
+        }
+        else if (arg == "--time-report") {
+            options.timeReport = true;
+        }
+        else if (arg == "--max-errors" && i + 1 < argc) {
+            if (!parseCount(argv[++i], 0, count)) {
+                cerr << "Error: --max-errors takes a number of errors (0: no limit), not " << argv[i] << endl;
+                return 1;
+            }
+            options.maxErrors = count;
+        }
+        else if (arg == "--cache" && i + 1 < argc) {
+            options.cacheDir = argv[++i];
+        }
+        else if (arg == "--server" && i + 1 < argc) {
+            serverSocket = argv[++i];
+        }
+        else if (arg == "--connect" && i + 1 < argc) {
+            connectSocket = argv[++i];
+        }
+        else if (arg == "--check-jobs" && i + 1 < argc) {
+            if (!parseCount(argv[++i], 1, count)) {
+                cerr << "Error: --check-jobs takes a number of threads of at least 1, not " << argv[i] << endl;
+                return 1;
+            }
+            options.checkJobs = count;
+        }
+        else if ((arg == "--jobs" || arg == "-j") && i + 1 < argc) {
+            if (!parseCount(argv[++i], 1, count)) {
+                cerr << "Error: " << arg << " takes a number of threads of at least 1, not " << argv[i] << endl;
+                return 1;
+            }
+            jobs = count;
+            batch = true;
+        }
+        else if (arg == "--outdir" && i + 1 < argc) {
+            outdir = argv[++i];
+            batch = true;
+        }
+        else {
+            input_filenames.push_back(arg);
         }
-        // Check for output file argument
-        if (argc > 3 && string(argv[2]) == "-o") {
-            output_filename = argv[3];
-        }
-    }   
-    initializeBuiltInFunctions(symbolTable);
-    // Parsing
-    yyparse(); 
-    if (!root) {
-        cerr << "Parsing failed." << endl;
-        if (yyin != stdin) fclose(yyin);
-        return 1;
     }
 
-    // cout << "--- AST ---" << endl;
-    Visitor* printVisitor = new PrintVisitor();
-    // root->accept(printVisitor);
-
-    Visitor* typeVisitor = new TypeVisitor();
-    root->accept(typeVisitor);
+    // Counted only when a report may be asked for: by this command or by a server's clients
+    TimeReport::countAllocations = options.timeReport || !serverSocket.empty();
 
+    if (!serverSocket.empty())
+        return serve(serverSocket, options);
 
-    errorStack->PrintWarnings();
-    errorStack->PrintErrors();
+    // Client mode: the server compiles the file, or the text read from stdin
+    if (!connectSocket.empty()) {
+        if (batch || input_filenames.size() > 1) {
+            cerr << "Usage: " << argv[0] << " --connect SOCKET [<input-file>] [-o <output-file>]\n";
+            return 1;
+        }
+        if (input_filenames.empty()) {
+            string text((istreambuf_iterator<char>(cin)), istreambuf_iterator<char>());
+            return compileRemote(connectSocket, "", &text, output_filename, options, cout) == 0 ? 0 : 1;
+        }
+        return compileRemote(connectSocket, input_filenames[0], NULL, output_filename, options, cout) == 0 ? 0 : 1;
+    }
 
-    if (errorStack->errorStack->empty()) {
-        cout << "No errors found. Generating code to " << output_filename << "..." << endl;
-        CodeGenVisitor* codeGen = new CodeGenVisitor(output_filename);
-        root->accept(codeGen);
+    if (batch || input_filenames.size() > 1) {
+        if (input_filenames.empty()) {
+            cerr << "Usage: " << argv[0] << " [--jobs N] [--outdir DIR] <input-file>...\n";
+            return 1;
+        }
+        if (outputGiven) {
+            cerr << "Error: -o names a single output file; with several inputs use --outdir DIR\n";
+            return 1;
+        }
+        if (jobs == 0)
+            jobs = max(1u, thread::hardware_concurrency());
+        return compileBatch(input_filenames, outdir, jobs, options);
+    }
 
-        cout << "Code generation complete." << endl;
-    } else {
-        if (yyin != stdin) fclose(yyin);
-        return 1;
+    if (input_filenames.empty()) {
+        cerr << "If you want to pass input from a file then \n Usage: " << argv[0] << " <input-file>\n";
+        cerr << "Compiling from standard input." << endl;
+        return compileFile("", output_filename, options, cout);
     }
-    
-    if (yyin != stdin) fclose(yyin);
-    return 0;
-}
\ No newline at end of file
+    return compileFile(input_filenames[0], output_filename, options, cout);
+}